@@ -12,60 +12,260 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <exception>
+#include <mutex>  // NOLINT
+#include <new>
+#include <utility>
+#include <vector>
+
+#ifdef BUSTUB_HAVE_NUMA
+#include <numa.h>
+#endif
+
+#include "common/exception.h"
+#include "common/logger.h"
 #include "common/macros.h"
 
 namespace bustub {
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager)
-    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager) {}
+                                                     LogManager *log_manager, ReplacerType replacer_type)
+    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager, replacer_type) {}
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                                                     DiskManager *disk_manager, LogManager *log_manager)
+                                                     DiskManager *disk_manager, LogManager *log_manager,
+                                                     ReplacerType replacer_type, int numa_node)
     : pool_size_(pool_size),
       num_instances_(num_instances),
       instance_index_(instance_index),
-      next_page_id_(instance_index),
+      page_size_(disk_manager != nullptr ? disk_manager->GetPageSize() : PAGE_SIZE),
+      frame_arena_(pool_size, buffer_pool_huge_pages, page_size_),
       disk_manager_(disk_manager),
-      log_manager_(log_manager) {
+      log_manager_(log_manager),
+      page_table_(pool_size),
+      num_free_frames_(pool_size),
+      writing_back_(pool_size),
+      unwritten_victims_(pool_size, false) {
   BUSTUB_ASSERT(num_instances > 0, "If BPI is not part of a pool, then the pool size should just be 1");
   BUSTUB_ASSERT(
       instance_index < num_instances,
       "BPI index cannot be greater than the number of BPIs in the pool. In non-parallel case, index should just be 1.");
-  // We allocate a consecutive memory space for the buffer pool.
-  pages_ = new Page[pool_size_];
-  replacer_ = new LRUReplacer(pool_size);
-
-  // Initially, every page is in the free list.
+  // Frame data lives in the arena, apart from the Page book-keeping, which gets a cache line (or more) per frame so
+  // that latching one frame does not slow down its neighbours.
+  if (numa_node >= 0) {
+    // nothing has touched the frames yet, so they are faulted in on the node as they are first used
+#ifdef BUSTUB_HAVE_NUMA
+    if (numa_available() >= 0 && numa_node < GetNumaNodeCount()) {
+      numa_tonode_memory(frame_arena_.GetData(), frame_arena_.GetSize(), numa_node);
+    } else {
+      LOG_WARN("NUMA node %d is not available, frames are not bound", numa_node);
+    }
+#else
+    LOG_WARN("built without libnuma, frames are not bound to NUMA node %d", numa_node);
+#endif
+  }
+  pages_ = static_cast<Page *>(operator new[](pool_size_ * sizeof(Page), std::align_val_t{alignof(Page)}));
   for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.emplace_back(static_cast<int>(i));
+    new (pages_ + i) Page(frame_arena_.GetFrame(static_cast<frame_id_t>(i)), page_size_);
+    pages_[i].pin_count_ = FRAME_RESERVED;
+  }
+  switch (replacer_type) {
+    case ReplacerType::LRU_K:
+      replacer_ = new LRUKReplacer(pool_size);
+      break;
+    case ReplacerType::TWO_Q:
+      replacer_ = new TwoQReplacer(pool_size);
+      break;
+    case ReplacerType::CLOCK:
+      replacer_ = new ClockReplacer(pool_size);
+      break;
+    default:
+      replacer_ = new LRUReplacer(pool_size);
+      break;
+  }
+
+  // Initially, every page is in the free list. It is used as a stack, push the frames so that frame 0 comes out first.
+  free_list_.reserve(pool_size_);
+  for (size_t i = pool_size_; i > 0; --i) {
+    free_list_.push_back(static_cast<frame_id_t>(i - 1));
   }
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
-  delete[] pages_;
+  StopPageCleaner();
+  {
+    // prefetch completions still refer to this instance
+    std::unique_lock lock{latch_};
+    io_cv_.wait(lock, [this] { return num_prefetching_ == 0; });
+  }
+  for (size_t i = 0; i < pool_size_; ++i) {
+    pages_[i].~Page();
+  }
+  operator delete[](pages_, std::align_val_t{alignof(Page)});
   delete replacer_;
 }
 
+int BufferPoolManagerInstance::GetNumaNodeCount() {
+#ifdef BUSTUB_HAVE_NUMA
+  if (numa_available() >= 0) {
+    return numa_num_configured_nodes();
+  }
+#endif
+  return 1;
+}
+
 bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
-  std::scoped_lock lock{latch_};
-  if (page_table_.count(page_id) == 0) {
-    return false;
+  std::unique_lock lock{latch_};
+  frame_id_t frame_id{};
+  while (true) {
+    if (!page_table_.Find(page_id, &frame_id)) {
+      return false;
+    }
+    if (!pages_[frame_id].io_in_progress_ && !pages_[frame_id].cleaning_) {
+      break;
+    }
+    io_cv_.wait(lock);
   }
 
-  Page *page = pages_ + page_table_[page_id];
-  disk_manager_->WritePage(page_id, page->data_);
+  // Write the page out the way the page cleaner does: flagged cleaning_, so that the frame is not reused before the
+  // write lands, but without holding latch_ across the log flush and the write. The read latch keeps a writer from
+  // changing the page while it is written, which would tear the image on disk; it is only waited for without latch_.
+  Page *page = pages_ + frame_id;
+  page->cleaning_ = true;
   page->is_dirty_ = false;
+  num_cleaning_++;
+  lock.unlock();
+
+  std::exception_ptr error;
+  page->RLatch();
+  try {
+    FlushLog(page->GetLSN());
+    auto start = std::chrono::steady_clock::now();
+    disk_manager_->WritePage(page_id, page->data_);
+    metrics_.write_ns_.Record(NanosSince(start));
+  } catch (const Exception &e) {
+    error = std::current_exception();
+  }
+  page->RUnlatch();
+
+  lock.lock();
+  if (error != nullptr) {
+    RedirtyUnwritten(page, page_id);
+  }
+  page->cleaning_ = false;
+  ForgetRecLsn(page);
+  num_cleaning_--;
+  lock.unlock();
+  io_cv_.notify_all();
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
   return true;
 }
 
 void BufferPoolManagerInstance::FlushAllPgsImp() {
-  std::scoped_lock lock{latch_};
-  for (auto it : page_table_) {
-    Page *page = pages_ + it.second;
-    disk_manager_->WritePage(page->page_id_, page->data_);
+  std::unique_lock lock{latch_};
+  // a write from the page cleaner could otherwise land after ours with older contents
+  io_cv_.wait(lock, [this] { return num_cleaning_ == 0; });
+  std::vector<DiskRequest> requests;
+  requests.reserve(page_table_.Size());
+  std::vector<Page *> flushed;
+  flushed.reserve(page_table_.Size());
+  // pages somebody has latched, each written on its own once its latch is had
+  std::vector<Page *> latched;
+  lsn_t max_lsn = INVALID_LSN;
+  for (size_t i = 0; i < pool_size_; ++i) {
+    Page *page = pages_ + i;
+    // free frames and frames whose read failed hold no page; frames under I/O are either being loaded (clean) or
+    // zeroed for a new page
+    if (page->pin_count_ == FRAME_RESERVED || page->io_in_progress_ || page->page_id_ == INVALID_PAGE_ID) {
+      continue;
+    }
+    page->cleaning_ = true;
     page->is_dirty_ = false;
+    // the read latch keeps writers off the page until it is written; waiting for it under latch_ could deadlock
+    if (!page->TryRLatch()) {
+      latched.push_back(page);
+      continue;
+    }
+    requests.push_back({true, page->page_id_, page->data_});
+    max_lsn = std::max(max_lsn, page->GetLSN());
+    flushed.push_back(page);
+  }
+  num_cleaning_ += flushed.size() + latched.size();
+  lock.unlock();
+
+  std::exception_ptr error = WriteCleaning(std::move(requests), flushed, max_lsn);
+  for (Page *page : flushed) {
+    page->RUnlatch();
+  }
+  // one latch at a time, so that this never waits for a latch while holding another
+  for (Page *page : latched) {
+    page->RLatch();
+    std::exception_ptr page_error =
+        WriteCleaning({{true, page->GetPageId(), page->data_}}, std::vector<Page *>{page}, page->GetLSN());
+    page->RUnlatch();
+    if (error == nullptr) {
+      error = page_error;
+    }
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+bool BufferPoolManagerInstance::ReserveFrame(frame_id_t *frame_id, page_id_t *victim_page_id) {
+  *victim_page_id = INVALID_PAGE_ID;
+  if (!free_list_.empty()) {
+    *frame_id = free_list_.back();
+    free_list_.pop_back();
+    num_free_frames_--;
+    return true;
+  }
+  while (true) {
+    if (!replacer_->Victim(frame_id)) {
+      return false;
+    }
+    // claim the frame, unless a lock-free fetch pinned it since it became a victim; it returns to the replacer when
+    // that pin is released
+    if (ClaimFrame(*frame_id)) {
+      break;
+    }
   }
+
+  Page *page = pages_ + *frame_id;
+  metrics_.evictions_.Add();
+  page_table_.Erase(page->page_id_);
+  // the old contents are still to be written, either by us or by the page cleaner
+  // the recLSN belongs to the old contents, and is only forgotten once they are on disk
+  lsn_t rec_lsn = page->rec_lsn_.exchange(INVALID_LSN);
+  if (page->is_dirty_ || page->cleaning_) {
+    *victim_page_id = page->page_id_;
+    writing_back_.Insert(page->page_id_, *frame_id);
+    if (rec_lsn != INVALID_LSN) {
+      writing_back_rec_lsns_[page->page_id_] = rec_lsn;
+    }
+  }
+  if (page->is_dirty_) {
+    metrics_.dirty_evictions_.Add();
+    // the cleaner is falling behind
+    cleaner_cv_.notify_one();
+  }
+  return true;
+}
+
+void BufferPoolManagerInstance::FinishIo(Page *page, page_id_t victim_page_id) {
+  {
+    std::scoped_lock lock{latch_};
+    page->io_in_progress_ = false;
+    if (victim_page_id != INVALID_PAGE_ID) {
+      writing_back_.Erase(victim_page_id);
+      writing_back_rec_lsns_.erase(victim_page_id);
+    }
+  }
+  io_cv_.notify_all();
 }
 
 Page *BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) {
@@ -74,28 +274,71 @@ Page *BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) {
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   // 4.   Set the page ID output parameter. Return a pointer to P.
-  std::scoped_lock lock{latch_};
-  frame_id_t free_frame_id{};
-  if (!free_list_.empty()) {
-    free_frame_id = free_list_.front();
-    free_list_.pop_front();
-  } else if (replacer_->Victim(&free_frame_id)) {
-    Page *page = pages_ + free_frame_id;
-    if (page->is_dirty_) {
-      disk_manager_->WritePage(page->page_id_, page->data_);
-    }
-    page_table_.erase(page->page_id_);
-  } else {
+  return CreatePage(page_id, true);
+}
+
+page_id_t BufferPoolManagerInstance::AllocateExtentImp(uint32_t num_pages, tablespace_id_t tablespace_id) {
+  // the frames only fit pages of the main file's size
+  if (disk_manager_->GetPageSize(tablespace_id) != page_size_) {
+    throw Exception(ExceptionType::INVALID, "tablespace " + std::to_string(tablespace_id) + " has pages of " +
+                                                std::to_string(disk_manager_->GetPageSize(tablespace_id)) + " bytes");
+  }
+  return disk_manager_->AllocateExtent(num_pages, tablespace_id);
+}
+
+Page *BufferPoolManagerInstance::NewPgInExtentImp(page_id_t page_id) {
+  ValidatePageId(page_id);
+  Page *page = CreatePage(&page_id, false);
+  // the page is pinned and clean, so the map records it before it can be written
+  if (page != nullptr) {
+    disk_manager_->MarkAllocated(page_id);
+  }
+  return page;
+}
+
+Page *BufferPoolManagerInstance::CreatePage(page_id_t *page_id, bool allocate) {
+  std::unique_lock lock{latch_};
+  frame_id_t frame_id{};
+  page_id_t victim_page_id{};
+  if (!ReserveFrame(&frame_id, &victim_page_id)) {
     return nullptr;
   }
 
-  Page *page = pages_ + free_frame_id;
-  *page_id = page->page_id_ = AllocatePage();
-  page->ResetMemory();
-  page->pin_count_ = 1;
+  Page *page = pages_ + frame_id;
+  bool victim_dirty = page->is_dirty_;
+  if (allocate) {
+    *page_id = AllocatePage();
+  }
+  page_table_.Insert(*page_id, frame_id);
+  replacer_->Admit(frame_id, *page_id);
+  replacer_->Pin(frame_id);
+  page->page_id_ = *page_id;
   page->is_dirty_ = false;
-  page_table_[page->page_id_] = free_frame_id;
-  replacer_->Pin(free_frame_id);
+  if (victim_page_id == INVALID_PAGE_ID) {
+    page->ResetMemory();
+    page->pin_count_ = 1;
+    return page;
+  }
+
+  // The victim must reach the disk before the frame is reused; do it without blocking the rest of the pool.
+  page->io_in_progress_ = true;
+  page->pin_count_ = 1;
+  WaitForIo(&lock, [page] { return !page->cleaning_; });
+  victim_dirty = TakeUnwrittenVictim(frame_id) || victim_dirty;
+  lock.unlock();
+  if (victim_dirty) {
+    try {
+      WriteVictim(victim_page_id, page);
+    } catch (const Exception &e) {
+      AbandonEviction(page, victim_page_id);
+      if (allocate) {
+        DeallocatePage(*page_id);
+      }
+      throw;
+    }
+  }
+  page->ResetMemory();
+  FinishIo(page, victim_page_id);
   return page;
 }
 
@@ -107,90 +350,598 @@ Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
   // 2.     If R is dirty, write it back to the disk.
   // 3.     Delete R from the page table and insert P.
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-  std::scoped_lock lock{latch_};
-  if (page_table_.count(page_id) != 0) {
-    frame_id_t frame_id = page_table_[page_id];
-    Page *page = pages_ + frame_id;
-    page->pin_count_++;
-    replacer_->Pin(frame_id);
-    return page;
+  Page *resident = TryPinResident(page_id);
+  if (resident != nullptr) {
+    metrics_.hits_.Add();
+    return resident;
   }
 
-  frame_id_t free_frame_id{};
-  if (!free_list_.empty()) {
-    free_frame_id = free_list_.front();
-    free_list_.pop_front();
-  } else if (replacer_->Victim(&free_frame_id)) {
-    Page *page = pages_ + free_frame_id;
-    if (page->is_dirty_) {
-      disk_manager_->WritePage(page->page_id_, page->data_);
-    }
-    page_table_.erase(page->page_id_);
-  } else {
+  std::unique_lock lock{latch_};
+  while (true) {
+    frame_id_t frame_id{};
+    if (page_table_.Find(page_id, &frame_id)) {
+      Page *page = pages_ + frame_id;
+      page->pin_count_++;
+      ReplacerPin(frame_id);
+      // our pin keeps the frame in place while another thread finishes loading it
+      WaitForIo(&lock, [page] { return !page->io_in_progress_; });
+      if (page->page_id_ == page_id) {
+        metrics_.hits_.Add();
+        return page;
+      }
+      // the page failed its checksum, read it again so that this fetch reports the failure too
+      DropPin(frame_id);
+      continue;
+    }
+    // an older version of the page is still on its way to disk, reading it now would return stale data
+    if (!writing_back_.Find(page_id, &frame_id)) {
+      break;
+    }
+    WaitForIo(&lock, [this, page_id, &frame_id] { return !writing_back_.Find(page_id, &frame_id); });
+  }
+
+  metrics_.misses_.Add();
+  frame_id_t frame_id{};
+  page_id_t victim_page_id{};
+  if (!ReserveFrame(&frame_id, &victim_page_id)) {
     return nullptr;
   }
 
-  page_table_[page_id] = free_frame_id;
-  Page *page = pages_ + free_frame_id;
+  page_table_.Insert(page_id, frame_id);
+  Page *page = pages_ + frame_id;
+  bool victim_dirty = page->is_dirty_;
+  replacer_->Admit(frame_id, page_id);
+  replacer_->Pin(frame_id);
   page->page_id_ = page_id;
-  page->pin_count_ = 1;
   page->is_dirty_ = false;
-  disk_manager_->ReadPage(page_id, page->data_);
+  page->io_in_progress_ = true;
+  page->pin_count_ = 1;
+  // the frame cannot be overwritten while the page cleaner is still writing out the victim
+  WaitForIo(&lock, [page] { return !page->cleaning_; });
+  victim_dirty = TakeUnwrittenVictim(frame_id) || victim_dirty;
+  lock.unlock();
+
+  if (victim_dirty) {
+    try {
+      WriteVictim(victim_page_id, page);
+    } catch (const Exception &e) {
+      AbandonEviction(page, victim_page_id);
+      throw;
+    }
+  }
+  auto start = std::chrono::steady_clock::now();
+  try {
+    disk_manager_->ReadPage(page_id, page->data_);
+  } catch (const Exception &e) {
+    AbandonRead(page, victim_page_id);
+    throw;
+  }
+  metrics_.read_ns_.Record(NanosSince(start));
+  FinishIo(page, victim_page_id);
   return page;
 }
 
+void BufferPoolManagerInstance::AbandonRead(Page *page, page_id_t victim_page_id) {
+  {
+    std::scoped_lock lock{latch_};
+    // the frame holds no page from here on, it is evicted like any other once its last pin is gone
+    page_table_.Erase(page->page_id_);
+    page->page_id_ = INVALID_PAGE_ID;
+    page->io_in_progress_ = false;
+    if (victim_page_id != INVALID_PAGE_ID) {
+      writing_back_.Erase(victim_page_id);
+      writing_back_rec_lsns_.erase(victim_page_id);
+    }
+    DropPin(static_cast<frame_id_t>(page - pages_));
+  }
+  io_cv_.notify_all();
+}
+
+void BufferPoolManagerInstance::AbandonEviction(Page *page, page_id_t victim_page_id) {
+  {
+    std::scoped_lock lock{latch_};
+    // the victim stays resident and dirty, with the recLSN it had, as if it had never been picked
+    auto frame_id = static_cast<frame_id_t>(page - pages_);
+    page_table_.Erase(page->page_id_);
+    page_table_.Insert(victim_page_id, frame_id);
+    replacer_->Admit(frame_id, victim_page_id);
+    writing_back_.Erase(victim_page_id);
+    auto rec_lsn = writing_back_rec_lsns_.find(victim_page_id);
+    if (rec_lsn != writing_back_rec_lsns_.end()) {
+      page->rec_lsn_ = rec_lsn->second;
+      writing_back_rec_lsns_.erase(rec_lsn);
+    }
+    page->page_id_ = victim_page_id;
+    page->is_dirty_ = true;
+    page->io_in_progress_ = false;
+    DropPin(frame_id);
+  }
+  io_cv_.notify_all();
+}
+
+bool BufferPoolManagerInstance::TakeUnwrittenVictim(frame_id_t frame_id) {
+  bool unwritten = unwritten_victims_[frame_id];
+  unwritten_victims_[frame_id] = false;
+  return unwritten;
+}
+
+Page *BufferPoolManagerInstance::TryPinResident(page_id_t page_id) {
+  frame_id_t frame_id{};
+  if (!page_table_.Find(page_id, &frame_id)) {
+    return nullptr;
+  }
+  Page *page = pages_ + frame_id;
+  int pin_count = page->pin_count_;
+  do {
+    if (pin_count == FRAME_RESERVED) {
+      return nullptr;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count + 1));
+
+  // Our pin keeps the frame from being reused, but it may have been given to another page after the lookup.
+  if (page->page_id_ == page_id && !page->io_in_progress_) {
+    ReplacerPin(frame_id);
+    return page;
+  }
+  DropPin(frame_id);
+  return nullptr;
+}
+
+void BufferPoolManagerInstance::PrefetchPgsImp(const std::vector<page_id_t> &page_ids) { StartPrefetch(page_ids); }
+
+size_t BufferPoolManagerInstance::StartPrefetch(const std::vector<page_id_t> &page_ids) {
+  std::vector<DiskRequest> requests;
+  {
+    std::scoped_lock lock{latch_};
+    for (page_id_t page_id : page_ids) {
+      ValidatePageId(page_id);
+      frame_id_t frame_id{};
+      if (page_table_.Find(page_id, &frame_id) || writing_back_.Find(page_id, &frame_id)) {
+        continue;
+      }
+      // A prefetch must not cost a write: only use a free frame or a clean victim, and stop once there is none.
+      if (free_list_.empty()) {
+        auto victims = replacer_->PeekVictims(1);
+        if (victims.empty() || pages_[victims[0]].is_dirty_ || pages_[victims[0]].cleaning_) {
+          break;
+        }
+      }
+      page_id_t victim_page_id{};
+      if (!ReserveFrame(&frame_id, &victim_page_id)) {
+        break;
+      }
+      BUSTUB_ASSERT(victim_page_id == INVALID_PAGE_ID, "a prefetch evicted a page that still had to be written");
+
+      // The prefetch holds a pin until the read lands, fetches of the page wait on io_in_progress_ meanwhile. Being
+      // prefetched is not an access, so the replacer is only told about the load.
+      page_table_.Insert(page_id, frame_id);
+      Page *page = pages_ + frame_id;
+      replacer_->Admit(frame_id, page_id);
+      page->page_id_ = page_id;
+      page->is_dirty_ = false;
+      page->io_in_progress_ = true;
+      page->pin_count_ = 1;
+      requests.push_back({false, page_id, page->data_});
+    }
+    num_prefetching_ += requests.size();
+  }
+  size_t num_requests = requests.size();
+  if (num_requests == 0) {
+    return 0;
+  }
+
+  metrics_.prefetched_pages_.Add(num_requests);
+  // the disk manager merges reads of consecutive pages, which only works if they are submitted in page order
+  std::sort(requests.begin(), requests.end(),
+            [](const DiskRequest &a, const DiskRequest &b) { return a.page_id_ < b.page_id_; });
+  // nobody waits for the batch as a whole, each frame is released as soon as its own read completes
+  disk_manager_->SubmitBatch(std::move(requests), [this](const DiskRequest &request) { FinishPrefetch(request); });
+  return num_requests;
+}
+
+void BufferPoolManagerInstance::FinishPrefetch(const DiskRequest &request) {
+  {
+    std::scoped_lock lock{latch_};
+    frame_id_t frame_id = frame_arena_.GetFrameId(request.data_);
+    Page *page = pages_ + frame_id;
+    if (request.corrupt_) {
+      // a fetch of the page reads it again and reports the failure
+      page_table_.Erase(page->page_id_);
+      page->page_id_ = INVALID_PAGE_ID;
+    }
+    page->io_in_progress_ = false;
+    DropPin(frame_id);
+    num_prefetching_--;
+  }
+  io_cv_.notify_all();
+}
+
+std::vector<page_id_t> BufferPoolManagerInstance::GetHotPgsImp(size_t max_pages) {
+  std::vector<page_id_t> page_ids;
+  std::vector<bool> listed(pool_size_, false);
+  std::scoped_lock lock{latch_};
+  auto list = [&](frame_id_t frame_id) {
+    Page *page = pages_ + frame_id;
+    if (listed[frame_id] || page_ids.size() >= max_pages || page->pin_count_ == FRAME_RESERVED ||
+        page->io_in_progress_ || page->page_id_ == INVALID_PAGE_ID) {
+      return;
+    }
+    listed[frame_id] = true;
+    page_ids.push_back(page->page_id_);
+  };
+  // pinned pages are being used right now
+  for (size_t i = 0; i < pool_size_; ++i) {
+    if (pages_[i].pin_count_ > 0) {
+      list(static_cast<frame_id_t>(i));
+    }
+  }
+  // the replacer evicts the coldest page first
+  auto victims = replacer_->PeekVictims(pool_size_);
+  for (auto it = victims.rbegin(); it != victims.rend(); ++it) {
+    list(*it);
+  }
+  // whatever the replacer could not order (pins and unpins race with the latch) goes last
+  for (size_t i = 0; i < pool_size_; ++i) {
+    list(static_cast<frame_id_t>(i));
+  }
+  return page_ids;
+}
+
+std::vector<std::pair<page_id_t, lsn_t>> BufferPoolManagerInstance::GetDirtyPgsImp() {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  std::scoped_lock lock{latch_};
+  for (size_t i = 0; i < pool_size_; ++i) {
+    lsn_t rec_lsn = pages_[i].rec_lsn_;
+    if (rec_lsn != INVALID_LSN) {
+      dirty_pages.emplace_back(pages_[i].page_id_, rec_lsn);
+    }
+  }
+  dirty_pages.insert(dirty_pages.end(), writing_back_rec_lsns_.begin(), writing_back_rec_lsns_.end());
+  return dirty_pages;
+}
+
+size_t BufferPoolManagerInstance::WarmUpImp(const std::vector<page_id_t> &page_ids) {
+  std::vector<page_id_t> warm_page_ids;
+  warm_page_ids.reserve(std::min(page_ids.size(), pool_size_));
+  for (page_id_t page_id : page_ids) {
+    if (warm_page_ids.size() >= pool_size_) {
+      break;
+    }
+    // the list may be older than the last pages deleted before the restart
+    if (disk_manager_->IsAllocated(page_id)) {
+      warm_page_ids.push_back(page_id);
+    }
+  }
+  std::reverse(warm_page_ids.begin(), warm_page_ids.end());
+  size_t num_read = StartPrefetch(warm_page_ids);
+
+  std::unique_lock lock{latch_};
+  io_cv_.wait(lock, [this] { return num_prefetching_ == 0; });
+  // the reads complete in page order, replay the saved order so that the replacer sees the hottest page last
+  for (page_id_t page_id : warm_page_ids) {
+    frame_id_t frame_id{};
+    int pin_count = 0;
+    // an access like any other, lock-free fetches may pin the page at the same time
+    if (page_table_.Find(page_id, &frame_id) && pages_[frame_id].pin_count_.compare_exchange_strong(pin_count, 1)) {
+      ReplacerPin(frame_id);
+      DropPin(frame_id);
+    }
+  }
+  return num_read;
+}
+
+BufferPoolStats BufferPoolManagerInstance::GetStatsImp() {
+  BufferPoolStats stats;
+  metrics_.Snapshot(&stats);
+  stats.replacer_size_ = replacer_->Size();
+  std::scoped_lock lock{latch_};
+  stats.resident_pages_ = page_table_.Size();
+  stats.free_frames_ = free_list_.size();
+  return stats;
+}
+
+void BufferPoolManagerInstance::FlushLog(lsn_t lsn) {
+  if (enable_logging && log_manager_ != nullptr && lsn != INVALID_LSN) {
+    log_manager_->Flush(lsn);
+  }
+}
+
+void BufferPoolManagerInstance::ForgetRecLsn(Page *page) {
+  // A writer pins the page before it sets the page LSN: if the page is unpinned and clean after the recLSN is gone,
+  // every change since is still to come and sets a new recLSN.
+  lsn_t rec_lsn = page->rec_lsn_.exchange(INVALID_LSN);
+  if (rec_lsn == INVALID_LSN || (page->pin_count_ == 0 && !page->is_dirty_)) {
+    return;
+  }
+  lsn_t current = INVALID_LSN;
+  while (!page->rec_lsn_.compare_exchange_weak(current, rec_lsn)) {
+    if (current != INVALID_LSN && current <= rec_lsn) {
+      break;
+    }
+  }
+}
+
+void BufferPoolManagerInstance::WriteVictim(page_id_t victim_page_id, Page *page) {
+  FlushLog(page->GetLSN());
+  auto start = std::chrono::steady_clock::now();
+  disk_manager_->WritePage(victim_page_id, page->data_);
+  metrics_.write_ns_.Record(NanosSince(start));
+}
+
 bool BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) {
   // 0.   Make sure you call DeallocatePage!
   // 1.   Search the page table for the requested page (P).
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  std::scoped_lock lock{latch_};
-  if (page_table_.count(page_id) == 0) {
-    return true;
+  std::unique_lock lock{latch_};
+  frame_id_t frame_id{};
+  while (true) {
+    if (!page_table_.Find(page_id, &frame_id)) {
+      // an evicted copy still on its way to disk would land on the page after it has been reallocated
+      if (writing_back_.Find(page_id, &frame_id)) {
+        io_cv_.wait(lock);
+        continue;
+      }
+      DeallocatePage(page_id);
+      return true;
+    }
+    if (!pages_[frame_id].io_in_progress_ && !pages_[frame_id].cleaning_) {
+      break;
+    }
+    io_cv_.wait(lock);
   }
 
-  frame_id_t frame_id = page_table_[page_id];
+  // claiming the frame keeps lock-free fetches from pinning it from here on
   Page *page = pages_ + frame_id;
-  if (page->pin_count_ != 0) {
+  if (!ClaimFrame(frame_id)) {
     return false;
   }
 
-  if (page->is_dirty_) {
-    disk_manager_->WritePage(page_id, page->data_);
-  }
+  // the contents of a deleted page are never read again, so even a dirty one is not written out
   DeallocatePage(page_id);
 
-  page_table_.erase(page_id);
-  free_list_.emplace_back(frame_id);
-  new (page) Page();
+  // the frame is reused from the free list, claiming it took it out of the replacer
+  page_table_.Erase(page_id);
+  free_list_.push_back(frame_id);
+  num_free_frames_++;
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  page->rec_lsn_ = INVALID_LSN;
+  page->ResetMemory();
   return true;
 }
 
 bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) {
-  std::scoped_lock lock{latch_};
-  if (page_table_.count(page_id) == 0) {
-    return false;
+  std::unique_lock lock{latch_, std::defer_lock};
+  frame_id_t frame_id{};
+  if (!page_table_.Find(page_id, &frame_id)) {
+    // the lock-free lookup can miss a page whose slot is being moved, only a miss under the latch is final
+    lock.lock();
+    if (!page_table_.Find(page_id, &frame_id)) {
+      return false;
+    }
+  }
+
+  // The caller's pin keeps the frame holding the page, the page id only changes under a bogus unpin.
+  Page *page = pages_ + frame_id;
+  int pin_count = page->pin_count_;
+  while (pin_count > 0 && page->page_id_ == page_id) {
+    // mark the page dirty while still pinned, an evictor must see it once the pin is gone
+    if (is_dirty) {
+      page->is_dirty_ = true;
+    }
+    if (page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1)) {
+      if (pin_count == 1) {
+        ReplacerUnpin(frame_id);
+      }
+      return true;
+    }
   }
+  return false;
+}
 
-  frame_id_t frame_id = page_table_[page_id];
+void BufferPoolManagerInstance::UnpinFrameImp(Page *page, bool is_dirty) {
+  auto frame_id = static_cast<frame_id_t>(page - pages_);
+  BUSTUB_ASSERT(frame_id >= 0 && static_cast<size_t>(frame_id) < pool_size_, "the page is not a frame of this pool");
+  // the caller's pin keeps the frame holding the page
+  if (is_dirty) {
+    page->is_dirty_ = true;
+  }
+  int pin_count = page->pin_count_.fetch_sub(1);
+  BUSTUB_ASSERT(pin_count > 0, "the page was not pinned");
+  if (pin_count == 1) {
+    ReplacerUnpin(frame_id);
+  }
+}
+
+bool BufferPoolManagerInstance::ClaimFrame(frame_id_t frame_id) {
   Page *page = pages_ + frame_id;
-  if (page->pin_count_ <= 0) {
+  std::scoped_lock pin_lock{page->pin_latch_};
+  int pin_count = 0;
+  if (!page->pin_count_.compare_exchange_strong(pin_count, FRAME_RESERVED)) {
     return false;
   }
+  // the last unpin may have put the frame back after the replacer handed it out, it must not be handed out twice
+  replacer_->Pin(frame_id);
+  return true;
+}
+
+void BufferPoolManagerInstance::ReplacerPin(frame_id_t frame_id) {
+  std::scoped_lock pin_lock{pages_[frame_id].pin_latch_};
+  replacer_->Pin(frame_id);
+}
 
-  page->is_dirty_ |= is_dirty;
-  if (--page->pin_count_ == 0) {
+void BufferPoolManagerInstance::ReplacerUnpin(frame_id_t frame_id) {
+  Page *page = pages_ + frame_id;
+  std::scoped_lock pin_lock{page->pin_latch_};
+  // a pin taken since the count dropped to zero, or a claim, tells the replacer after us or already has
+  if (page->pin_count_ == 0) {
     replacer_->Unpin(frame_id);
   }
-  return true;
+}
+
+void BufferPoolManagerInstance::DropPin(frame_id_t frame_id) {
+  if (pages_[frame_id].pin_count_.fetch_sub(1) == 1) {
+    ReplacerUnpin(frame_id);
+  }
+}
+
+void BufferPoolManagerInstance::RunPageCleaner(double high_watermark, double low_watermark) {
+  BUSTUB_ASSERT(low_watermark <= high_watermark, "the page cleaner must stop below the point it starts at");
+  std::scoped_lock lock{latch_};
+  if (cleaner_running_) {
+    return;
+  }
+  cleaner_high_dirty_ = static_cast<size_t>(high_watermark * pool_size_);
+  cleaner_low_dirty_ = static_cast<size_t>(low_watermark * pool_size_);
+  cleaner_running_ = true;
+  cleaner_thread_ = std::thread(&BufferPoolManagerInstance::PageCleanerLoop, this);
+}
+
+void BufferPoolManagerInstance::StopPageCleaner() {
+  {
+    std::scoped_lock lock{latch_};
+    if (!cleaner_running_) {
+      return;
+    }
+    cleaner_running_ = false;
+  }
+  cleaner_cv_.notify_one();
+  cleaner_thread_.join();
+}
+
+void BufferPoolManagerInstance::PageCleanerLoop() {
+  std::unique_lock lock{latch_};
+  while (cleaner_running_) {
+    cleaner_cv_.wait_for(lock, page_cleaner_interval);
+    if (!cleaner_running_) {
+      break;
+    }
+    size_t num_dirty = 0;
+    for (size_t i = 0; i < pool_size_; ++i) {
+      num_dirty += pages_[i].is_dirty_ ? 1 : 0;
+    }
+    if (num_dirty == 0 || num_dirty < cleaner_high_dirty_) {
+      continue;
+    }
+    lock.unlock();
+    CleanPages(num_dirty - cleaner_low_dirty_);
+    lock.lock();
+  }
+}
+
+size_t BufferPoolManagerInstance::CleanPages(size_t max_pages) {
+  std::vector<DiskRequest> requests;
+  std::vector<Page *> cleaning;
+  lsn_t max_lsn = INVALID_LSN;
+  {
+    std::scoped_lock lock{latch_};
+    for (frame_id_t frame_id : replacer_->PeekVictims(pool_size_)) {
+      if (cleaning.size() >= max_pages) {
+        break;
+      }
+      Page *page = pages_ + frame_id;
+      if (!page->is_dirty_ || page->pin_count_ > 0 || page->io_in_progress_ || page->cleaning_) {
+        continue;
+      }
+      // A lock-free fetch may pin the page at any moment, the read latch keeps it from changing the page before the
+      // write has it all. Waiting for the latch here could deadlock with a writer that needs latch_, so a page that
+      // somebody latched after all is left for the next round.
+      if (!page->TryRLatch()) {
+        continue;
+      }
+      // The frame stays resident and in the replacer, so cleaning does not change its eviction order. Anybody who
+      // dirties it again marks it dirty on unpin; anybody who evicts it waits for cleaning_ before reusing the frame.
+      page->cleaning_ = true;
+      page->is_dirty_ = false;
+      requests.push_back({true, page->page_id_, page->data_});
+      max_lsn = std::max(max_lsn, page->GetLSN());
+      cleaning.push_back(page);
+    }
+    num_cleaning_ += cleaning.size();
+  }
+  if (cleaning.empty()) {
+    return 0;
+  }
+
+  std::exception_ptr error = WriteCleaning(std::move(requests), cleaning, max_lsn);
+  for (Page *page : cleaning) {
+    page->RUnlatch();
+  }
+  if (error != nullptr) {
+    // the pages whose writes failed are dirty again, the next round retries them
+    try {
+      std::rethrow_exception(error);
+    } catch (const Exception &e) {
+      LOG_WARN("the page cleaner could not write out pages: %s", e.what());
+    }
+    return 0;
+  }
+  metrics_.background_writes_.Add(cleaning.size());
+  return cleaning.size();
+}
+
+std::exception_ptr BufferPoolManagerInstance::WriteCleaning(std::vector<DiskRequest> requests,
+                                                            const std::vector<Page *> &pages, lsn_t max_lsn) {
+  std::vector<page_id_t> page_ids;
+  page_ids.reserve(requests.size());
+  for (const DiskRequest &request : requests) {
+    page_ids.push_back(request.page_id_);
+  }
+  std::vector<frame_id_t> failed;
+  std::mutex failed_latch;
+  std::exception_ptr error;
+  try {
+    FlushLog(max_lsn);
+    // hand every page to the disk manager at once so they can be written in parallel
+    auto done = disk_manager_->SubmitBatch(std::move(requests), [this, &failed, &failed_latch](const DiskRequest &r) {
+      if (r.error_ != nullptr) {
+        std::scoped_lock failed_lock{failed_latch};
+        failed.push_back(frame_arena_.GetFrameId(r.data_));
+      }
+    });
+    done.get();
+  } catch (const Exception &e) {
+    error = std::current_exception();
+    if (failed.empty()) {
+      // the log could not be flushed, so none of the pages was written
+      for (Page *page : pages) {
+        failed.push_back(static_cast<frame_id_t>(page - pages_));
+      }
+    }
+  }
+  {
+    std::scoped_lock lock{latch_};
+    for (frame_id_t frame_id : failed) {
+      size_t i = std::find(pages.begin(), pages.end(), pages_ + frame_id) - pages.begin();
+      RedirtyUnwritten(pages_ + frame_id, page_ids[i]);
+    }
+    for (Page *page : pages) {
+      page->cleaning_ = false;
+      ForgetRecLsn(page);
+    }
+    num_cleaning_ -= pages.size();
+  }
+  io_cv_.notify_all();
+  return error;
+}
+
+void BufferPoolManagerInstance::RedirtyUnwritten(Page *page, page_id_t page_id) {
+  frame_id_t frame_id{};
+  if (page_table_.Find(page_id, &frame_id) && pages_ + frame_id == page) {
+    page->is_dirty_ = true;
+    return;
+  }
+  // the page was evicted while it was being written, its evictor waits for cleaning_ and then writes it out itself
+  unwritten_victims_[page - pages_] = true;
 }
 
 page_id_t BufferPoolManagerInstance::AllocatePage() {
-  const page_id_t next_page_id = next_page_id_;
-  next_page_id_ += num_instances_;
-  ValidatePageId(next_page_id);
-  return next_page_id;
+  // the disk manager hands out the lowest free page of this BPI's stripe, reusing deallocated pages first
+  const page_id_t page_id = disk_manager_->AllocatePage(num_instances_, instance_index_);
+  ValidatePageId(page_id);
+  return page_id;
 }
 
 void BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const {
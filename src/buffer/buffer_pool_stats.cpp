@@ -0,0 +1,133 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.cpp
+//
+// Identification: src/buffer/buffer_pool_stats.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_stats.h"
+
+#include <sstream>
+
+namespace bustub {
+
+uint64_t ShardedCounter::Load() const {
+  uint64_t sum = 0;
+  for (const auto &shard : shards_) {
+    sum += shard.value_.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+uint64_t HistogramSnapshot::Count() const {
+  uint64_t count = 0;
+  for (uint64_t bucket : buckets_) {
+    count += bucket;
+  }
+  return count;
+}
+
+double HistogramSnapshot::Mean() const {
+  uint64_t count = Count();
+  return count == 0 ? 0 : static_cast<double>(sum_) / count;
+}
+
+uint64_t HistogramSnapshot::Percentile(double fraction) const {
+  uint64_t count = Count();
+  if (count == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(fraction * count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+    seen += buckets_[i];
+    if (seen > 0 && seen >= rank) {
+      return i == 0 ? 0 : (UINT64_C(1) << i) - 1;
+    }
+  }
+  return (UINT64_C(1) << (NUM_BUCKETS - 1)) - 1;
+}
+
+HistogramSnapshot &HistogramSnapshot::operator+=(const HistogramSnapshot &other) {
+  sum_ += other.sum_;
+  for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  return *this;
+}
+
+std::string HistogramSnapshot::ToString() const {
+  std::ostringstream os;
+  os << "count " << Count() << ", mean " << static_cast<uint64_t>(Mean()) << ", p50 <= " << Percentile(0.5)
+     << ", p99 <= " << Percentile(0.99);
+  return os.str();
+}
+
+HistogramSnapshot Histogram::Snapshot() const {
+  HistogramSnapshot snapshot;
+  for (const auto &shard : shards_) {
+    for (size_t i = 0; i < HistogramSnapshot::NUM_BUCKETS; ++i) {
+      snapshot.buckets_[i] += shard.buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.sum_ += shard.sum_.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+double BufferPoolStats::HitRatio() const {
+  uint64_t fetches = hits_ + misses_;
+  return fetches == 0 ? 0 : static_cast<double>(hits_) / fetches;
+}
+
+BufferPoolStats &BufferPoolStats::operator+=(const BufferPoolStats &other) {
+  hits_ += other.hits_;
+  misses_ += other.misses_;
+  evictions_ += other.evictions_;
+  dirty_evictions_ += other.dirty_evictions_;
+  background_writes_ += other.background_writes_;
+  prefetched_pages_ += other.prefetched_pages_;
+  pin_wait_ns_ += other.pin_wait_ns_;
+  latch_wait_ns_ += other.latch_wait_ns_;
+  latch_hold_ns_ += other.latch_hold_ns_;
+  read_ns_ += other.read_ns_;
+  write_ns_ += other.write_ns_;
+  replacer_size_ += other.replacer_size_;
+  resident_pages_ += other.resident_pages_;
+  free_frames_ += other.free_frames_;
+  return *this;
+}
+
+std::string BufferPoolStats::ToString() const {
+  std::ostringstream os;
+  os << "hits " << hits_ << ", misses " << misses_ << " (hit ratio " << HitRatio() << ")\n"
+     << "evictions " << evictions_ << " (dirty " << dirty_evictions_ << "), background writes " << background_writes_
+     << ", prefetched " << prefetched_pages_ << "\n"
+     << "resident " << resident_pages_ << ", free " << free_frames_ << ", evictable " << replacer_size_ << "\n"
+     << "pin wait ns: " << pin_wait_ns_.ToString() << "\n"
+     << "latch wait ns: " << latch_wait_ns_.ToString() << "\n"
+     << "latch hold ns: " << latch_hold_ns_.ToString() << "\n"
+     << "read ns: " << read_ns_.ToString() << "\n"
+     << "write ns: " << write_ns_.ToString();
+  return os.str();
+}
+
+void BufferPoolMetrics::Snapshot(BufferPoolStats *stats) const {
+  stats->hits_ = hits_.Load();
+  stats->misses_ = misses_.Load();
+  stats->evictions_ = evictions_.Load();
+  stats->dirty_evictions_ = dirty_evictions_.Load();
+  stats->background_writes_ = background_writes_.Load();
+  stats->prefetched_pages_ = prefetched_pages_.Load();
+  stats->pin_wait_ns_ = pin_wait_ns_.Snapshot();
+  stats->latch_wait_ns_ = latch_wait_ns_.Snapshot();
+  stats->latch_hold_ns_ = latch_hold_ns_.Snapshot();
+  stats->read_ns_ = read_ns_.Snapshot();
+  stats->write_ns_ = write_ns_.Snapshot();
+}
+
+}  // namespace bustub
@@ -0,0 +1,132 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_warmer.cpp
+//
+// Identification: src/buffer/buffer_pool_warmer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_warmer.h"
+
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+#include "common/logger.h"
+
+namespace bustub {
+
+BufferPoolWarmer::BufferPoolWarmer(BufferPoolManager *buffer_pool_manager, std::string file_name)
+    : buffer_pool_manager_(buffer_pool_manager), file_name_(std::move(file_name)) {}
+
+BufferPoolWarmer::~BufferPoolWarmer() { StopDumpThread(); }
+
+bool BufferPoolWarmer::Dump() {
+  std::vector<page_id_t> page_ids = buffer_pool_manager_->GetHotPages(buffer_pool_manager_->GetPoolSize());
+  auto num_pages = static_cast<uint32_t>(page_ids.size());
+
+  std::scoped_lock lock{file_latch_};
+  std::string tmp_name = file_name_ + ".tmp";
+  {
+    std::ofstream out(tmp_name, std::ios::binary | std::ios::trunc | std::ios::out);
+    out.write(reinterpret_cast<const char *>(&MAGIC), sizeof(MAGIC));
+    out.write(reinterpret_cast<const char *>(&num_pages), sizeof(num_pages));
+    out.write(reinterpret_cast<const char *>(page_ids.data()),
+              static_cast<std::streamsize>(page_ids.size() * sizeof(page_id_t)));
+    out.flush();
+    if (!out) {
+      LOG_WARN("could not write the hot page list to %s", tmp_name.c_str());
+      remove(tmp_name.c_str());
+      return false;
+    }
+  }
+  if (rename(tmp_name.c_str(), file_name_.c_str()) != 0) {
+    LOG_WARN("could not replace the hot page list %s", file_name_.c_str());
+    remove(tmp_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool BufferPoolWarmer::Load(std::vector<page_id_t> *page_ids) {
+  std::ifstream in(file_name_, std::ios::binary | std::ios::in);
+  if (!in) {
+    return false;
+  }
+  uint32_t magic = 0;
+  uint32_t num_pages = 0;
+  in.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char *>(&num_pages), sizeof(num_pages));
+  if (!in || magic != MAGIC) {
+    LOG_WARN("%s is not a hot page list, ignoring it", file_name_.c_str());
+    return false;
+  }
+  page_ids->resize(num_pages);
+  in.read(reinterpret_cast<char *>(page_ids->data()), static_cast<std::streamsize>(num_pages * sizeof(page_id_t)));
+  // a truncated list, or one with a trailing remainder, was not written by Dump
+  if (!in || in.peek() != std::ifstream::traits_type::eof()) {
+    LOG_WARN("the hot page list %s is damaged, ignoring it", file_name_.c_str());
+    page_ids->clear();
+    return false;
+  }
+  for (page_id_t page_id : *page_ids) {
+    if (page_id < 0) {
+      LOG_WARN("the hot page list %s is damaged, ignoring it", file_name_.c_str());
+      page_ids->clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t BufferPoolWarmer::WarmUp() {
+  std::vector<page_id_t> page_ids;
+  if (!Load(&page_ids) || page_ids.empty()) {
+    return 0;
+  }
+  size_t num_read = buffer_pool_manager_->WarmUp(page_ids);
+  LOG_INFO("warmed up the buffer pool with %zu of %zu saved pages", num_read, page_ids.size());
+  return num_read;
+}
+
+void BufferPoolWarmer::RunDumpThread() {
+  std::scoped_lock lock{latch_};
+  if (dump_running_) {
+    return;
+  }
+  dump_running_ = true;
+  dump_thread_ = std::thread(&BufferPoolWarmer::DumpLoop, this);
+}
+
+void BufferPoolWarmer::StopDumpThread() {
+  {
+    std::scoped_lock lock{latch_};
+    if (!dump_running_) {
+      return;
+    }
+    dump_running_ = false;
+  }
+  dump_cv_.notify_one();
+  dump_thread_.join();
+  // the list as of shutdown is the best guess for what the next run will use
+  Dump();
+}
+
+void BufferPoolWarmer::DumpLoop() {
+  std::unique_lock lock{latch_};
+  while (dump_running_) {
+    dump_cv_.wait_for(lock, buffer_pool_dump_interval);
+    if (!dump_running_) {
+      break;
+    }
+    lock.unlock();
+    Dump();
+    lock.lock();
+  }
+}
+
+}  // namespace bustub
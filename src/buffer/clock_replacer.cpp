@@ -14,16 +14,61 @@
 
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages) : num_pages_(num_pages), states_(num_pages) {}
 
 ClockReplacer::~ClockReplacer() = default;
 
-bool ClockReplacer::Victim(frame_id_t *frame_id) { return false; }
+bool ClockReplacer::Victim(frame_id_t *frame_id) {
+  // Two turns of the hand clear every reference bit and then reach an unreferenced frame, unless concurrent Unpins keep
+  // setting them again; the sweep is bounded so that it cannot spin.
+  for (size_t steps = 0; steps < 2 * num_pages_ && size_ > 0; ++steps) {
+    size_t position = hand_.fetch_add(1) % num_pages_;
+    auto &state = states_[position];
+    uint8_t current = state.load();
+    if ((current & IN_REPLACER) == 0) {
+      continue;
+    }
+    if ((current & REFERENCED) != 0) {
+      // second chance; if we lose the race the frame was pinned or touched again, either way it is not our victim
+      state.compare_exchange_strong(current, IN_REPLACER);
+      continue;
+    }
+    if (state.compare_exchange_strong(current, 0)) {
+      size_--;
+      *frame_id = static_cast<frame_id_t>(position);
+      return true;
+    }
+  }
+  return false;
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+void ClockReplacer::Pin(frame_id_t frame_id) {
+  if ((states_[frame_id].exchange(0) & IN_REPLACER) != 0) {
+    size_--;
+  }
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+void ClockReplacer::Unpin(frame_id_t frame_id) {
+  if ((states_[frame_id].exchange(IN_REPLACER | REFERENCED) & IN_REPLACER) == 0) {
+    size_++;
+  }
+}
 
-size_t ClockReplacer::Size() { return 0; }
+size_t ClockReplacer::Size() { return size_; }
+
+std::vector<frame_id_t> ClockReplacer::PeekVictims(size_t max_frames) {
+  // frames the hand would take on its first turn, then the ones that only lose their reference bit on it
+  std::vector<frame_id_t> frames;
+  size_t start = hand_ % num_pages_;
+  for (uint8_t wanted : {IN_REPLACER, static_cast<uint8_t>(IN_REPLACER | REFERENCED)}) {
+    for (size_t i = 0; i < num_pages_ && frames.size() < max_frames; ++i) {
+      size_t position = (start + i) % num_pages_;
+      if (states_[position].load() == wanted) {
+        frames.push_back(static_cast<frame_id_t>(position));
+      }
+    }
+  }
+  return frames;
+}
 
 }  // namespace bustub
@@ -0,0 +1,50 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// extent_allocator.cpp
+//
+// Identification: src/buffer/extent_allocator.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/extent_allocator.h"
+
+#include <algorithm>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+ExtentAllocator::ExtentAllocator(BufferPoolManager *buffer_pool_manager, uint32_t max_extent_pages,
+                                 tablespace_id_t tablespace_id)
+    : buffer_pool_manager_(buffer_pool_manager),
+      max_extent_pages_(max_extent_pages),
+      tablespace_id_(tablespace_id),
+      extent_pages_(std::min(MIN_EXTENT_PAGES, max_extent_pages)) {
+  BUSTUB_ASSERT(max_extent_pages > 0 && (max_extent_pages & (max_extent_pages - 1)) == 0,
+                "extent size must be a power of two");
+}
+
+Page *ExtentAllocator::NewPage(page_id_t *page_id) {
+  std::scoped_lock lock{latch_};
+  if (next_page_id_ == end_page_id_) {
+    page_id_t first_page_id = buffer_pool_manager_->AllocateExtent(extent_pages_, tablespace_id_);
+    if (first_page_id == INVALID_PAGE_ID) {
+      return buffer_pool_manager_->NewPage(page_id);
+    }
+    next_page_id_ = first_page_id;
+    end_page_id_ = first_page_id + static_cast<page_id_t>(extent_pages_);
+    extent_pages_ = std::min(extent_pages_ * 2, max_extent_pages_);
+  }
+  // if the pool is full, the page stays the next one to create
+  Page *page = buffer_pool_manager_->NewPageInExtent(next_page_id_);
+  if (page != nullptr) {
+    *page_id = next_page_id_++;
+  }
+  return page;
+}
+
+}  // namespace bustub
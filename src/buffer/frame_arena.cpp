@@ -0,0 +1,56 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.cpp
+//
+// Identification: src/buffer/frame_arena.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <sys/mman.h>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+FrameArena::FrameArena(size_t num_frames, HugePagePolicy huge_pages, size_t frame_size)
+    : data_(nullptr),
+      frame_size_(frame_size),
+      size_(num_frames * frame_size),
+      mapped_size_(size_),
+      huge_pages_(huge_pages) {
+  // mmap does not take empty mappings, but an empty pool still needs a valid arena
+  if (mapped_size_ == 0) {
+    mapped_size_ = frame_size_;
+  }
+  void *data = MAP_FAILED;
+  if (huge_pages_ == HugePagePolicy::EXPLICIT) {
+    size_t huge_size = (mapped_size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    data = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      mapped_size_ = huge_size;
+    } else {
+      LOG_WARN("not enough huge pages reserved for %zu frames, using transparent huge pages", num_frames);
+      huge_pages_ = HugePagePolicy::TRANSPARENT;
+    }
+  }
+  if (data == MAP_FAILED) {
+    data = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "can't map the buffer pool frames");
+    }
+    // only advice, the kernel may not support transparent huge pages or have them disabled
+    madvise(data, mapped_size_, huge_pages_ == HugePagePolicy::NEVER ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+  }
+  data_ = static_cast<char *>(data);
+}
+
+FrameArena::~FrameArena() { munmap(data_, mapped_size_); }
+
+}  // namespace bustub
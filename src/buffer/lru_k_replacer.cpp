@@ -0,0 +1,108 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k, size_t correlated_period)
+    : k_(k), correlated_period_(correlated_period == 0 ? num_pages : correlated_period) {
+  BUSTUB_ASSERT(k > 0, "LRU-K needs at least one access to measure from");
+  frames_.reserve(num_pages);
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+LRUKReplacer::eviction_key_t LRUKReplacer::EvictionKey(frame_id_t frame_id, const FrameInfo &info) const {
+  if (info.history_.empty()) {
+    return {info.admitted_at_, frame_id};
+  }
+  // with fewer than K accesses this is the first access, otherwise the K-th most recent one
+  return {info.history_.front(), frame_id};
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id, FrameInfo *info) {
+  if (!info->evictable_) {
+    return;
+  }
+  auto &set = info->history_.size() < k_ ? cold_ : hot_;
+  set.erase(EvictionKey(frame_id, *info));
+  info->evictable_ = false;
+}
+
+bool LRUKReplacer::Victim(frame_id_t *frame_id) {
+  std::scoped_lock lock{latch_};
+  auto &set = cold_.empty() ? hot_ : cold_;
+  if (set.empty()) {
+    return false;
+  }
+  *frame_id = set.begin()->second;
+  set.erase(set.begin());
+  frames_.erase(*frame_id);
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::scoped_lock lock{latch_};
+  FrameInfo &info = frames_[frame_id];
+  Remove(frame_id, &info);
+
+  uint64_t now = ++current_timestamp_;
+  if (!info.history_.empty() && now - info.history_.back() <= correlated_period_) {
+    // still the same burst of accesses
+    info.history_.back() = now;
+    return;
+  }
+  info.history_.push_back(now);
+  if (info.history_.size() > k_) {
+    info.history_.pop_front();
+  }
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::scoped_lock lock{latch_};
+  FrameInfo &info = frames_[frame_id];
+  if (info.evictable_) {
+    return;
+  }
+  auto &set = info.history_.size() < k_ ? cold_ : hot_;
+  set.insert(EvictionKey(frame_id, info));
+  info.evictable_ = true;
+}
+
+void LRUKReplacer::Admit(frame_id_t frame_id, page_id_t page_id) {
+  std::scoped_lock lock{latch_};
+  FrameInfo &info = frames_[frame_id];
+  Remove(frame_id, &info);
+  info.history_.clear();
+  info.admitted_at_ = current_timestamp_;
+}
+
+size_t LRUKReplacer::Size() {
+  std::scoped_lock lock{latch_};
+  return cold_.size() + hot_.size();
+}
+
+std::vector<frame_id_t> LRUKReplacer::PeekVictims(size_t max_frames) {
+  std::scoped_lock lock{latch_};
+  std::vector<frame_id_t> frames;
+  for (const auto *set : {&cold_, &hot_}) {
+    for (auto it = set->begin(); it != set->end() && frames.size() < max_frames; ++it) {
+      frames.push_back(it->second);
+    }
+  }
+  return frames;
+}
+
+}  // namespace bustub
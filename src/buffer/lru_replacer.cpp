@@ -12,52 +12,72 @@
 
 #include "buffer/lru_replacer.h"
 
+#include "common/macros.h"
+
 namespace bustub {
 
-LRUReplacer::LRUReplacer(size_t num_pages) {}
+LRUReplacer::LRUReplacer(size_t num_pages)
+    : head_(static_cast<frame_id_t>(num_pages)),
+      prev_(num_pages + 1, head_),
+      next_(num_pages + 1, head_),
+      in_list_(num_pages, false) {}
 
 LRUReplacer::~LRUReplacer() = default;
 
-bool LRUReplacer::Victim(frame_id_t *frame_id) {
-  if (lst_.empty()) {
-    return false;
-  }
+void LRUReplacer::Remove(frame_id_t frame_id) {
+  next_[prev_[frame_id]] = next_[frame_id];
+  prev_[next_[frame_id]] = prev_[frame_id];
+  in_list_[frame_id] = false;
+  size_--;
+}
 
+bool LRUReplacer::Victim(frame_id_t *frame_id) {
   std::scoped_lock lock{latch_};
-  if (lst_.empty()) {
+  if (size_ == 0) {
     return false;
   }
-  *frame_id = lst_.front();
-  lst_.pop_front();
-  frame_table_.erase(*frame_id);
+  *frame_id = next_[head_];
+  Remove(*frame_id);
   return true;
 }
 
 void LRUReplacer::Pin(frame_id_t frame_id) {
-  if (frame_table_.count(frame_id) == 0) {
-    return;
-  }
-
   std::scoped_lock lock{latch_};
-  if (frame_table_.count(frame_id) == 0) {
+  BUSTUB_ASSERT(frame_id >= 0 && frame_id < head_, "frame id out of range");
+  if (!in_list_[frame_id]) {
     return;
   }
-  lst_.erase(frame_table_[frame_id]);
-  frame_table_.erase(frame_id);
+  Remove(frame_id);
 }
 
 void LRUReplacer::Unpin(frame_id_t frame_id) {
-  if (frame_table_.count(frame_id) != 0) {
+  std::scoped_lock lock{latch_};
+  BUSTUB_ASSERT(frame_id >= 0 && frame_id < head_, "frame id out of range");
+  if (in_list_[frame_id]) {
     return;
   }
+  // append at the most recently used end
+  prev_[frame_id] = prev_[head_];
+  next_[frame_id] = head_;
+  next_[prev_[head_]] = frame_id;
+  prev_[head_] = frame_id;
+  in_list_[frame_id] = true;
+  size_++;
+}
 
+size_t LRUReplacer::Size() {
   std::scoped_lock lock{latch_};
-  if (frame_table_.count(frame_id) != 0) {
-    return;
-  }
-  frame_table_[frame_id] = lst_.insert(lst_.end(), frame_id);
+  return size_;
 }
 
-size_t LRUReplacer::Size() { return lst_.size(); }
+std::vector<frame_id_t> LRUReplacer::PeekVictims(size_t max_frames) {
+  std::scoped_lock lock{latch_};
+  std::vector<frame_id_t> frames;
+  for (frame_id_t frame_id = next_[head_]; frame_id != head_ && frames.size() < max_frames;
+       frame_id = next_[frame_id]) {
+    frames.push_back(frame_id);
+  }
+  return frames;
+}
 
 }  // namespace bustub
@@ -0,0 +1,113 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard.cpp
+//
+// Identification: src/buffer/page_guard.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/page_guard.h"
+
+#include <utility>
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace bustub {
+
+BasicPageGuard::BasicPageGuard(BasicPageGuard &&that) noexcept
+    : bpm_(that.bpm_), page_(that.page_), is_dirty_(that.is_dirty_) {
+  that.bpm_ = nullptr;
+  that.page_ = nullptr;
+  that.is_dirty_ = false;
+}
+
+BasicPageGuard &BasicPageGuard::operator=(BasicPageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    std::swap(bpm_, that.bpm_);
+    std::swap(page_, that.page_);
+    std::swap(is_dirty_, that.is_dirty_);
+  }
+  return *this;
+}
+
+void BasicPageGuard::Drop() {
+  if (page_ == nullptr) {
+    return;
+  }
+  bpm_->UnpinFrame(page_, is_dirty_);
+  bpm_ = nullptr;
+  page_ = nullptr;
+  is_dirty_ = false;
+}
+
+ReadPageGuard BasicPageGuard::UpgradeRead() {
+  Page *page = page_;
+  page_ = nullptr;
+  ReadPageGuard guard(bpm_, page);
+  // a reader cannot set the flag itself, but changes made under this guard still have to be written back
+  if (is_dirty_) {
+    guard.guard_.SetDirty();
+  }
+  is_dirty_ = false;
+  return guard;
+}
+
+WritePageGuard BasicPageGuard::UpgradeWrite() {
+  Page *page = page_;
+  page_ = nullptr;
+  WritePageGuard guard(bpm_, page);
+  if (is_dirty_) {
+    guard.SetDirty();
+  }
+  is_dirty_ = false;
+  return guard;
+}
+
+ReadPageGuard::ReadPageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {
+  if (page != nullptr) {
+    page->RLatch();
+  }
+}
+
+ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    guard_ = std::move(that.guard_);
+  }
+  return *this;
+}
+
+void ReadPageGuard::Drop() {
+  if (guard_) {
+    guard_.GetPage()->RUnlatch();
+    guard_.Drop();
+  }
+}
+
+WritePageGuard::WritePageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {
+  if (page != nullptr) {
+    page->WLatch();
+  }
+}
+
+WritePageGuard &WritePageGuard::operator=(WritePageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    guard_ = std::move(that.guard_);
+  }
+  return *this;
+}
+
+void WritePageGuard::Drop() {
+  if (guard_) {
+    guard_.GetPage()->WUnlatch();
+    guard_.Drop();
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,92 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.cpp
+//
+// Identification: src/buffer/page_table.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/page_table.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+PageTable::PageTable(size_t num_frames) {
+  // keep the load factor at or below one half, so probe sequences stay short
+  unsigned bits = 1;
+  while ((size_t{1} << bits) < 2 * num_frames) {
+    ++bits;
+  }
+  capacity_ = size_t{1} << bits;
+  mask_ = capacity_ - 1;
+  shift_ = 64 - bits;
+  slots_ = std::make_unique<std::atomic<uint64_t>[]>(capacity_);
+  for (size_t i = 0; i < capacity_; ++i) {
+    slots_[i].store(EMPTY_SLOT, std::memory_order_relaxed);
+  }
+}
+
+bool PageTable::Find(page_id_t page_id, frame_id_t *frame_id) const {
+  size_t home = Home(page_id);
+  for (size_t i = 0; i < capacity_; ++i) {
+    uint64_t slot = slots_[(home + i) & mask_].load(std::memory_order_acquire);
+    if (slot == EMPTY_SLOT) {
+      return false;
+    }
+    if (SlotPageId(slot) == page_id) {
+      *frame_id = SlotFrameId(slot);
+      return true;
+    }
+  }
+  return false;
+}
+
+void PageTable::Insert(page_id_t page_id, frame_id_t frame_id) {
+  BUSTUB_ASSERT(size_ < capacity_ / 2, "page table is full");
+  for (size_t i = Home(page_id);; i = (i + 1) & mask_) {
+    if (slots_[i].load(std::memory_order_relaxed) == EMPTY_SLOT) {
+      slots_[i].store(Pack(page_id, frame_id), std::memory_order_release);
+      size_++;
+      return;
+    }
+  }
+}
+
+bool PageTable::Erase(page_id_t page_id) {
+  size_t hole = Home(page_id);
+  while (true) {
+    uint64_t slot = slots_[hole].load(std::memory_order_relaxed);
+    if (slot == EMPTY_SLOT) {
+      return false;
+    }
+    if (SlotPageId(slot) == page_id) {
+      break;
+    }
+    hole = (hole + 1) & mask_;
+  }
+
+  // Backward-shift deletion: pull later entries of the cluster into the hole, so no tombstones are needed. An entry is
+  // copied before its old slot is reused, so a concurrent lookup can only miss it if it had already probed past.
+  for (size_t i = (hole + 1) & mask_;; i = (i + 1) & mask_) {
+    uint64_t slot = slots_[i].load(std::memory_order_relaxed);
+    if (slot == EMPTY_SLOT) {
+      break;
+    }
+    // the entry may move back into the hole unless its home lies between the hole and its current slot
+    size_t home = Home(SlotPageId(slot));
+    if (((i - home) & mask_) >= ((i - hole) & mask_)) {
+      slots_[hole].store(slot, std::memory_order_release);
+      hole = i;
+    }
+  }
+  slots_[hole].store(EMPTY_SLOT, std::memory_order_release);
+  size_--;
+  return true;
+}
+
+}  // namespace bustub
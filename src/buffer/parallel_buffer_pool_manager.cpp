@@ -15,13 +15,16 @@
 namespace bustub {
 
 ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager)
+                                                     LogManager *log_manager, ReplacerType replacer_type,
+                                                     bool numa_aware)
     : num_instances_(num_instances), pool_size_(pool_size) {
   // Allocate and create individual BufferPoolManagerInstances
   instances_.reserve(num_instances);
+  int num_numa_nodes = BufferPoolManagerInstance::GetNumaNodeCount();
   for (size_t i = 0; i < num_instances; ++i) {
-    instances_.emplace_back(
-        std::make_unique<BufferPoolManagerInstance>(pool_size, num_instances, i, disk_manager, log_manager));
+    int numa_node = numa_aware ? static_cast<int>(i % num_numa_nodes) : -1;
+    instances_.emplace_back(std::make_unique<BufferPoolManagerInstance>(pool_size, num_instances, i, disk_manager,
+                                                                        log_manager, replacer_type, numa_node));
   }
 }
 
@@ -48,34 +51,33 @@ bool ParallelBufferPoolManager::UnpinPgImp(page_id_t page_id, bool is_dirty) {
   return GetBufferPoolManager(page_id)->UnpinPage(page_id, is_dirty);
 }
 
+void ParallelBufferPoolManager::UnpinFrameImp(Page *page, bool is_dirty) {
+  GetBufferPoolManager(page->GetPageId())->UnpinFrame(page, is_dirty);
+}
+
 bool ParallelBufferPoolManager::FlushPgImp(page_id_t page_id) {
   // Flush page_id from responsible BufferPoolManagerInstance
   return GetBufferPoolManager(page_id)->FlushPage(page_id);
 }
 
 Page *ParallelBufferPoolManager::NewPgImp(page_id_t *page_id) {
-  // create new page. We will request page allocation in a round robin manner from the underlying
-  // BufferPoolManagerInstances
-  // 1.   From a starting index of the BPMIs, call NewPageImpl until either 1) success and return 2) looped around to
-  // starting index and return nullptr
-  // 2.   Bump the starting index (mod number of instances) to start search at a different BPMI each time this function
-  // is called
-
-  std::lock_guard lock_next_instance{next_instance_latch_};
-  size_t start_point = next_instance_;
-  Page *page = nullptr;
-  while ((page = instances_[next_instance_]->NewPage(page_id)) == nullptr) {
-    if (++next_instance_ >= num_instances_) {
-      next_instance_ = 0;
+  // Create a new page, starting at a different instance on every call so that concurrent callers spread over the
+  // instances instead of queueing on a shared latch. The first pass only tries instances that have a free frame,
+  // judged by their lock-free free frame count; the second pass tries every instance, which then has to evict.
+  size_t start = next_instance_.fetch_add(1, std::memory_order_relaxed);
+  for (bool need_free_frame : {true, false}) {
+    for (size_t i = 0; i < num_instances_; ++i) {
+      auto &instance = instances_[(start + i) % num_instances_];
+      if (need_free_frame && instance->GetFreeFrameCount() == 0) {
+        continue;
+      }
+      Page *page = instance->NewPage(page_id);
+      if (page != nullptr) {
+        return page;
+      }
     }
-    if (next_instance_ == start_point) {
-      return nullptr;
-    }
-  }
-  if (++next_instance_ >= num_instances_) {
-    next_instance_ = 0;
   }
-  return page;
+  return nullptr;
 }
 
 bool ParallelBufferPoolManager::DeletePgImp(page_id_t page_id) {
@@ -90,4 +92,81 @@ void ParallelBufferPoolManager::FlushAllPgsImp() {
   }
 }
 
+void ParallelBufferPoolManager::PrefetchPgsImp(const std::vector<page_id_t> &page_ids) {
+  // split the pages by responsible BufferPoolManagerInstance, so each instance gets a single batch
+  std::vector<std::vector<page_id_t>> instance_page_ids(num_instances_);
+  for (page_id_t page_id : page_ids) {
+    instance_page_ids[page_id % num_instances_].push_back(page_id);
+  }
+  for (size_t i = 0; i < num_instances_; ++i) {
+    if (!instance_page_ids[i].empty()) {
+      instances_[i]->PrefetchPages(instance_page_ids[i]);
+    }
+  }
+}
+
+page_id_t ParallelBufferPoolManager::AllocateExtentImp(uint32_t num_pages, tablespace_id_t tablespace_id) {
+  // the instances share one disk manager, any of them can allocate on behalf of all
+  return instances_[0]->AllocateExtent(num_pages, tablespace_id);
+}
+
+Page *ParallelBufferPoolManager::NewPgInExtentImp(page_id_t page_id) {
+  return GetBufferPoolManager(page_id)->NewPageInExtent(page_id);
+}
+
+std::vector<page_id_t> ParallelBufferPoolManager::GetHotPgsImp(size_t max_pages) {
+  // hotness is only known within an instance, so interleave the instances' lists rank by rank
+  std::vector<std::vector<page_id_t>> instance_page_ids;
+  instance_page_ids.reserve(num_instances_);
+  for (auto &instance : instances_) {
+    instance_page_ids.push_back(instance->GetHotPages(max_pages));
+  }
+  std::vector<page_id_t> page_ids;
+  for (size_t rank = 0; page_ids.size() < max_pages; ++rank) {
+    bool listed = false;
+    for (size_t i = 0; i < num_instances_ && page_ids.size() < max_pages; ++i) {
+      if (rank < instance_page_ids[i].size()) {
+        page_ids.push_back(instance_page_ids[i][rank]);
+        listed = true;
+      }
+    }
+    if (!listed) {
+      break;
+    }
+  }
+  return page_ids;
+}
+
+std::vector<std::pair<page_id_t, lsn_t>> ParallelBufferPoolManager::GetDirtyPgsImp() {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  for (auto &instance : instances_) {
+    auto instance_pages = instance->GetDirtyPageTable();
+    dirty_pages.insert(dirty_pages.end(), instance_pages.begin(), instance_pages.end());
+  }
+  return dirty_pages;
+}
+
+size_t ParallelBufferPoolManager::WarmUpImp(const std::vector<page_id_t> &page_ids) {
+  // splitting keeps the order, so each instance still sees its pages hottest first
+  std::vector<std::vector<page_id_t>> instance_page_ids(num_instances_);
+  for (page_id_t page_id : page_ids) {
+    instance_page_ids[page_id % num_instances_].push_back(page_id);
+  }
+  size_t num_read = 0;
+  for (size_t i = 0; i < num_instances_; ++i) {
+    if (!instance_page_ids[i].empty()) {
+      num_read += instances_[i]->WarmUp(instance_page_ids[i]);
+    }
+  }
+  return num_read;
+}
+
+BufferPoolStats ParallelBufferPoolManager::GetStatsImp() {
+  BufferPoolStats stats;
+  for (auto &instance : instances_) {
+    stats += instance->GetStats();
+  }
+  return stats;
+}
+
 }  // namespace bustub
@@ -0,0 +1,155 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// two_q_replacer.cpp
+//
+// Identification: src/buffer/two_q_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/two_q_replacer.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace bustub {
+
+TwoQReplacer::TwoQReplacer(size_t num_pages, double a1in_fraction, double a1out_fraction)
+    : a1in_target_(std::max<size_t>(1, static_cast<size_t>(a1in_fraction * num_pages))),
+      a1out_size_(static_cast<size_t>(a1out_fraction * num_pages)) {
+  frames_.reserve(num_pages);
+}
+
+TwoQReplacer::~TwoQReplacer() = default;
+
+TwoQReplacer::frame_list_t::iterator TwoQReplacer::FirstEvictable(frame_list_t *queue) {
+  return std::find_if(queue->begin(), queue->end(),
+                      [this](frame_id_t frame_id) { return frames_[frame_id].evictable_; });
+}
+
+TwoQReplacer::frame_list_t *TwoQReplacer::VictimQueue() {
+  if (num_evictable_ == 0) {
+    return nullptr;
+  }
+  // A1in gives up its frames first while it holds more than its share, Am otherwise.
+  if (a1in_.size() > a1in_target_ && FirstEvictable(&a1in_) != a1in_.end()) {
+    return &a1in_;
+  }
+  return FirstEvictable(&am_) != am_.end() ? &am_ : &a1in_;
+}
+
+bool TwoQReplacer::Victim(frame_id_t *frame_id) {
+  std::scoped_lock lock{latch_};
+  frame_list_t *queue = VictimQueue();
+  if (queue == nullptr) {
+    return false;
+  }
+  auto it = FirstEvictable(queue);
+  *frame_id = *it;
+
+  const FrameInfo &info = frames_[*frame_id];
+  if (!info.in_am_ && info.page_id_ != INVALID_PAGE_ID && a1out_size_ > 0) {
+    // remember the page, so that coming back soon promotes it to Am
+    a1out_index_[info.page_id_] = a1out_.insert(a1out_.end(), info.page_id_);
+    if (a1out_.size() > a1out_size_) {
+      a1out_index_.erase(a1out_.front());
+      a1out_.pop_front();
+    }
+  }
+  queue->erase(it);
+  frames_.erase(*frame_id);
+  num_evictable_--;
+  return true;
+}
+
+TwoQReplacer::FrameInfo &TwoQReplacer::Track(frame_id_t frame_id, page_id_t page_id) {
+  FrameInfo &info = frames_[frame_id];
+  info.page_id_ = page_id;
+  auto ghost = a1out_index_.find(page_id);
+  if (ghost != a1out_index_.end()) {
+    a1out_.erase(ghost->second);
+    a1out_index_.erase(ghost);
+    info.in_am_ = true;
+  }
+  auto &queue = info.in_am_ ? am_ : a1in_;
+  info.pos_ = queue.insert(queue.end(), frame_id);
+  return info;
+}
+
+void TwoQReplacer::Forget(frame_id_t frame_id) {
+  auto it = frames_.find(frame_id);
+  if (it == frames_.end()) {
+    return;
+  }
+  (it->second.in_am_ ? am_ : a1in_).erase(it->second.pos_);
+  if (it->second.evictable_) {
+    num_evictable_--;
+  }
+  frames_.erase(it);
+}
+
+void TwoQReplacer::Pin(frame_id_t frame_id) {
+  std::scoped_lock lock{latch_};
+  auto it = frames_.find(frame_id);
+  FrameInfo &info = it == frames_.end() ? Track(frame_id, INVALID_PAGE_ID) : it->second;
+  if (info.evictable_) {
+    info.evictable_ = false;
+    num_evictable_--;
+  }
+  // only Am is ordered by recency, accesses in A1in are correlated with the one that loaded the page
+  if (info.in_am_) {
+    am_.splice(am_.end(), am_, info.pos_);
+  }
+}
+
+void TwoQReplacer::Unpin(frame_id_t frame_id) {
+  std::scoped_lock lock{latch_};
+  auto it = frames_.find(frame_id);
+  FrameInfo &info = it == frames_.end() ? Track(frame_id, INVALID_PAGE_ID) : it->second;
+  if (!info.evictable_) {
+    info.evictable_ = true;
+    num_evictable_++;
+  }
+}
+
+void TwoQReplacer::Admit(frame_id_t frame_id, page_id_t page_id) {
+  std::scoped_lock lock{latch_};
+  Forget(frame_id);
+  Track(frame_id, page_id);
+}
+
+size_t TwoQReplacer::Size() {
+  std::scoped_lock lock{latch_};
+  return num_evictable_;
+}
+
+std::vector<frame_id_t> TwoQReplacer::PeekVictims(size_t max_frames) {
+  std::scoped_lock lock{latch_};
+  std::vector<frame_id_t> frames;
+  // replay the choices Victim would make, without changing anything
+  auto next_a1in = FirstEvictable(&a1in_);
+  auto next_am = FirstEvictable(&am_);
+  size_t a1in_size = a1in_.size();
+  auto advance = [this](frame_list_t *queue, frame_list_t::iterator it) {
+    return std::find_if(std::next(it), queue->end(),
+                        [this](frame_id_t frame_id) { return frames_[frame_id].evictable_; });
+  };
+  while (frames.size() < max_frames) {
+    if (next_a1in != a1in_.end() && (a1in_size > a1in_target_ || next_am == am_.end())) {
+      frames.push_back(*next_a1in);
+      next_a1in = advance(&a1in_, next_a1in);
+      a1in_size--;
+    } else if (next_am != am_.end()) {
+      frames.push_back(*next_am);
+      next_am = advance(&am_, next_am);
+    } else {
+      break;
+    }
+  }
+  return frames;
+}
+
+}  // namespace bustub
@@ -20,4 +20,12 @@ std::chrono::duration<int64_t> log_timeout = std::chrono::seconds(1);
 
 std::chrono::milliseconds cycle_detection_interval = std::chrono::milliseconds(50);
 
+std::chrono::milliseconds page_cleaner_interval = std::chrono::milliseconds(10);
+
+std::chrono::milliseconds buffer_pool_dump_interval = std::chrono::seconds(30);
+
+std::atomic<size_t> scan_read_ahead_pages(8);
+
+std::atomic<HugePagePolicy> buffer_pool_huge_pages(HugePagePolicy::TRANSPARENT);
+
 }  // namespace bustub
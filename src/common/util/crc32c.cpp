@@ -0,0 +1,203 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.cpp
+//
+// Identification: src/common/util/crc32c.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace bustub {
+
+namespace {
+
+/** The CRC-32C polynomial, bit-reflected. */
+constexpr uint32_t POLY = 0x82f63b78;
+
+/** Sizes of the three streams the hardware CRC runs at once, large ones first, then small ones for the rest. */
+constexpr size_t LONG_BLOCK = 1024;
+constexpr size_t SHORT_BLOCK = 256;
+
+/** @return the product of a 32x32 matrix over GF(2), one column per word, and a vector */
+uint32_t Gf2MatrixTimes(const uint32_t *mat, uint32_t vec) {
+  uint32_t sum = 0;
+  while (vec != 0) {
+    if ((vec & 1) != 0) {
+      sum ^= *mat;
+    }
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+void Gf2MatrixSquare(uint32_t *square, const uint32_t *mat) {
+  for (int n = 0; n < 32; n++) {
+    square[n] = Gf2MatrixTimes(mat, mat[n]);
+  }
+}
+
+/**
+ * Build the operator that feeds length zero bytes through a CRC register, length a power of two. Feeding a block of
+ * zeros to the CRC of A gives the CRC A would have if it were followed by the block, which is how the CRCs of
+ * separately computed streams are joined.
+ */
+void ZerosOperator(uint32_t *even, size_t length) {
+  uint32_t odd[32];
+  // the operator for one zero bit
+  odd[0] = POLY;
+  uint32_t row = 1;
+  for (int n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+  // two and then four zero bits
+  Gf2MatrixSquare(even, odd);
+  Gf2MatrixSquare(odd, even);
+  // every further square doubles the number of zeros, the first one making a byte
+  while (true) {
+    Gf2MatrixSquare(even, odd);
+    length >>= 1;
+    if (length == 0) {
+      return;
+    }
+    Gf2MatrixSquare(odd, even);
+    length >>= 1;
+    if (length == 0) {
+      memcpy(even, odd, sizeof(odd));
+      return;
+    }
+  }
+}
+
+struct Tables {
+  Tables() {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t crc = n;
+      for (int k = 0; k < 8; k++) {
+        crc = (crc & 1) != 0 ? (crc >> 1) ^ POLY : crc >> 1;
+      }
+      byte_[n] = crc;
+    }
+    BuildShift(long_, LONG_BLOCK);
+    BuildShift(short_, SHORT_BLOCK);
+  }
+
+  /** Tabulate the zeros operator a byte of the CRC at a time, so applying it takes four lookups. */
+  static void BuildShift(uint32_t shift[4][256], size_t length) {
+    uint32_t op[32];
+    ZerosOperator(op, length);
+    for (uint32_t n = 0; n < 256; n++) {
+      for (int i = 0; i < 4; i++) {
+        shift[i][n] = Gf2MatrixTimes(op, n << (8 * i));
+      }
+    }
+  }
+
+  /** CRC of a single byte, for the table-driven CRC. */
+  uint32_t byte_[256];
+  /** The zeros operators for LONG_BLOCK and SHORT_BLOCK bytes. */
+  uint32_t long_[4][256];
+  uint32_t short_[4][256];
+};
+
+const Tables &GetTables() {
+  static const Tables tables;
+  return tables;
+}
+
+#if defined(__x86_64__)
+
+inline uint64_t Shift(const uint32_t shift[4][256], uint64_t crc) {
+  return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^ shift[2][(crc >> 16) & 0xff] ^ shift[3][crc >> 24];
+}
+
+inline uint64_t Load64(const char *data) {
+  uint64_t word;
+  memcpy(&word, data, sizeof(word));
+  return word;
+}
+
+/**
+ * Consume as many runs of three blocks as there are in data. The crc32 instruction takes three cycles but can start
+ * every cycle, so the three blocks are run side by side and joined afterwards.
+ */
+__attribute__((target("sse4.2"))) void ExtendBlocks(uint64_t *crc, const char **data, size_t *length, size_t block,
+                                                      const uint32_t shift[4][256]) {
+  uint64_t crc0 = *crc;
+  const char *next = *data;
+  while (*length >= 3 * block) {
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    for (size_t i = 0; i < block; i += 8) {
+      crc0 = _mm_crc32_u64(crc0, Load64(next + i));
+      crc1 = _mm_crc32_u64(crc1, Load64(next + block + i));
+      crc2 = _mm_crc32_u64(crc2, Load64(next + 2 * block + i));
+    }
+    crc0 = Shift(shift, crc0) ^ crc1;
+    crc0 = Shift(shift, crc0) ^ crc2;
+    next += 3 * block;
+    *length -= 3 * block;
+  }
+  *crc = crc0;
+  *data = next;
+}
+
+__attribute__((target("sse4.2"))) uint32_t ExtendHardware(uint32_t crc, const char *data, size_t length) {
+  const Tables &tables = GetTables();
+  uint64_t crc0 = crc ^ 0xffffffff;
+  ExtendBlocks(&crc0, &data, &length, LONG_BLOCK, tables.long_);
+  ExtendBlocks(&crc0, &data, &length, SHORT_BLOCK, tables.short_);
+  for (; length >= 8; data += 8, length -= 8) {
+    crc0 = _mm_crc32_u64(crc0, Load64(data));
+  }
+  auto crc32 = static_cast<uint32_t>(crc0);
+  for (; length > 0; data++, length--) {
+    crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(*data));
+  }
+  return crc32 ^ 0xffffffff;
+}
+
+#endif
+
+}  // namespace
+
+uint32_t Crc32c::Extend(uint32_t crc, const char *data, size_t length) {
+#if defined(__x86_64__)
+  if (IsHardwareAccelerated()) {
+    return ExtendHardware(crc, data, length);
+  }
+#endif
+  return ExtendPortable(crc, data, length);
+}
+
+uint32_t Crc32c::ExtendPortable(uint32_t crc, const char *data, size_t length) {
+  const Tables &tables = GetTables();
+  crc ^= 0xffffffff;
+  for (size_t i = 0; i < length; i++) {
+    crc = tables.byte_[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffff;
+}
+
+bool Crc32c::IsHardwareAccelerated() {
+#if defined(__x86_64__)
+  static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+  return has_sse42;
+#else
+  return false;
+#endif
+}
+
+}  // namespace bustub
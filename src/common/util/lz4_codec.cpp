@@ -0,0 +1,189 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec.cpp
+//
+// Identification: src/common/util/lz4_codec.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/lz4_codec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+namespace {
+
+/** Shortest match worth a sequence, match lengths are stored relative to it. */
+constexpr size_t MIN_MATCH = 4;
+/** The block format requires the last bytes to be literals, and no match to start close to the end. */
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_FIND_LIMIT = 12;
+/** A length nibble of this value continues in the bytes after the token. */
+constexpr size_t RUN_MASK = 15;
+constexpr int HASH_BITS = 12;
+
+inline uint32_t Read32(const char *data) {
+  uint32_t word;
+  memcpy(&word, data, sizeof(word));
+  return word;
+}
+
+inline uint32_t Hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - HASH_BITS); }
+
+/** Write the part of a length beyond its nibble: as many 255s as fit, then the rest. */
+inline void WriteLength(char **op, size_t length) {
+  for (; length >= 255; length -= 255) {
+    *(*op)++ = static_cast<char>(255);
+  }
+  *(*op)++ = static_cast<char>(length);
+}
+
+/**
+ * Append a sequence: literal_length bytes of literals, then a match of match_length bytes at offset, or no match for
+ * the last sequence of a block, where match_length is 0.
+ * @return false if the sequence does not fit before end
+ */
+bool EmitSequence(char **op, const char *end, const char *literals, size_t literal_length, size_t offset,
+                  size_t match_length) {
+  auto extra_length_bytes = [](size_t length) { return length < RUN_MASK ? 0 : (length - RUN_MASK) / 255 + 1; };
+  size_t sequence_size = 1 + extra_length_bytes(literal_length) + literal_length;
+  if (match_length != 0) {
+    sequence_size += 2 + extra_length_bytes(match_length - MIN_MATCH);
+  }
+  if (static_cast<size_t>(end - *op) < sequence_size) {
+    return false;
+  }
+  char *token = (*op)++;
+  *token = static_cast<char>(std::min(literal_length, RUN_MASK) << 4);
+  if (literal_length >= RUN_MASK) {
+    WriteLength(op, literal_length - RUN_MASK);
+  }
+  memcpy(*op, literals, literal_length);
+  *op += literal_length;
+  if (match_length == 0) {
+    return true;
+  }
+  *(*op)++ = static_cast<char>(offset & 0xff);
+  *(*op)++ = static_cast<char>(offset >> 8);
+  size_t length = match_length - MIN_MATCH;
+  *token = static_cast<char>(*token | std::min(length, RUN_MASK));
+  if (length >= RUN_MASK) {
+    WriteLength(op, length - RUN_MASK);
+  }
+  return true;
+}
+
+}  // namespace
+
+size_t Lz4Codec::Compress(const char *src, size_t size, char *dst, size_t capacity) {
+  BUSTUB_ASSERT(size <= MAX_INPUT_SIZE, "input too large for 16 bit match offsets");
+  char *op = dst;
+  const char *end = dst + capacity;
+  size_t anchor = 0;
+  if (size > MATCH_FIND_LIMIT) {
+    // the last position each hash of four bytes was seen at; a stale or empty slot is caught by comparing the bytes
+    uint16_t table[1 << HASH_BITS] = {};
+    size_t ip = 0;
+    while (ip < size - MATCH_FIND_LIMIT) {
+      uint32_t sequence = Read32(src + ip);
+      uint32_t hash = Hash(sequence);
+      size_t ref = table[hash];
+      table[hash] = static_cast<uint16_t>(ip);
+      if (ref >= ip || Read32(src + ref) != sequence) {
+        ip++;
+        continue;
+      }
+      size_t match_length = MIN_MATCH;
+      while (ip + match_length < size - LAST_LITERALS && src[ref + match_length] == src[ip + match_length]) {
+        match_length++;
+      }
+      // the bytes in front of the match may match as well
+      while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+        ip--;
+        ref--;
+        match_length++;
+      }
+      if (!EmitSequence(&op, end, src + anchor, ip - anchor, ip - ref, match_length)) {
+        return 0;
+      }
+      ip += match_length;
+      anchor = ip;
+    }
+  }
+  if (!EmitSequence(&op, end, src + anchor, size - anchor, 0, 0)) {
+    return 0;
+  }
+  return op - dst;
+}
+
+bool Lz4Codec::Decompress(const char *src, size_t src_size, char *dst, size_t size) {
+  const auto *ip = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *ip_end = ip + src_size;
+  size_t op = 0;
+  auto read_length = [&ip, ip_end](size_t *length) {
+    uint8_t byte;
+    do {
+      if (ip == ip_end) {
+        return false;
+      }
+      byte = *ip++;
+      *length += byte;
+    } while (byte == 255);
+    return true;
+  };
+
+  while (true) {
+    if (ip == ip_end) {
+      return false;
+    }
+    uint8_t token = *ip++;
+    size_t literal_length = token >> 4;
+    if (literal_length == RUN_MASK && !read_length(&literal_length)) {
+      return false;
+    }
+    if (static_cast<size_t>(ip_end - ip) < literal_length || size - op < literal_length) {
+      return false;
+    }
+    memcpy(dst + op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    // only the last sequence has no match
+    if (ip == ip_end) {
+      return op == size;
+    }
+
+    if (ip_end - ip < 2) {
+      return false;
+    }
+    size_t offset = ip[0] | static_cast<size_t>(ip[1]) << 8;
+    ip += 2;
+    size_t match_length = token & RUN_MASK;
+    if (match_length == RUN_MASK && !read_length(&match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > op || size - op < match_length) {
+      return false;
+    }
+    if (offset >= match_length) {
+      memcpy(dst + op, dst + op - offset, match_length);
+    } else {
+      // the match overlaps its own output, as a run of a repeated byte does
+      for (size_t i = 0; i < match_length; i++) {
+        dst[op + i] = dst[op - offset + i];
+      }
+    }
+    op += match_length;
+  }
+}
+
+}  // namespace bustub
@@ -23,16 +23,22 @@ namespace bustub {
 std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
 std::shared_mutex TransactionManager::txn_map_mutex = {};
 
-Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
+Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level,
+                                       DurabilityMode durability_mode) {
   // Acquire the global transaction latch in shared mode.
   global_txn_latch_.RLock();
 
   if (txn == nullptr) {
-    txn = new Transaction(next_txn_id_++, isolation_level);
+    txn = new Transaction(next_txn_id_++, isolation_level, durability_mode);
   }
   txn_map_mutex.lock();
   txn_map[txn->GetTransactionId()] = txn;
   txn_map_mutex.unlock();
+
+  if (log_manager_ != nullptr) {
+    std::scoped_lock lock{active_txns_latch_};
+    active_txns_[txn->GetTransactionId()] = {txn, log_manager_->GetNextLSN()};
+  }
   return txn;
 }
 
@@ -52,10 +58,34 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
+  // a transaction that logged nothing has nothing to make durable, recovery never hears of it
+  lsn_t commit_lsn = INVALID_LSN;
+  if (enable_logging && log_manager_ != nullptr && txn->GetPrevLSN() != INVALID_LSN) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    commit_lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(commit_lsn);
+  }
+  EndTransaction(txn);
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
+
+  if (commit_lsn == INVALID_LSN) {
+    return;
+  }
+  switch (txn->GetDurabilityMode()) {
+    case DurabilityMode::SYNCHRONOUS:
+      log_manager_->Flush(commit_lsn);
+      break;
+    case DurabilityMode::GROUP_COMMIT:
+      log_manager_->WaitForFlush(commit_lsn);
+      break;
+    case DurabilityMode::ASYNC:
+      // the flush thread writes the record out within log_timeout
+      break;
+  }
 }
 
 void TransactionManager::Abort(Transaction *txn) {
@@ -102,12 +132,41 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  // an aborted transaction has nothing to wait for, its record only tells recovery that the rollback is done, and
+  // there is nothing to tell if it logged no change
+  if (enable_logging && log_manager_ != nullptr && txn->GetPrevLSN() != INVALID_LSN) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
+  EndTransaction(txn);
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
 }
 
+std::vector<std::pair<txn_id_t, lsn_t>> TransactionManager::GetActiveTransactionTable(lsn_t *min_begin_lsn) {
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  *min_begin_lsn = INVALID_LSN;
+  std::scoped_lock lock{active_txns_latch_};
+  active_txns.reserve(active_txns_.size());
+  for (const auto &[txn_id, active] : active_txns_) {
+    active_txns.emplace_back(txn_id, active.txn_->GetPrevLSN());
+    if (*min_begin_lsn == INVALID_LSN || active.begin_lsn_ < *min_begin_lsn) {
+      *min_begin_lsn = active.begin_lsn_;
+    }
+  }
+  return active_txns;
+}
+
+void TransactionManager::EndTransaction(Transaction *txn) {
+  if (log_manager_ != nullptr) {
+    std::scoped_lock lock{active_txns_latch_};
+    active_txns_.erase(txn->GetTransactionId());
+  }
+}
+
 void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
 
 void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
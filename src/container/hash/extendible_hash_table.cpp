@@ -10,7 +10,6 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
@@ -21,6 +20,7 @@
 #include "common/config.h"
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/macros.h"
 #include "common/rid.h"
 #include "container/hash/extendible_hash_table.h"
 #include "storage/page/hash_table_directory_page.h"
@@ -28,27 +28,30 @@
 
 namespace bustub {
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     tablespace_id_t tablespace_id)
+    : buffer_pool_manager_(buffer_pool_manager),
+      extent_allocator_(buffer_pool_manager, ExtentAllocator::DEFAULT_EXTENT_PAGES, tablespace_id),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)) {
+  BUSTUB_ASSERT(buffer_pool_manager->GetPageSize() == PageSize, "the buffer pool's pages are not of the table's size");
   //  implement me!
   page_id_t dir_page_id{};
   page_id_t bucket_page_id{};
-  Page *dir_rpage{};
-  if ((dir_rpage = buffer_pool_manager->NewPage(&dir_page_id)) == nullptr ||
-      buffer_pool_manager->NewPage(&bucket_page_id) == nullptr) {
+  BasicPageGuard dir_guard = extent_allocator_.NewPageGuarded(&dir_page_id);
+  BasicPageGuard bucket_guard = extent_allocator_.NewPageGuarded(&bucket_page_id);
+  if (!dir_guard || !bucket_guard) {
     throw Exception("failed to allocate a new page");
   }
 
   this->directory_page_id_ = dir_page_id;
-  HashTableDirectoryPage *dir_page = reinterpret_cast<HashTableDirectoryPage *>(dir_rpage->GetData());
+  auto *dir_page = dir_guard.As<HashTableDirectoryPage>();
   dir_page->SetPageId(dir_page_id);
   dir_page->SetBucketPageId(0, bucket_page_id);
   dir_page->SetLocalDepth(0, 0);
-
-  buffer_pool_manager->UnpinPage(dir_page_id, true);
-  buffer_pool_manager->UnpinPage(bucket_page_id, false);
+  dir_guard.SetDirty();
 }
 
 /*****************************************************************************
@@ -61,129 +64,96 @@ HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager
  * @param key the key to hash
  * @return the downcasted 32-bit hash
  */
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 uint32_t HASH_TABLE_TYPE::Hash(KeyType key) {
   return static_cast<uint32_t>(hash_fn_.GetHash(key));
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 inline uint32_t HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) {
   return Hash(key) & dir_page->GetGlobalDepthMask();
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 inline uint32_t HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) {
   return dir_page->GetBucketPageId(KeyToDirectoryIndex(key, dir_page));
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
-HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPage() {
-  Page *dir_rpage = buffer_pool_manager_->FetchPage(directory_page_id_);
-  if (dir_rpage == nullptr) {
-    return nullptr;
-  }
-  return reinterpret_cast<HashTableDirectoryPage *>(dir_rpage->GetData());
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-std::pair<Page *, HASH_TABLE_BUCKET_TYPE *> HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) {
-  // fixme
-  // nullptr?
-  Page *bucket_rpage = buffer_pool_manager_->FetchPage(bucket_page_id);
-  HASH_TABLE_BUCKET_TYPE *bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket_rpage->GetData());
-  return {bucket_rpage, bucket_page};
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
+BasicPageGuard HASH_TABLE_TYPE::FetchDirectoryPage() {
+  return buffer_pool_manager_->FetchPageBasic(directory_page_id_);
 }
 
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
   table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t bucket_page_id = KeyToPageId(key, dir_page);
-  auto [bucket_rpage, bucket_page] = FetchBucketPage(KeyToPageId(key, dir_page));
+  BasicPageGuard dir_guard = FetchDirectoryPage();
+  auto *dir_page = dir_guard.As<HashTableDirectoryPage>();
+  ReadPageGuard bucket_guard = buffer_pool_manager_->FetchPageRead(KeyToPageId(key, dir_page));
 
-  bucket_rpage->RLatch();
-  bool success = bucket_page->GetValue(key, comparator_, result);
-  bucket_rpage->RUnlatch();
+  bool success = bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->GetValue(key, comparator_, result);
+  bucket_guard.Drop();
+  dir_guard.Drop();
   table_latch_.RUnlock();
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
   return success;
 }
 
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
   table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t bucket_page_id = KeyToPageId(key, dir_page);
-  auto [bucket_rpage, bucket_page] = FetchBucketPage(KeyToPageId(key, dir_page));
+  BasicPageGuard dir_guard = FetchDirectoryPage();
+  auto *dir_page = dir_guard.As<HashTableDirectoryPage>();
+  WritePageGuard bucket_guard = buffer_pool_manager_->FetchPageWrite(KeyToPageId(key, dir_page));
+  auto *bucket_page = bucket_guard.As<HASH_TABLE_BUCKET_TYPE>();
 
-  bucket_rpage->WLatch();
   bool success = bucket_page->Insert(key, value, comparator_);
-  if (!success) {
-    if (!bucket_page->IsFull()) {
-      bucket_rpage->WUnlatch();
-      table_latch_.RUnlock();
-      buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-      return false;
-    }
-    bucket_rpage->WUnlatch();
-    table_latch_.RUnlock();
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    return SplitInsert(transaction, key, value);
+  bool split = !success && bucket_page->IsFull();
+  if (success) {
+    bucket_guard.SetDirty();
   }
-
-  bucket_rpage->WUnlatch();
+  bucket_guard.Drop();
+  dir_guard.Drop();
   table_latch_.RUnlock();
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-  return true;
+  return split ? SplitInsert(transaction, key, value) : success;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) {
   table_latch_.WLock();
   // status may changed
   // try insert before split
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  BasicPageGuard dir_guard = FetchDirectoryPage();
+  auto *dir_page = dir_guard.As<HashTableDirectoryPage>();
   uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
-  uint32_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
-  auto [bucket_rpage, bucket_page] = FetchBucketPage(KeyToPageId(key, dir_page));
+  WritePageGuard bucket_guard = buffer_pool_manager_->FetchPageWrite(dir_page->GetBucketPageId(bucket_idx));
+  auto *bucket_page = bucket_guard.As<HASH_TABLE_BUCKET_TYPE>();
 
-  bucket_rpage->WLatch();
   bool success = bucket_page->Insert(key, value, comparator_);
-  if (success) {
-    bucket_rpage->WUnlatch();
-    table_latch_.WUnlock();
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-    return true;
-  }
-  if (!success && !bucket_page->IsFull()) {
-    bucket_rpage->WUnlatch();
+  if (success || !bucket_page->IsFull()) {
+    if (success) {
+      bucket_guard.SetDirty();
+    }
+    bucket_guard.Drop();
+    dir_guard.Drop();
     table_latch_.WUnlock();
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    return false;
+    return success;
   }
 
   // allocate a new bucket
   page_id_t new_bucket_id{};
-  Page *new_bucket_rpage = buffer_pool_manager_->NewPage(&new_bucket_id);
-  if (new_bucket_rpage == nullptr) {
+  BasicPageGuard new_bucket_pin = extent_allocator_.NewPageGuarded(&new_bucket_id);
+  if (!new_bucket_pin) {
+    bucket_guard.Drop();
+    dir_guard.Drop();
     table_latch_.WUnlock();
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
     return false;
   }
-  HASH_TABLE_BUCKET_TYPE *new_bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(new_bucket_rpage->GetData());
 
   if (dir_page->GetLocalDepth(bucket_idx) == dir_page->GetGlobalDepth()) {
     dir_page->IncrGlobalDepth();
@@ -196,52 +166,48 @@ bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key,
     dir_page->IncrLocalDepth(i);
   }
   dir_page->SetBucketPageId(bucket_idx, new_bucket_id);
+  dir_guard.SetDirty();
 
-  bool new_page_dirty{false};
-  new_bucket_rpage->WLatch();
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; ++i) {
+  WritePageGuard new_bucket_guard = new_bucket_pin.UpgradeWrite();
+  auto *new_bucket_page = new_bucket_guard.As<HASH_TABLE_BUCKET_TYPE>();
+  for (size_t i = 0; i < HASH_TABLE_BUCKET_TYPE::ARRAY_SIZE; ++i) {
     KeyType key = bucket_page->KeyAt(i);
     if (KeyToDirectoryIndex(key, dir_page) == bucket_idx) {
-      new_page_dirty = true;
+      new_bucket_guard.SetDirty();
+      bucket_guard.SetDirty();
       new_bucket_page->Insert(key, bucket_page->ValueAt(i), comparator_);
       bucket_page->RemoveAt(i);
     }
   }
-  new_bucket_rpage->WUnlatch();
-  bucket_rpage->WUnlatch();
-
+  new_bucket_guard.Drop();
+  bucket_guard.Drop();
+  dir_guard.Drop();
   table_latch_.WUnlock();
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
-  buffer_pool_manager_->UnpinPage(new_bucket_id, new_page_dirty);
-  buffer_pool_manager_->UnpinPage(bucket_page_id, new_page_dirty);
   return Insert(transaction, key, value);
 }
 
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
   table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
-  uint32_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
-  auto [bucket_rpage, bucket_page] = FetchBucketPage(KeyToPageId(key, dir_page));
+  BasicPageGuard dir_guard = FetchDirectoryPage();
+  auto *dir_page = dir_guard.As<HashTableDirectoryPage>();
+  WritePageGuard bucket_guard = buffer_pool_manager_->FetchPageWrite(KeyToPageId(key, dir_page));
+  auto *bucket_page = bucket_guard.As<HASH_TABLE_BUCKET_TYPE>();
 
-  bucket_rpage->WLatch();
   bool success = bucket_page->Remove(key, value, comparator_);
   // cautions! it's possbily to call Remove on an empty bucket
-  if (bucket_page->IsEmpty()) {
-    bucket_rpage->WUnlatch();
-    table_latch_.RUnlock();
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, success);
+  bool empty = bucket_page->IsEmpty();
+  if (success) {
+    bucket_guard.SetDirty();
+  }
+  bucket_guard.Drop();
+  dir_guard.Drop();
+  table_latch_.RUnlock();
+  if (empty) {
     Merge(nullptr, key, value);
-  } else {
-    bucket_rpage->WUnlatch();
-    table_latch_.RUnlock();
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, success);
   }
   return success;
 }
@@ -249,10 +215,11 @@ bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
   table_latch_.WLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  BasicPageGuard dir_guard = FetchDirectoryPage();
+  auto *dir_page = dir_guard.As<HashTableDirectoryPage>();
   uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
   uint32_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
 
@@ -268,7 +235,7 @@ void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const
       dir_page->DecrLocalDepth(i);
       dir_page->SetBucketPageId(i, image_bucket_id);
     }
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+    // nobody else can hold the emptied bucket while we hold the table latch exclusively
     if (!buffer_pool_manager_->DeletePage(bucket_page_id)) {
       throw Exception("failed to delete a page");
     }
@@ -282,21 +249,22 @@ void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const
     for (unsigned i = 0; i < delta; ++i) {
       dir_page->DecrGlobalDepth();
     }
+    dir_guard.SetDirty();
   }
 
+  dir_guard.Drop();
   table_latch_.WUnlock();
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
 }
 
 /*****************************************************************************
  * GETGLOBALDEPTH - DO NOT TOUCH
  *****************************************************************************/
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 uint32_t HASH_TABLE_TYPE::GetGlobalDepth() {
   table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t global_depth = dir_page->GetGlobalDepth();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
+  BasicPageGuard dir_guard = FetchDirectoryPage();
+  uint32_t global_depth = dir_guard.As<HashTableDirectoryPage>()->GetGlobalDepth();
+  dir_guard.Drop();
   table_latch_.RUnlock();
   return global_depth;
 }
@@ -304,12 +272,12 @@ uint32_t HASH_TABLE_TYPE::GetGlobalDepth() {
 /*****************************************************************************
  * VERIFY INTEGRITY - DO NOT TOUCH
  *****************************************************************************/
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 void HASH_TABLE_TYPE::VerifyIntegrity() {
   table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  dir_page->VerifyIntegrity();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
+  BasicPageGuard dir_guard = FetchDirectoryPage();
+  dir_guard.As<HashTableDirectoryPage>()->VerifyIntegrity();
+  dir_guard.Drop();
   table_latch_.RUnlock();
 }
 
@@ -324,4 +292,7 @@ template class ExtendibleHashTable<GenericKey<16>, RID, GenericComparator<16>>;
 template class ExtendibleHashTable<GenericKey<32>, RID, GenericComparator<32>>;
 template class ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class ExtendibleHashTable<int, int, IntComparator, 16 * 1024>;
+template class ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>, 64 * 1024>;
+
 }  // namespace bustub
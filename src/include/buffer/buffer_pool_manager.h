@@ -15,8 +15,12 @@
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "buffer/buffer_pool_stats.h"
 #include "buffer/lru_replacer.h"
+#include "buffer/page_guard.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
@@ -84,9 +88,105 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Fetch a page and wrap its pin in a guard, which unpins it when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if the page could not be fetched
+   */
+  BasicPageGuard FetchPageBasic(page_id_t page_id) { return BasicPageGuard(this, FetchPage(page_id)); }
+
+  /**
+   * Fetch a page and take its read latch, both released by the returned guard.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if the page could not be fetched
+   */
+  ReadPageGuard FetchPageRead(page_id_t page_id) { return ReadPageGuard(this, FetchPage(page_id)); }
+
+  /**
+   * Fetch a page and take its write latch, both released by the returned guard.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if the page could not be fetched
+   */
+  WritePageGuard FetchPageWrite(page_id_t page_id) { return WritePageGuard(this, FetchPage(page_id)); }
+
+  /**
+   * Create a new page and wrap its pin in a guard.
+   * @param[out] page_id id of created page
+   * @return a guard holding the new page, empty if no new page could be created
+   */
+  BasicPageGuard NewPageGuarded(page_id_t *page_id) { return BasicPageGuard(this, NewPage(page_id)); }
+
+  /**
+   * Unpin a page through the frame it is in, as page guards do. Unlike UnpinPage this does not look the page up.
+   * @param page a page pinned by the caller
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   */
+  void UnpinFrame(Page *page, bool is_dirty) { UnpinFrameImp(page, is_dirty); }
+
+  /**
+   * Start reading pages into the buffer pool without waiting for them, so that fetching them later does not block on
+   * the disk. This is only a hint: pages that are already resident, or for which no clean frame is free, are skipped.
+   * @param page_ids ids of the pages that are about to be fetched
+   */
+  void PrefetchPages(const std::vector<page_id_t> &page_ids) { PrefetchPgsImp(page_ids); }
+
+  /**
+   * Allocate an extent, a run of contiguous pages on disk, whose pages are then created one by one with
+   * NewPageInExtent. Pages of an extent that are never created are not handed out again while the database is open,
+   * but are free once it is reopened.
+   * @param num_pages number of pages in the extent, a power of two
+   * @param tablespace_id the tablespace, and so the file, that the extent is allocated in
+   * @return id of the first page of the extent, INVALID_PAGE_ID if this buffer pool does not support extents
+   * @throws Exception of type INVALID if the tablespace's pages are not of the buffer pool's page size
+   */
+  page_id_t AllocateExtent(uint32_t num_pages, tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID) {
+    return AllocateExtentImp(num_pages, tablespace_id);
+  }
+
+  /**
+   * Creates a new page in the buffer pool for a page of an extent, which must not have been created before.
+   * @param page_id id of the page, taken from an extent returned by AllocateExtent
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  Page *NewPageInExtent(page_id_t page_id) { return NewPgInExtentImp(page_id); }
+
+  /**
+   * List the resident pages, hottest first: pinned pages, then the unpinned ones in the reverse of the order the
+   * replacer would evict them. Saved across a restart, the list lets WarmUp reload what the pool was working on.
+   * @param max_pages the maximum number of pages to list
+   * @return ids of the hottest resident pages, empty if this buffer pool cannot tell
+   */
+  std::vector<page_id_t> GetHotPages(size_t max_pages) { return GetHotPgsImp(max_pages); }
+
+  /**
+   * List the dirty-page table: every page with logged changes that may not have reached the disk yet, with its
+   * recLSN, the LSN of the oldest of them (see Page::GetRecLSN). Pages still being written out after their eviction
+   * are listed too. A fuzzy checkpoint starts redo at its smallest recLSN.
+   * @return (page id, recLSN) of every such page, empty if this buffer pool cannot tell
+   */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() { return GetDirtyPgsImp(); }
+
+  /**
+   * Read pages into the buffer pool and wait for them, used to warm up an empty pool after a restart. Pages that no
+   * longer exist on disk are skipped, and so are the coldest pages if there are more than the pool has frames for.
+   * @param page_ids ids of the pages to load, hottest first as returned by GetHotPages
+   * @return the number of pages read
+   */
+  size_t WarmUp(const std::vector<page_id_t> &page_ids) { return WarmUpImp(page_ids); }
+
+  /**
+   * Take a snapshot of the statistics of the buffer pool. Counters and histograms cover the lifetime of the pool,
+   * sizes are as of the call.
+   * @return the statistics, all zero if this buffer pool does not keep any
+   */
+  BufferPoolStats GetStats() { return GetStatsImp(); }
+
   /** @return size of the buffer pool */
   virtual size_t GetPoolSize() = 0;
 
+  /** @return the size of the pages of the buffer pool, that of its disk manager's file */
+  virtual size_t GetPageSize() { return PAGE_SIZE; }
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -105,6 +205,7 @@ class BufferPoolManager {
    * Fetch the requested page from the buffer pool.
    * @param page_id id of page to be fetched
    * @return the requested page
+   * @throws Exception of type IO if the page has to be read and fails its checksum
    */
   virtual Page *FetchPgImp(page_id_t page_id) = 0;
 
@@ -116,6 +217,13 @@ class BufferPoolManager {
    */
   virtual bool UnpinPgImp(page_id_t page_id, bool is_dirty) = 0;
 
+  /**
+   * Unpin a page through its frame, see UnpinFrame. By default the page is unpinned by its id.
+   * @param page a page pinned by the caller
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   */
+  virtual void UnpinFrameImp(Page *page, bool is_dirty) { UnpinPgImp(page->GetPageId(), is_dirty); }
+
   /**
    * Flushes the target page to disk.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
@@ -141,5 +249,55 @@ class BufferPoolManager {
    * Flushes all the pages in the buffer pool to disk.
    */
   virtual void FlushAllPgsImp() = 0;
+
+  /**
+   * Start reading pages into the buffer pool, see PrefetchPages. By default the hint is ignored.
+   * @param page_ids ids of the pages that are about to be fetched
+   */
+  virtual void PrefetchPgsImp(__attribute__((unused)) const std::vector<page_id_t> &page_ids) {}
+
+  /**
+   * Allocate an extent, see AllocateExtent. By default extents are not supported.
+   * @param num_pages number of pages in the extent
+   * @param tablespace_id the tablespace to allocate in
+   * @return id of the first page of the extent, INVALID_PAGE_ID if extents are not supported
+   */
+  virtual page_id_t AllocateExtentImp(__attribute__((unused)) uint32_t num_pages,
+                                      __attribute__((unused)) tablespace_id_t tablespace_id) {
+    return INVALID_PAGE_ID;
+  }
+
+  /**
+   * Creates a new page in the buffer pool for a page of an extent, see NewPageInExtent.
+   * @param page_id id of the page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  virtual Page *NewPgInExtentImp(__attribute__((unused)) page_id_t page_id) { return nullptr; }
+
+  /**
+   * List the hottest resident pages, see GetHotPages. By default the buffer pool cannot tell.
+   * @param max_pages the maximum number of pages to list
+   * @return ids of the hottest resident pages
+   */
+  virtual std::vector<page_id_t> GetHotPgsImp(__attribute__((unused)) size_t max_pages) { return {}; }
+
+  /**
+   * List the dirty-page table, see GetDirtyPageTable. By default the buffer pool cannot tell.
+   * @return (page id, recLSN) of every page whose logged changes may not be on disk
+   */
+  virtual std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPgsImp() { return {}; }
+
+  /**
+   * Load pages into the buffer pool, see WarmUp. By default nothing is loaded.
+   * @param page_ids ids of the pages to load, hottest first
+   * @return the number of pages read
+   */
+  virtual size_t WarmUpImp(__attribute__((unused)) const std::vector<page_id_t> &page_ids) { return 0; }
+
+  /**
+   * Take a snapshot of the statistics, see GetStats. By default no statistics are kept.
+   * @return the statistics
+   */
+  virtual BufferPoolStats GetStatsImp() { return {}; }
 };
 }  // namespace bustub
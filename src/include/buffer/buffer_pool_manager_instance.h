@@ -12,12 +12,24 @@
 
 #pragma once
 
-#include <list>
-#include <mutex>  // NOLINT
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <exception>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/frame_arena.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
+#include "buffer/page_table.h"
+#include "buffer/two_q_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
@@ -34,8 +46,10 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy
    */
-  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU);
   /**
    * Creates a new BufferPoolManagerInstance.
    * @param pool_size the size of the buffer pool
@@ -43,9 +57,12 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param instance_index index of this BPI in the parallel BPM
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy
+   * @param numa_node the NUMA node to place the frames on, -1 to leave placement to the OS
    */
   BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                            DiskManager *disk_manager, LogManager *log_manager = nullptr);
+                            DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU, int numa_node = -1);
 
   /**
    * Destroys an existing BufferPoolManagerInstance.
@@ -55,9 +72,40 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override { return pool_size_; }
 
+  size_t GetPageSize() override { return page_size_; }
+
   /** @return pointer to all the pages in the buffer pool */
   Page *GetPages() { return pages_; }
 
+  /**
+   * Start the background page cleaner. Once at least high_watermark of the pool is dirty, the cleaner writes out dirty,
+   * unpinned frames in the order the replacer would evict them, until only low_watermark of the pool is dirty. The
+   * cleaner checks every page_cleaner_interval, or as soon as a victim has to be written in the foreground.
+   * @param high_watermark fraction of dirty frames at which cleaning starts
+   * @param low_watermark fraction of dirty frames at which cleaning stops
+   */
+  void RunPageCleaner(double high_watermark = 0.25, double low_watermark = 0.1);
+
+  /**
+   * Stop and join the page cleaner, a no-op if it is not running.
+   */
+  void StopPageCleaner();
+
+  /** @return the number of dirty victims written out by the thread that needed their frame */
+  size_t GetForegroundWrites() const { return metrics_.dirty_evictions_.Load(); }
+
+  /** @return the number of dirty pages written out by the page cleaner */
+  size_t GetBackgroundWrites() const { return metrics_.background_writes_.Load(); }
+
+  /** @return the number of pages read in by PrefetchPages */
+  size_t GetPrefetchedPages() const { return metrics_.prefetched_pages_.Load(); }
+
+  /** @return the number of frames on the free list, read without the latch and so only a hint */
+  size_t GetFreeFrameCount() const { return num_free_frames_.load(std::memory_order_relaxed); }
+
+  /** @return the number of NUMA nodes frames can be placed on, 1 if the build has no NUMA support */
+  static int GetNumaNodeCount();
+
  protected:
   /**
    * Fetch the requested page from the buffer pool.
@@ -75,7 +123,15 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   bool UnpinPgImp(page_id_t page_id, bool is_dirty) override;
 
   /**
-   * Flushes the target page to disk.
+   * Unpin a page through its frame, without a page table lookup.
+   * @param page a page of this instance pinned by the caller
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   */
+  void UnpinFrameImp(Page *page, bool is_dirty) override;
+
+  /**
+   * Flushes the target page to disk, under its read latch so that no writer changes it meanwhile. The caller must not
+   * hold the page's latch.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
    * @return false if the page could not be found in the page table, true otherwise
    */
@@ -96,23 +152,73 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   bool DeletePgImp(page_id_t page_id) override;
 
   /**
-   * Flushes all the pages in the buffer pool to disk.
+   * Flushes all the pages in the buffer pool to disk, each under its read latch. The caller must not hold a page latch.
    */
   void FlushAllPgsImp() override;
 
   /**
-   * Allocate a page on disk.∂
+   * Start reading pages into free frames or clean victims. Each frame is pinned and flagged io_in_progress_ until its
+   * read completes, after which it is unpinned and becomes an ordinary resident page.
+   * @param page_ids ids of the pages that are about to be fetched
+   */
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids) override;
+
+  /**
+   * Allocate an extent on disk. Its pages are striped over the instances of a parallel buffer pool like any other.
+   * @param num_pages number of pages in the extent
+   * @param tablespace_id the tablespace to allocate in
+   * @return id of the first page of the extent
+   */
+  page_id_t AllocateExtentImp(uint32_t num_pages, tablespace_id_t tablespace_id) override;
+
+  /**
+   * Creates a new page in the buffer pool for a page of an extent.
+   * @param page_id id of the page, already allocated on disk
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  Page *NewPgInExtentImp(page_id_t page_id) override;
+
+  /**
+   * List the resident pages, hottest first: pinned pages, then unpinned pages from the most to the least recently
+   * used as far as the replacer is concerned. Frames under I/O are left out.
+   * @param max_pages the maximum number of pages to list
+   * @return ids of the hottest resident pages
+   */
+  std::vector<page_id_t> GetHotPgsImp(size_t max_pages) override;
+
+  /**
+   * List the dirty-page table of this instance: the frames with a recLSN, and the evicted pages still being written
+   * out with the recLSN they had.
+   * @return (page id, recLSN) of every page whose logged changes may not be on disk
+   */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPgsImp() override;
+
+  /**
+   * Prefetch the hottest pages that fit into the pool, coldest first so that the replacer ends up with the hottest
+   * page as the most recently used, and wait for the reads. The reads are issued in page order, so that pages that
+   * are next to each other on disk are read together.
+   * @param page_ids ids of the pages to load, hottest first
+   * @return the number of pages read
+   */
+  size_t WarmUpImp(const std::vector<page_id_t> &page_ids) override;
+
+  /**
+   * Take a snapshot of the statistics of this instance.
+   * @return the statistics
+   */
+  BufferPoolStats GetStatsImp() override;
+
+  /**
+   * Allocate a page on disk, from the page ids this BPI is responsible for.
    * @return the id of the allocated page
    */
   page_id_t AllocatePage();
 
   /**
-   * Deallocate a page on disk.
+   * Deallocate a page on disk, it may be handed out again by the next AllocatePage.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
-  }
+  void DeallocatePage(page_id_t page_id) { disk_manager_->DeallocatePage(page_id); }
 
   /**
    * Validate that the page_id being used is accessible to this BPI. This can be used in all of the functions to
@@ -121,28 +227,231 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void ValidatePageId(page_id_t page_id) const;
 
+  /**
+   * Reserve a frame for a new resident page, taking it from the free list first and the replacer second. The frame is
+   * returned FRAME_RESERVED; the caller sets its pin count once the frame's book-keeping describes the new page.
+   * The evicted page is removed from the page table. If its old contents still have to reach the disk, because it is
+   * dirty or because the page cleaner is writing it, its id is recorded in writing_back_; the caller must then wait
+   * for cleaning_ to clear, write the frame out if it was dirty (without holding latch_) and call FinishIo.
+   * Must be called with latch_ held.
+   * @param[out] frame_id the reserved frame
+   * @param[out] victim_page_id the page whose write-back must complete, INVALID_PAGE_ID if none
+   * @return false if every frame is pinned
+   */
+  bool ReserveFrame(frame_id_t *frame_id, page_id_t *victim_page_id);
+
+  /**
+   * Pin a resident page without taking latch_: look its frame up in the page table, bump the pin count with a CAS
+   * unless the frame is FRAME_RESERVED, then check that the frame still holds the page and is not being loaded.
+   * @param page_id id of the page to pin
+   * @return the pinned page, nullptr if the caller has to take the latched path
+   */
+  Page *TryPinResident(page_id_t page_id);
+
+  /**
+   * Take an unpinned frame for reuse: set its pin count to FRAME_RESERVED, so that lock-free fetches no longer pin it,
+   * and take it out of the replacer.
+   * @param frame_id the frame
+   * @return false if the frame is pinned
+   */
+  bool ClaimFrame(frame_id_t frame_id);
+
+  /**
+   * Tell the replacer about an access to a frame the caller has just pinned.
+   * @param frame_id the frame
+   */
+  void ReplacerPin(frame_id_t frame_id);
+
+  /**
+   * Make a frame whose pin count the caller has just dropped to zero evictable, unless it was pinned or claimed again
+   * meanwhile. Each frame's replacer updates are made under its pin_latch_, so the last one follows the last pin count
+   * change.
+   * @param frame_id the frame
+   */
+  void ReplacerUnpin(frame_id_t frame_id);
+
+  /**
+   * Drop a pin, making the frame evictable if it was the last one.
+   * @param frame_id the frame
+   */
+  void DropPin(frame_id_t frame_id);
+
+  /**
+   * Creates a new, zeroed page in a frame from the free list or the replacer.
+   * @param[in,out] page_id id of the page, allocated here and returned if allocate is set
+   * @param allocate whether to allocate a page on disk, or to use the already allocated *page_id
+   * @return nullptr if all frames are pinned, otherwise pointer to the new page
+   */
+  Page *CreatePage(page_id_t *page_id, bool allocate);
+
+  /**
+   * Release the frame of a completed prefetch read, called from the disk manager.
+   * @param request the completed read
+   */
+  void FinishPrefetch(const DiskRequest &request);
+
+  /**
+   * Start reading pages into free frames or clean victims, see PrefetchPgsImp.
+   * @param page_ids ids of the pages to read
+   * @return the number of reads started
+   */
+  size_t StartPrefetch(const std::vector<page_id_t> &page_ids);
+
+  /** Body of the page cleaner thread. */
+  void PageCleanerLoop();
+
+  /**
+   * Write out up to max_pages dirty, unpinned frames, in the order the replacer would evict them. The frames stay
+   * resident, unpinned and in the replacer; they are flagged cleaning_ and read-latched while the writes are in flight,
+   * so that each is written as of a single point in time. A frame whose page latch is taken is skipped.
+   * @param max_pages the maximum number of frames to clean
+   * @return the number of frames written, 0 if a write failed
+   */
+  size_t CleanPages(size_t max_pages);
+
+  /**
+   * Write out frames flagged cleaning_ and clear the flag; a page whose write fails is dirty again afterwards.
+   * @param requests the writes, one per frame
+   * @param pages the frames, counted in num_cleaning_
+   * @param max_lsn the highest page LSN among the frames
+   * @return the failure of the log flush or of the first write that failed, nullptr if every write succeeded
+   */
+  std::exception_ptr WriteCleaning(std::vector<DiskRequest> requests, const std::vector<Page *> &pages,
+                                   lsn_t max_lsn);
+
+  /**
+   * Make sure a page whose in-place write failed is written again: it is marked dirty if still resident, otherwise the
+   * thread that evicted it is told to write it out before it reuses the frame. Must be called with latch_ held.
+   * @param page the frame that was written from
+   * @param page_id the page that was written
+   */
+  void RedirtyUnwritten(Page *page, page_id_t page_id);
+
+  /**
+   * Check, once the frame is no longer cleaning_, whether the page cleaner failed to write out the page evicted from
+   * it, and reset the flag. Must be called with latch_ held.
+   * @param frame_id the frame
+   * @return true if the evictor has to write the victim out itself
+   */
+  bool TakeUnwrittenVictim(frame_id_t frame_id);
+
+  /**
+   * Wait on io_cv_ until pred holds, recording the time spent as pin wait if the caller had to wait at all.
+   * @param lock the caller's lock on latch_
+   * @param pred the condition to wait for, evaluated with latch_ held
+   */
+  template <typename Predicate>
+  void WaitForIo(std::unique_lock<InstrumentedMutex> *lock, Predicate pred) {
+    if (pred()) {
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    io_cv_.wait(*lock, pred);
+    metrics_.pin_wait_ns_.Record(NanosSince(start));
+  }
+
+  /**
+   * Make the log durable up to lsn before a page with that LSN is written out (write-ahead logging).
+   * @param lsn the LSN of the last change to the page, or the highest one among the pages written together
+   */
+  void FlushLog(lsn_t lsn);
+
+  /**
+   * Forget the recLSN of a page whose contents were just written out. A page that somebody has pinned or dirtied since
+   * may hold changes the write missed, it keeps the older recLSN. Must be called with latch_ held.
+   * @param page the frame that was written out
+   */
+  void ForgetRecLsn(Page *page);
+
+  /**
+   * Write out the old contents of a frame before it is reused, without holding latch_.
+   * @param victim_page_id the page the frame held
+   * @param page the frame
+   */
+  void WriteVictim(page_id_t victim_page_id, Page *page);
+
+  /**
+   * Clear the io-in-progress state of a frame and wake up every thread waiting on it.
+   * @param page the frame whose I/O completed
+   * @param victim_page_id the page that was written back from this frame, INVALID_PAGE_ID if none
+   */
+  void FinishIo(Page *page, page_id_t victim_page_id);
+
+  /**
+   * Give up on a frame whose page failed its checksum instead of calling FinishIo. The page leaves the page table,
+   * so fetches waiting for it read it again, and the frame drops the caller's pin.
+   * @param page the frame the page was read into
+   * @param victim_page_id the page that was written back from this frame, INVALID_PAGE_ID if none
+   */
+  void AbandonRead(Page *page, page_id_t victim_page_id);
+
+  /**
+   * Give up on reusing a frame whose victim could not be written out, instead of calling FinishIo. The victim becomes
+   * resident again, dirty and unpinned, and the frame drops the caller's pin.
+   * @param page the frame
+   * @param victim_page_id the page that was to be written back from this frame
+   */
+  void AbandonEviction(Page *page, page_id_t victim_page_id);
+
+  /** Pin count of a frame that is free or being handed to another page, lock-free fetches never pin it. */
+  static constexpr int FRAME_RESERVED = -1;
+
   /** Number of pages in the buffer pool. */
   const size_t pool_size_;
   /** How many instances are in the parallel BPM (if present, otherwise just 1 BPI) */
   const uint32_t num_instances_ = 1;
   /** Index of this BPI in the parallel BPM (if present, otherwise just 0) */
   const uint32_t instance_index_ = 0;
-  /** Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to its instance_index_ */
-  std::atomic<page_id_t> next_page_id_ = instance_index_;
+  /** Size of every frame, the page size of the disk manager's file. */
+  const size_t page_size_;
 
-  /** Array of buffer pool pages. */
+  /** Array of buffer pool pages, the book-keeping of every frame. */
   Page *pages_;
+  /** Page data of every frame. */
+  FrameArena frame_arena_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
-  LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  LogManager *log_manager_;
+  /** Page table for keeping track of buffer pool pages, updated under latch_ but read without it. */
+  PageTable page_table_;
   /** Replacer to find unpinned pages for replacement. */
   Replacer *replacer_;
-  /** List of free pages. */
-  std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
-  std::mutex latch_;
+  /** Stack of free frames, with room for every frame reserved up front so that freeing one never allocates. */
+  std::vector<frame_id_t> free_list_;
+  /** Size of free_list_, kept apart so that it can be read without latch_. */
+  std::atomic<size_t> num_free_frames_;
+  /** Evicted pages whose old contents are still being written out, mapped to the frame they are written from. */
+  PageTable writing_back_;
+  /** The recLSNs of the pages in writing_back_ that had one, they are on disk once the write completes. */
+  std::unordered_map<page_id_t, lsn_t> writing_back_rec_lsns_;
+  /** Frames whose evicted page the page cleaner failed to write out, protected by latch_; see RedirtyUnwritten. */
+  std::vector<bool> unwritten_victims_;
+  /** Statistics of this instance, see GetStats. */
+  BufferPoolMetrics metrics_;
+  /**
+   * This latch serializes changes to page_table_ and protects free_list_, writing_back_, writing_back_rec_lsns_ and the
+   * book-keeping fields of every frame. Fetching and unpinning a resident page only take it on the rare occasions that
+   * the lock-free path fails. It is never held across disk I/O or log flushes: a frame being loaded or reused is
+   * pinned and flagged io_in_progress_ instead, and a frame whose contents are written out in place is flagged
+   * cleaning_.
+   */
+  InstrumentedMutex latch_{&metrics_.latch_wait_ns_, &metrics_.latch_hold_ns_};
+  /** Signalled (with latch_) whenever a frame finishes its I/O. */
+  std::condition_variable_any io_cv_;
+
+  /** The page cleaner, see RunPageCleaner. */
+  std::thread cleaner_thread_;
+  /** True while the page cleaner should keep running, protected by latch_. */
+  bool cleaner_running_{false};
+  /** Number of frames flagged cleaning_, by the page cleaner or a flush, protected by latch_. */
+  size_t num_cleaning_{0};
+  /** Wakes the page cleaner up early, used with latch_. */
+  std::condition_variable_any cleaner_cv_;
+  /** Dirty frame counts at which the page cleaner starts and stops writing. */
+  size_t cleaner_high_dirty_{0};
+  size_t cleaner_low_dirty_{0};
+  /** Number of prefetch reads in flight, protected by latch_. */
+  size_t num_prefetching_{0};
 };
 }  // namespace bustub
@@ -0,0 +1,228 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.h
+//
+// Identification: src/include/buffer/buffer_pool_stats.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/** Number of shards of the sharded statistics, threads are spread over them round-robin. */
+static constexpr size_t STATS_SHARDS = 16;
+
+/** @return the statistics shard of the calling thread */
+inline size_t ThisThreadShard() {
+  static std::atomic<size_t> next_shard{0};
+  thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % STATS_SHARDS;
+  return shard;
+}
+
+/** @return nanoseconds elapsed since start */
+inline uint64_t NanosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * ShardedCounter is a counter that many threads can bump at once without fighting over a cache line: every thread
+ * adds to its own shard, and reading the counter sums the shards.
+ */
+class ShardedCounter {
+ public:
+  void Add(uint64_t n = 1) { shards_[ThisThreadShard()].value_.fetch_add(n, std::memory_order_relaxed); }
+
+  /** @return the sum of all shards, not atomic with respect to concurrent adds */
+  uint64_t Load() const;
+
+ private:
+  struct alignas(CACHE_LINE_SIZE) Shard {
+    std::atomic<uint64_t> value_{0};
+  };
+
+  std::array<Shard, STATS_SHARDS> shards_;
+};
+
+/**
+ * A point-in-time copy of a Histogram. Bucket 0 counts zeros and bucket i counts values in [2^(i-1), 2^i); the last
+ * bucket also counts everything larger.
+ */
+struct HistogramSnapshot {
+  static constexpr size_t NUM_BUCKETS = 40;
+
+  /** @return the number of recorded values */
+  uint64_t Count() const;
+
+  /** @return the mean of the recorded values, 0 if there are none */
+  double Mean() const;
+
+  /**
+   * @param fraction the fraction of values that must lie at or below the result, in [0, 1]
+   * @return upper bound of the bucket the percentile falls in, 0 if no values were recorded
+   */
+  uint64_t Percentile(double fraction) const;
+
+  HistogramSnapshot &operator+=(const HistogramSnapshot &other);
+
+  /** @return count, mean, median and 99th percentile on one line */
+  std::string ToString() const;
+
+  uint64_t sum_{0};
+  std::array<uint64_t, NUM_BUCKETS> buckets_{};
+};
+
+/**
+ * Histogram records a distribution, typically of latencies in nanoseconds, in power-of-two buckets. Like
+ * ShardedCounter it is sharded by thread so that recording only ever touches the recording thread's cache lines.
+ */
+class Histogram {
+ public:
+  void Record(uint64_t value) {
+    Shard &shard = shards_[ThisThreadShard()];
+    shard.buckets_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  /** @return the distribution recorded so far */
+  HistogramSnapshot Snapshot() const;
+
+ private:
+  static size_t BucketOf(uint64_t value) {
+    size_t bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    return bucket < HistogramSnapshot::NUM_BUCKETS ? bucket : HistogramSnapshot::NUM_BUCKETS - 1;
+  }
+
+  struct alignas(CACHE_LINE_SIZE) Shard {
+    std::array<std::atomic<uint64_t>, HistogramSnapshot::NUM_BUCKETS> buckets_{};
+    std::atomic<uint64_t> sum_{0};
+  };
+
+  std::array<Shard, STATS_SHARDS> shards_;
+};
+
+/**
+ * A mutex that records how long threads wait for it and how long they hold it. It meets the Lockable requirements, so
+ * it works with std::scoped_lock, std::unique_lock and std::condition_variable_any.
+ */
+class InstrumentedMutex {
+ public:
+  /**
+   * @param wait_ns histogram of the time lock() waits, uncontended acquisitions are recorded as 0
+   * @param hold_ns histogram of the time from acquiring to releasing the mutex
+   */
+  InstrumentedMutex(Histogram *wait_ns, Histogram *hold_ns) : wait_ns_(wait_ns), hold_ns_(hold_ns) {}
+
+  void lock() {  // NOLINT
+    if (mutex_.try_lock()) {
+      acquired_at_ = std::chrono::steady_clock::now();
+      wait_ns_->Record(0);
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    mutex_.lock();
+    acquired_at_ = std::chrono::steady_clock::now();
+    wait_ns_->Record(std::chrono::duration_cast<std::chrono::nanoseconds>(acquired_at_ - start).count());
+  }
+
+  bool try_lock() {  // NOLINT
+    if (!mutex_.try_lock()) {
+      return false;
+    }
+    acquired_at_ = std::chrono::steady_clock::now();
+    return true;
+  }
+
+  void unlock() {  // NOLINT
+    // only the holder touches acquired_at_
+    hold_ns_->Record(NanosSince(acquired_at_));
+    mutex_.unlock();
+  }
+
+ private:
+  std::mutex mutex_;
+  Histogram *wait_ns_;
+  Histogram *hold_ns_;
+  std::chrono::steady_clock::time_point acquired_at_;
+};
+
+/**
+ * A snapshot of the statistics of a buffer pool. Snapshots of several pools add up to the statistics of all of them.
+ * Counters only grow, so the difference between two snapshots of the same pool covers the time in between.
+ */
+struct BufferPoolStats {
+  /** @return hits / (hits + misses), 0 if nothing was fetched */
+  double HitRatio() const;
+
+  BufferPoolStats &operator+=(const BufferPoolStats &other);
+
+  /** @return the statistics, one per line */
+  std::string ToString() const;
+
+  /** Fetches of a resident page. */
+  uint64_t hits_{0};
+  /** Fetches that had to read the page. */
+  uint64_t misses_{0};
+  /** Pages evicted to make room, by fetches, new pages and prefetches. */
+  uint64_t evictions_{0};
+  /** Evicted pages that had to be written first, by the thread that needed the frame. */
+  uint64_t dirty_evictions_{0};
+  /** Dirty pages written out by the page cleaner. */
+  uint64_t background_writes_{0};
+  /** Pages read in by PrefetchPages. */
+  uint64_t prefetched_pages_{0};
+  /** Time a fetch or new page waited for another thread's I/O on the frame or page it needed. */
+  HistogramSnapshot pin_wait_ns_;
+  /** Time spent waiting for the buffer pool latch. */
+  HistogramSnapshot latch_wait_ns_;
+  /** Time the buffer pool latch was held. */
+  HistogramSnapshot latch_hold_ns_;
+  /** Latency of the page reads of fetches. */
+  HistogramSnapshot read_ns_;
+  /** Latency of the page writes of evictions and flushes. */
+  HistogramSnapshot write_ns_;
+  /** Number of evictable frames, at the time of the snapshot. */
+  size_t replacer_size_{0};
+  /** Number of resident pages, at the time of the snapshot. */
+  size_t resident_pages_{0};
+  /** Number of free frames, at the time of the snapshot. */
+  size_t free_frames_{0};
+};
+
+/**
+ * The live statistics of a buffer pool, cheap enough to always keep: the fast paths only bump per-thread shards.
+ */
+struct BufferPoolMetrics {
+  /**
+   * Copy the counters and histograms into a snapshot, leaving the point-in-time sizes alone.
+   * @param[out] stats the snapshot to fill in
+   */
+  void Snapshot(BufferPoolStats *stats) const;
+
+  ShardedCounter hits_;
+  ShardedCounter misses_;
+  ShardedCounter evictions_;
+  ShardedCounter dirty_evictions_;
+  ShardedCounter background_writes_;
+  ShardedCounter prefetched_pages_;
+  Histogram pin_wait_ns_;
+  Histogram latch_wait_ns_;
+  Histogram latch_hold_ns_;
+  Histogram read_ns_;
+  Histogram write_ns_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,104 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_warmer.h
+//
+// Identification: src/include/buffer/buffer_pool_warmer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * BufferPoolWarmer carries the working set of a buffer pool across restarts.
+ *
+ * While the system runs, it saves the ids of the resident pages, hottest first, to a small file. After a restart,
+ * WarmUp reads the list back and loads those pages with batched reads, so that the first queries do not have to fault
+ * the working set in one page at a time. The file is only a hint: a missing, stale or damaged list costs a cold start,
+ * never correctness.
+ */
+class BufferPoolWarmer {
+ public:
+  /**
+   * Creates a new BufferPoolWarmer.
+   * @param buffer_pool_manager the buffer pool to save and warm up
+   * @param file_name the file the hot page list is kept in
+   */
+  BufferPoolWarmer(BufferPoolManager *buffer_pool_manager, std::string file_name);
+
+  /**
+   * Stops the dump thread, saving the list one last time if it was running.
+   */
+  ~BufferPoolWarmer();
+
+  /**
+   * Save the hot page list of the buffer pool. The list is written to a temporary file that then replaces the old
+   * one, so a crash while saving leaves the previous list behind.
+   * @return false if the list could not be written
+   */
+  bool Dump();
+
+  /**
+   * Load the pages of the saved hot page list into the buffer pool and wait for them.
+   * @return the number of pages read, 0 if there is no usable list
+   */
+  size_t WarmUp();
+
+  /**
+   * Read the saved hot page list.
+   * @param[out] page_ids the saved page ids, hottest first
+   * @return false if there is no list or it is damaged
+   */
+  bool Load(std::vector<page_id_t> *page_ids);
+
+  /**
+   * Start saving the hot page list every buffer_pool_dump_interval in the background.
+   */
+  void RunDumpThread();
+
+  /**
+   * Stop and join the dump thread after saving the list a last time, a no-op if it is not running.
+   */
+  void StopDumpThread();
+
+  /** @return the file the hot page list is kept in */
+  const std::string &GetFileName() const { return file_name_; }
+
+ private:
+  /** Marks a hot page list file, followed by the number of page ids and the page ids themselves. */
+  static constexpr uint32_t MAGIC = 0x42505731;  // "BPW1"
+
+  /** Body of the dump thread. */
+  void DumpLoop();
+
+  BufferPoolManager *buffer_pool_manager_;
+  const std::string file_name_;
+
+  /** The dump thread, see RunDumpThread. */
+  std::thread dump_thread_;
+  /** True while the dump thread should keep running, protected by latch_. */
+  bool dump_running_{false};
+  /** Wakes the dump thread up to stop, used with latch_. */
+  std::condition_variable dump_cv_;
+  /** Protects dump_running_. */
+  std::mutex latch_;
+  /** Serializes writing the file. */
+  std::mutex file_latch_;
+};
+
+}  // namespace bustub
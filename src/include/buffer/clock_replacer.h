@@ -12,8 +12,8 @@
 
 #pragma once
 
-#include <list>
-#include <mutex>  // NOLINT
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 #include "buffer/replacer.h"
@@ -23,6 +23,9 @@ namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * It keeps no lock: every frame has one atomic state byte, so Pin and Unpin are a single atomic exchange, and Victim
+ * sweeps the clock hand with compare-and-swap, clearing reference bits until it claims an unreferenced frame.
  */
 class ClockReplacer : public Replacer {
  public:
@@ -45,8 +48,21 @@ class ClockReplacer : public Replacer {
 
   size_t Size() override;
 
+  std::vector<frame_id_t> PeekVictims(size_t max_frames) override;
+
  private:
-  // TODO(student): implement me!
+  /** The frame is in the replacer, i.e. it can be victimized. */
+  static constexpr uint8_t IN_REPLACER = 0x1;
+  /** The frame was unpinned since the clock hand last passed it. */
+  static constexpr uint8_t REFERENCED = 0x2;
+
+  const size_t num_pages_;
+  /** State of every frame, 0 if the frame is not in the replacer. */
+  std::vector<std::atomic<uint8_t>> states_;
+  /** Position of the clock hand, taken modulo num_pages_. */
+  std::atomic<size_t> hand_{0};
+  /** Number of frames in the replacer. */
+  std::atomic<size_t> size_{0};
 };
 
 }  // namespace bustub
@@ -0,0 +1,78 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// extent_allocator.h
+//
+// Identification: src/include/buffer/extent_allocator.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/config.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * ExtentAllocator creates the new pages of one table heap or index from extents, runs of contiguous pages allocated
+ * together, so that the structure's pages end up next to each other in the file instead of interleaved with those of
+ * every other structure, and a scan over them reads the file sequentially.
+ *
+ * Extents start small and double up to max_extent_pages, so a small structure does not reserve a large extent it will
+ * never fill. Pages of the current extent that are never created are free again once the database is reopened, see
+ * BufferPoolManager::AllocateExtent. If the buffer pool does not support extents, pages are created one by one with
+ * BufferPoolManager::NewPage.
+ *
+ * All extents are allocated in one tablespace, which places the structure in that tablespace's file.
+ */
+class ExtentAllocator {
+ public:
+  /** Size of the first extent. */
+  static constexpr uint32_t MIN_EXTENT_PAGES = 8;
+  /** Size that extents grow to when none is specified. */
+  static constexpr uint32_t DEFAULT_EXTENT_PAGES = 64;
+
+  /**
+   * Create a new ExtentAllocator.
+   * @param buffer_pool_manager the buffer pool to create pages in
+   * @param max_extent_pages the size extents grow to, a power of two
+   * @param tablespace_id the tablespace to allocate the extents in
+   */
+  explicit ExtentAllocator(BufferPoolManager *buffer_pool_manager, uint32_t max_extent_pages = DEFAULT_EXTENT_PAGES,
+                           tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID);
+
+  /**
+   * Creates a new page in the buffer pool, the next page of the current extent.
+   * @param[out] page_id id of created page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  Page *NewPage(page_id_t *page_id);
+
+  /**
+   * Creates a new page of the current extent and wraps its pin in a guard.
+   * @param[out] page_id id of created page
+   * @return a guard holding the new page, empty if no new page could be created
+   */
+  BasicPageGuard NewPageGuarded(page_id_t *page_id) { return BasicPageGuard(buffer_pool_manager_, NewPage(page_id)); }
+
+ private:
+  BufferPoolManager *buffer_pool_manager_;
+  const uint32_t max_extent_pages_;
+  const tablespace_id_t tablespace_id_;
+  /** Size of the next extent to allocate. */
+  uint32_t extent_pages_;
+  /** The pages of the current extent that have not been created yet, [next_page_id_, end_page_id_). */
+  page_id_t next_page_id_{INVALID_PAGE_ID};
+  page_id_t end_page_id_{INVALID_PAGE_ID};
+  // this protects the extent fields above
+  std::mutex latch_;
+};
+
+}  // namespace bustub
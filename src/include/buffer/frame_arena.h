@@ -0,0 +1,72 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.h
+//
+// Identification: src/include/buffer/frame_arena.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * FrameArena is the memory holding the page data of a buffer pool's frames: one anonymous mapping, kept apart from
+ * the frames' book-keeping so that the data is densely packed and every frame is page-aligned for direct I/O.
+ *
+ * Large pools touch far more memory than the TLB covers with regular pages, so the arena can be backed by huge pages,
+ * either transparent ones or the system's explicitly reserved pool. The mapping is zero-filled and only faulted in as
+ * frames are first touched.
+ */
+class FrameArena {
+ public:
+  /** Size of a huge page, and the granularity in which explicit huge page mappings are sized. */
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  /**
+   * Map the memory for a number of frames.
+   * @param num_frames number of frames
+   * @param huge_pages how to back the arena with huge pages
+   * @param frame_size size of a frame, the page size of the buffer pool
+   */
+  FrameArena(size_t num_frames, HugePagePolicy huge_pages, size_t frame_size = PAGE_SIZE);
+
+  /** Unmaps the arena. */
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  /** @return the page data of a frame */
+  char *GetFrame(frame_id_t frame_id) const { return data_ + static_cast<size_t>(frame_id) * frame_size_; }
+
+  /** @return the frame whose page data starts at frame */
+  frame_id_t GetFrameId(const char *frame) const { return static_cast<frame_id_t>((frame - data_) / frame_size_); }
+
+  /** @return the start of the arena */
+  char *GetData() const { return data_; }
+
+  /** @return the number of bytes used for frames */
+  size_t GetSize() const { return size_; }
+
+  /** @return the huge page policy that was actually applied, EXPLICIT falls back to TRANSPARENT */
+  HugePagePolicy GetHugePagePolicy() const { return huge_pages_; }
+
+ private:
+  char *data_;
+  size_t frame_size_;
+  size_t size_;
+  /** Length of the mapping, size_ rounded up to whole huge pages for an explicit huge page mapping. */
+  size_t mapped_size_;
+  HugePagePolicy huge_pages_;
+};
+
+}  // namespace bustub
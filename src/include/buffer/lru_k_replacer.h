@@ -0,0 +1,97 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy.
+ *
+ * The victim is the evictable frame whose K-th most recent access lies furthest in the past. Frames accessed fewer
+ * than K times have an infinite backward K-distance and are evicted first, oldest first access first, so pages read
+ * once by a scan go before pages that are used over and over. Every Pin counts as an access; accesses to a frame
+ * within correlated_period accesses of its previous one are treated as the same reference, so fetching a page once
+ * per tuple does not make it look hot.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k the number of accesses the backward distance is measured over
+   * @param correlated_period accesses (to any frame) within which two accesses to a frame count as one, defaults to
+   * num_pages
+   */
+  explicit LRUKReplacer(size_t num_pages, size_t k = 2, size_t correlated_period = 0);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  void Admit(frame_id_t frame_id, page_id_t page_id) override;
+
+  size_t Size() override;
+
+  std::vector<frame_id_t> PeekVictims(size_t max_frames) override;
+
+ private:
+  /** Book-keeping of one frame the replacer knows about. */
+  struct FrameInfo {
+    /** Timestamps of the last (up to) K uncorrelated accesses, oldest first. */
+    std::deque<uint64_t> history_;
+    /** When the frame's page was loaded, orders frames that have not been accessed yet. */
+    uint64_t admitted_at_{0};
+    /** True while the frame is in one of the eviction sets. */
+    bool evictable_{false};
+  };
+
+  /** Eviction order: frames with fewer than K accesses first, then by the timestamp the distance is measured from. */
+  using eviction_key_t = std::pair<uint64_t, frame_id_t>;
+
+  eviction_key_t EvictionKey(frame_id_t frame_id, const FrameInfo &info) const;
+
+  void Remove(frame_id_t frame_id, FrameInfo *info);
+
+  const size_t k_;
+  const size_t correlated_period_;
+  /** Logical clock, advanced by every access. */
+  uint64_t current_timestamp_{0};
+  std::unordered_map<frame_id_t, FrameInfo> frames_;
+  /** Evictable frames accessed fewer than K times. */
+  std::set<eviction_key_t> cold_;
+  /** Evictable frames accessed at least K times. */
+  std::set<eviction_key_t> hot_;
+
+  // this protects every member above
+  std::mutex latch_;
+};
+
+}  // namespace bustub
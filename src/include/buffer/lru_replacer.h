@@ -12,9 +12,7 @@
 
 #pragma once
 
-#include <list>
 #include <mutex>  // NOLINT
-#include <unordered_map>
 #include <vector>
 
 #include "buffer/replacer.h"
@@ -24,6 +22,8 @@ namespace bustub {
 
 /**
  * LRUReplacer implements the Least Recently Used replacement policy.
+ *
+ * The LRU list is threaded through arrays indexed by frame id, so that Pin and Unpin do not allocate.
  */
 class LRUReplacer : public Replacer {
  public:
@@ -46,12 +46,22 @@ class LRUReplacer : public Replacer {
 
   size_t Size() override;
 
+  std::vector<frame_id_t> PeekVictims(size_t max_frames) override;
+
  private:
-  using replacer_list_t = std::list<frame_id_t>;
-  replacer_list_t lst_{};
-  std::unordered_map<frame_id_t, replacer_list_t::iterator> frame_table_{};
+  /** Unlink frame_id from the list, it must be in it. */
+  void Remove(frame_id_t frame_id);
+
+  /** Index of the list head in prev_ and next_; its next is the least recently used frame. */
+  const frame_id_t head_;
+  /** Links of the circular LRU list, one entry per frame plus the head. */
+  std::vector<frame_id_t> prev_;
+  std::vector<frame_id_t> next_;
+  /** True for the frames that are in the list. */
+  std::vector<bool> in_list_;
+  size_t size_{0};
 
-  // this protects both lst_ and frame_table_
+  // this protects every member above
   std::mutex latch_{};
 };
 
@@ -0,0 +1,175 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard.h
+//
+// Identification: src/include/buffer/page_guard.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "common/config.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+class ReadPageGuard;
+class WritePageGuard;
+
+/**
+ * BasicPageGuard owns one pin of a page and releases it when it goes out of scope, so a pin can neither leak nor be
+ * released twice. It keeps the frame the page is in, and the release goes straight to that frame instead of looking
+ * the page up again. Guards are move-only; a default-constructed guard, or one built from a failed fetch, holds
+ * nothing and tests false.
+ */
+class BasicPageGuard {
+ public:
+  BasicPageGuard() = default;
+
+  /**
+   * Take over a pin of a page.
+   * @param bpm the buffer pool the page was pinned in
+   * @param page the pinned page, nullptr for an empty guard
+   */
+  BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+  BasicPageGuard(const BasicPageGuard &) = delete;
+  BasicPageGuard &operator=(const BasicPageGuard &) = delete;
+  BasicPageGuard(BasicPageGuard &&that) noexcept;
+  BasicPageGuard &operator=(BasicPageGuard &&that) noexcept;
+
+  /** Releases the pin, see Drop. */
+  ~BasicPageGuard() { Drop(); }
+
+  /**
+   * Release the pin now, marking the page dirty if SetDirty was called. The guard is empty afterwards.
+   */
+  void Drop();
+
+  /**
+   * Take the page's read latch, moving the pin into the returned guard, which marks the page dirty when it is dropped
+   * if SetDirty was called on this one. This guard is empty afterwards.
+   * @return a guard holding the pin and the read latch
+   */
+  ReadPageGuard UpgradeRead();
+
+  /**
+   * Take the page's write latch, moving the pin into the returned guard. This guard is empty afterwards.
+   * @return a guard holding the pin and the write latch
+   */
+  WritePageGuard UpgradeWrite();
+
+  /** @return true if the guard holds a page */
+  explicit operator bool() const { return page_ != nullptr; }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() const { return page_->GetPageId(); }
+
+  /** @return the guarded page */
+  Page *GetPage() const { return page_; }
+
+  /** @return the data of the guarded page */
+  char *GetData() const { return page_->GetData(); }
+
+  /** @return the data of the guarded page, viewed as a T */
+  template <class T>
+  T *As() const {
+    return reinterpret_cast<T *>(page_->GetData());
+  }
+
+  /** Mark the page dirty, it is written back before its frame is reused. */
+  void SetDirty() { is_dirty_ = true; }
+
+ private:
+  BufferPoolManager *bpm_{nullptr};
+  Page *page_{nullptr};
+  bool is_dirty_{false};
+};
+
+/**
+ * ReadPageGuard owns one pin and the read latch of a page, and releases both when it goes out of scope.
+ */
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+
+  /**
+   * Take over a pin of a page and acquire the page's read latch.
+   * @param bpm the buffer pool the page was pinned in
+   * @param page the pinned page, nullptr for an empty guard
+   */
+  ReadPageGuard(BufferPoolManager *bpm, Page *page);
+
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+  ReadPageGuard &operator=(ReadPageGuard &&that) noexcept;
+
+  /** Releases the latch and the pin, see Drop. */
+  ~ReadPageGuard() { Drop(); }
+
+  /**
+   * Release the read latch and then the pin now. The guard is empty afterwards.
+   */
+  void Drop();
+
+  explicit operator bool() const { return static_cast<bool>(guard_); }
+  page_id_t PageId() const { return guard_.PageId(); }
+  Page *GetPage() const { return guard_.GetPage(); }
+  char *GetData() const { return guard_.GetData(); }
+  template <class T>
+  T *As() const {
+    return guard_.As<T>();
+  }
+
+ private:
+  // it hands a pending SetDirty over in UpgradeRead
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
+/**
+ * WritePageGuard owns one pin and the write latch of a page, and releases both when it goes out of scope.
+ */
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+
+  /**
+   * Take over a pin of a page and acquire the page's write latch.
+   * @param bpm the buffer pool the page was pinned in
+   * @param page the pinned page, nullptr for an empty guard
+   */
+  WritePageGuard(BufferPoolManager *bpm, Page *page);
+
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+  WritePageGuard &operator=(WritePageGuard &&that) noexcept;
+
+  /** Releases the latch and the pin, see Drop. */
+  ~WritePageGuard() { Drop(); }
+
+  /**
+   * Release the write latch and then the pin now, marking the page dirty if SetDirty was called. The guard is empty
+   * afterwards.
+   */
+  void Drop();
+
+  explicit operator bool() const { return static_cast<bool>(guard_); }
+  page_id_t PageId() const { return guard_.PageId(); }
+  Page *GetPage() const { return guard_.GetPage(); }
+  char *GetData() const { return guard_.GetData(); }
+  template <class T>
+  T *As() const {
+    return guard_.As<T>();
+  }
+  void SetDirty() { guard_.SetDirty(); }
+
+ private:
+  BasicPageGuard guard_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,88 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.h
+//
+// Identification: src/include/buffer/page_table.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * PageTable maps the ids of resident pages to the frames that hold them.
+ *
+ * It is a fixed-capacity open-addressing hash table with linear probing, whose slots are single atomic words. Updates
+ * must be serialized by the caller, but lookups take no latch and can run concurrently with them. A lookup racing with
+ * Erase may miss a page that is present, so a miss is only a hint that has to be confirmed under the writers' latch,
+ * and a hit has to be validated against the frame, which may have been given to another page since.
+ */
+class PageTable {
+ public:
+  /**
+   * Create a new PageTable.
+   * @param num_frames the maximum number of pages the table will have to hold
+   */
+  explicit PageTable(size_t num_frames);
+
+  /**
+   * Look up the frame of a page, safe to call without holding the writers' latch.
+   * @param page_id the page to look up
+   * @param[out] frame_id the frame that held the page when it was looked up
+   * @return true if the page was found
+   */
+  bool Find(page_id_t page_id, frame_id_t *frame_id) const;
+
+  /**
+   * Map a page that is not in the table yet to its frame.
+   * @param page_id the page
+   * @param frame_id the frame holding it
+   */
+  void Insert(page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * Remove the mapping of a page.
+   * @param page_id the page
+   * @return false if the page was not in the table
+   */
+  bool Erase(page_id_t page_id);
+
+  /** @return the number of pages in the table */
+  size_t Size() const { return size_; }
+
+ private:
+  /** A slot holds the page id in its upper and the frame id in its lower 32 bits. */
+  static constexpr uint64_t EMPTY_SLOT = UINT64_MAX;
+
+  static uint64_t Pack(page_id_t page_id, frame_id_t frame_id) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(page_id)) << 32) | static_cast<uint32_t>(frame_id);
+  }
+  static page_id_t SlotPageId(uint64_t slot) { return static_cast<page_id_t>(slot >> 32); }
+  static frame_id_t SlotFrameId(uint64_t slot) { return static_cast<frame_id_t>(slot & UINT32_MAX); }
+
+  /** @return the slot a page's probe sequence starts at */
+  size_t Home(page_id_t page_id) const {
+    // page ids are dense, Fibonacci hashing spreads them over the table
+    return (static_cast<uint32_t>(page_id) * UINT64_C(0x9E3779B97F4A7C15)) >> shift_;
+  }
+
+  size_t capacity_;
+  size_t mask_;
+  unsigned shift_;
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+  /** Number of pages in the table, maintained by the (serialized) writers. */
+  size_t size_{0};
+};
+
+}  // namespace bustub
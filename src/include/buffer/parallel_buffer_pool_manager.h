@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <memory>
+#include <utility>
 #include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "buffer/buffer_pool_manager_instance.h"
@@ -31,9 +32,12 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    * @param pool_size the pool size of each BufferPoolManagerInstance
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy of every BufferPoolManagerInstance
+   * @param numa_aware if true, the frames of the instances are spread round robin over the NUMA nodes
    */
   ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                            LogManager *log_manager = nullptr);
+                            LogManager *log_manager = nullptr, ReplacerType replacer_type = ReplacerType::LRU,
+                            bool numa_aware = false);
 
   /**
    * Destroys an existing ParallelBufferPoolManager.
@@ -43,6 +47,15 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override;
 
+  /** @return the page size of the instances */
+  size_t GetPageSize() override { return instances_[0]->GetPageSize(); }
+
+  /**
+   * @param instance_index index of a BufferPoolManagerInstance
+   * @return the statistics of that instance alone
+   */
+  BufferPoolStats GetInstanceStats(size_t instance_index) { return instances_[instance_index]->GetStats(); }
+
  protected:
   /**
    * @param page_id id of page
@@ -65,6 +78,13 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   bool UnpinPgImp(page_id_t page_id, bool is_dirty) override;
 
+  /**
+   * Unpin a page through its frame in the responsible BufferPoolManagerInstance
+   * @param page a page pinned by the caller
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   */
+  void UnpinFrameImp(Page *page, bool is_dirty) override;
+
   /**
    * Flushes the target page to disk.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
@@ -91,10 +111,57 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   void FlushAllPgsImp() override;
 
+  /**
+   * Start reading pages into the buffer pool, each page in its responsible BufferPoolManagerInstance
+   * @param page_ids ids of the pages that are about to be fetched
+   */
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids) override;
+
+  /**
+   * Allocate an extent on disk, its pages are spread over the BufferPoolManagerInstances like any others
+   * @param num_pages number of pages in the extent
+   * @param tablespace_id the tablespace to allocate in
+   * @return id of the first page of the extent
+   */
+  page_id_t AllocateExtentImp(uint32_t num_pages, tablespace_id_t tablespace_id) override;
+
+  /**
+   * Creates a new page of an extent in its responsible BufferPoolManagerInstance
+   * @param page_id id of the page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  Page *NewPgInExtentImp(page_id_t page_id) override;
+
+  /**
+   * List the hottest pages of every BufferPoolManagerInstance, taking turns between the instances so that the
+   * hottest pages of each come first
+   * @param max_pages the maximum number of pages to list
+   * @return ids of the hottest resident pages
+   */
+  std::vector<page_id_t> GetHotPgsImp(size_t max_pages) override;
+
+  /**
+   * List the dirty-page tables of all BufferPoolManagerInstances
+   * @return (page id, recLSN) of every page whose logged changes may not be on disk
+   */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPgsImp() override;
+
+  /**
+   * Load pages into their responsible BufferPoolManagerInstances and wait for them
+   * @param page_ids ids of the pages to load, hottest first
+   * @return the number of pages read
+   */
+  size_t WarmUpImp(const std::vector<page_id_t> &page_ids) override;
+
+  /**
+   * Take a snapshot of the statistics of every BufferPoolManagerInstance and add them up
+   * @return the statistics of the whole pool
+   */
+  BufferPoolStats GetStatsImp() override;
+
  private:
-  // try to create new page from this index
-  size_t next_instance_{0};
-  std::mutex next_instance_latch_{};
+  // NewPage starts looking for a frame at this index (mod num_instances_), every call moves it on by one
+  std::atomic<size_t> next_instance_{0};
 
   size_t num_instances_{};
   std::vector<std::unique_ptr<BufferPoolManagerInstance>> instances_{};
@@ -12,10 +12,15 @@
 
 #pragma once
 
+#include <vector>
+
 #include "common/config.h"
 
 namespace bustub {
 
+/** The replacement policies a BufferPoolManagerInstance can be created with. */
+enum class ReplacerType { LRU, LRU_K, TWO_Q, CLOCK };
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -43,8 +48,23 @@ class Replacer {
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Tell the replacer that page_id has just been loaded into frame_id, which is pinned, so any state kept about the
+   * frame's previous page no longer applies. Policies that remember evicted pages use it to recognise returning pages.
+   * @param frame_id the id of the frame
+   * @param page_id the id of the page now held by the frame
+   */
+  virtual void Admit(frame_id_t frame_id, page_id_t page_id) {}
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual size_t Size() = 0;
+
+  /**
+   * Look at the frames that would be victimized next, without removing them from the replacer.
+   * @param max_frames the maximum number of frames to return
+   * @return up to max_frames frames, in the order Victim would return them; empty if the policy cannot tell
+   */
+  virtual std::vector<frame_id_t> PeekVictims(size_t max_frames) { return {}; }
 };
 
 }  // namespace bustub
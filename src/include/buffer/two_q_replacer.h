@@ -0,0 +1,101 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// two_q_replacer.h
+//
+// Identification: src/include/buffer/two_q_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <list>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * TwoQReplacer implements the full 2Q replacement policy (Johnson and Shasha).
+ *
+ * A newly loaded page enters A1in, a FIFO. Accesses while it is there are considered correlated and do not promote it.
+ * When it is evicted from A1in its page id is remembered in the ghost queue A1out; if the page is loaded again while
+ * it is still remembered, it goes into Am, an LRU queue that only competes with A1in once A1in is down to its target
+ * size. A scan therefore only ever cycles through A1in and leaves the frequently used pages in Am alone.
+ */
+class TwoQReplacer : public Replacer {
+ public:
+  /**
+   * Create a new TwoQReplacer.
+   * @param num_pages the maximum number of pages the TwoQReplacer will be required to store
+   * @param a1in_fraction fraction of num_pages that A1in may occupy before it is preferred for eviction
+   * @param a1out_fraction number of evicted page ids to remember, as a fraction of num_pages
+   */
+  explicit TwoQReplacer(size_t num_pages, double a1in_fraction = 0.25, double a1out_fraction = 1.0);
+
+  /**
+   * Destroys the TwoQReplacer.
+   */
+  ~TwoQReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  void Admit(frame_id_t frame_id, page_id_t page_id) override;
+
+  size_t Size() override;
+
+  std::vector<frame_id_t> PeekVictims(size_t max_frames) override;
+
+ private:
+  using frame_list_t = std::list<frame_id_t>;
+
+  /** Book-keeping of one frame the replacer knows about. */
+  struct FrameInfo {
+    page_id_t page_id_{INVALID_PAGE_ID};
+    /** True if the frame is in Am, false if it is in A1in. */
+    bool in_am_{false};
+    bool evictable_{false};
+    /** Position in a1in_ or am_. */
+    frame_list_t::iterator pos_;
+  };
+
+  /** @return the queue to evict from next, considering only evictable frames */
+  frame_list_t *VictimQueue();
+
+  /** Start tracking frame_id at the tail of A1in, or of Am if its page was recently evicted from A1in. */
+  FrameInfo &Track(frame_id_t frame_id, page_id_t page_id);
+
+  void Forget(frame_id_t frame_id);
+
+  /** @return the oldest evictable frame of queue, queue->end() if there is none */
+  frame_list_t::iterator FirstEvictable(frame_list_t *queue);
+
+  const size_t a1in_target_;
+  const size_t a1out_size_;
+  /** FIFO of first-time frames, oldest first. */
+  frame_list_t a1in_;
+  /** LRU of frames whose page was re-referenced after leaving A1in, least recently used first. */
+  frame_list_t am_;
+  /** Ghost FIFO of page ids recently evicted from A1in, oldest first. */
+  std::list<page_id_t> a1out_;
+  std::unordered_map<page_id_t, std::list<page_id_t>::iterator> a1out_index_;
+  std::unordered_map<frame_id_t, FrameInfo> frames_;
+  /** Number of evictable frames in a1in_ and am_. */
+  size_t num_evictable_{0};
+
+  // this protects every member above
+  std::mutex latch_;
+};
+
+}  // namespace bustub
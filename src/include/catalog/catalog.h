@@ -119,15 +119,17 @@ class Catalog {
    * @param txn The transaction in which the table is being created
    * @param table_name The name of the new table
    * @param schema The schema of the new table
+   * @param tablespace_id The tablespace whose file the table is placed in
    * @return A (non-owning) pointer to the metadata for the table
    */
-  TableInfo *CreateTable(Transaction *txn, const std::string &table_name, const Schema &schema) {
+  TableInfo *CreateTable(Transaction *txn, const std::string &table_name, const Schema &schema,
+                         tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID) {
     if (table_names_.count(table_name) != 0) {
       return NULL_TABLE_INFO;
     }
 
     // Construct the table heap
-    auto table = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn);
+    auto table = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn, tablespace_id);
 
     // Fetch the table OID for the new table
     const auto table_oid = next_table_oid_.fetch_add(1);
@@ -186,12 +188,14 @@ class Catalog {
    * @param key_attrs Key attributes
    * @param keysize Size of the key
    * @param hash_function The hash function for the index
+   * @param tablespace_id The tablespace whose file the index is placed in, which need not be that of the table
    * @return A (non-owning) pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
   IndexInfo *CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
-                         std::size_t keysize, HashFunction<KeyType> hash_function) {
+                         std::size_t keysize, HashFunction<KeyType> hash_function,
+                         tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID) {
     // Reject the creation request for nonexistent table
     if (table_names_.find(table_name) == table_names_.end()) {
       return NULL_INDEX_INFO;
@@ -214,8 +218,8 @@ class Catalog {
     // TODO(Kyle): We should update the API for CreateIndex
     // to allow specification of the index type itself, not
     // just the key, value, and comparator types
-    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
-                                                                                               hash_function);
+    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(
+        std::move(meta), bpm_, hash_function, tablespace_id);
 
     // Populate the index with all tuples in table heap
     auto *table_meta = GetTable(table_name);
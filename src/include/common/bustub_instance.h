@@ -13,17 +13,25 @@
 #include <string>
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/buffer_pool_warmer.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "recovery/checkpoint_manager.h"
 #include "recovery/log_manager.h"
+#include "recovery/log_recovery.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
 
 class BustubInstance {
  public:
-  explicit BustubInstance(const std::string &db_file_name) {
+  /**
+   * Open the database, without recovering it: see Recover.
+   * @param db_file_name the file name of the database's main file
+   * @param warm_up_buffer_pool true to reload the pages the last run was working on once the database is recovered, and
+   * to keep saving the list of them while running
+   */
+  explicit BustubInstance(const std::string &db_file_name, bool warm_up_buffer_pool = false) {
     enable_logging = false;
 
     // storage related
@@ -34,6 +42,12 @@ class BustubInstance {
 
     buffer_pool_manager_ = new BufferPoolManagerInstance(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
 
+    // the pool is only warmed up by Recover, the pages must not be read before they are brought up to date
+    if (warm_up_buffer_pool) {
+      std::string::size_type n = db_file_name.rfind('.');
+      buffer_pool_warmer_ = new BufferPoolWarmer(buffer_pool_manager_, db_file_name.substr(0, n) + ".warm");
+    }
+
     // txn related
     lock_manager_ = new LockManager();
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
@@ -42,11 +56,26 @@ class BustubInstance {
     checkpoint_manager_ = new CheckpointManager(transaction_manager_, log_manager_, buffer_pool_manager_);
   }
 
+  /**
+   * Redo and undo the log, so the database holds what the committed transactions left, and then warm up the buffer
+   * pool if the instance was opened to. Must be called before logging is turned on and queries are taken.
+   */
+  void Recover() {
+    LogRecovery log_recovery(disk_manager_, buffer_pool_manager_);
+    log_recovery.Redo();
+    log_recovery.Undo();
+    if (buffer_pool_warmer_ != nullptr) {
+      buffer_pool_warmer_->WarmUp();
+      buffer_pool_warmer_->RunDumpThread();
+    }
+  }
+
   ~BustubInstance() {
     if (enable_logging) {
       log_manager_->StopFlushThread();
     }
     delete checkpoint_manager_;
+    delete buffer_pool_warmer_;
     delete log_manager_;
     delete buffer_pool_manager_;
     delete lock_manager_;
@@ -56,6 +85,8 @@ class BustubInstance {
 
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
+  /** nullptr unless the instance warms up its buffer pool */
+  BufferPoolWarmer *buffer_pool_warmer_{nullptr};
   LockManager *lock_manager_;
   TransactionManager *transaction_manager_;
   LogManager *log_manager_;
@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <chrono>  // NOLINT
+#include <cstddef>
 #include <cstdint>
 
 namespace bustub {
@@ -27,14 +28,44 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** A running page cleaner checks the dirty page count of its buffer pool every PAGE_CLEANER_INTERVAL. */
+extern std::chrono::milliseconds page_cleaner_interval;
+
+/** A running buffer pool warmer saves the hot page list of its buffer pool every BUFFER_POOL_DUMP_INTERVAL. */
+extern std::chrono::milliseconds buffer_pool_dump_interval;
+
+/** A sequential scan keeps up to SCAN_READ_AHEAD_PAGES upcoming table heap pages in flight, 0 disables read-ahead. */
+extern std::atomic<size_t> scan_read_ahead_pages;
+
+/** How the page frames of a buffer pool are backed by huge pages. */
+enum class HugePagePolicy {
+  /** Regular pages only. */
+  NEVER,
+  /** Ask for transparent huge pages, which the kernel provides as it sees fit. */
+  TRANSPARENT,
+  /** Use the explicitly reserved huge page pool, falling back to TRANSPARENT if too few huge pages are reserved. */
+  EXPLICIT
+};
+
+/** Huge page policy of the buffer pools created from now on. */
+extern std::atomic<HugePagePolicy> buffer_pool_huge_pages;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
 static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
+static constexpr int PAGE_CHECKSUM_SIZE = 4;                                  // checksum at the end of a page on disk
+static constexpr int PAGE_USABLE_SIZE = PAGE_SIZE - PAGE_CHECKSUM_SIZE;       // bytes of a page open to page layouts
+static constexpr int PAGE_ALIGNMENT = 4096;                                   // alignment of page frames for direct I/O
+static constexpr int MAX_PAGE_SIZE = 64 * 1024;                               // largest page size of a database file
+static constexpr size_t CACHE_LINE_SIZE = 64;                                 // size of a CPU cache line in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
-static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int LOG_BUFFER_SIZE = 2 * MAX_PAGE_SIZE + PAGE_SIZE;         // size of a log buffer, fits any record
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int TABLESPACE_PAGE_BITS = 24;                               // low page id bits, the page in its file
+static constexpr int MAX_TABLESPACES = 128;                                   // most files a database spreads over
+static constexpr int DEFAULT_TABLESPACE_ID = 0;                               // the tablespace of the main db file
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
@@ -42,5 +73,25 @@ using txn_id_t = int32_t;      // transaction id type
 using lsn_t = int32_t;         // log sequence number type
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
+using tablespace_id_t = int32_t;  // tablespace id type
+
+/**
+ * A database file may use any power of two from PAGE_SIZE up to MAX_PAGE_SIZE as its page size: small pages for OLTP
+ * tables, large ones for scan-heavy analytical tables and wide index nodes. PAGE_SIZE is the default.
+ * @return true if page_size is a valid page size
+ */
+constexpr bool IsValidPageSize(size_t page_size) {
+  return page_size >= PAGE_SIZE && page_size <= MAX_PAGE_SIZE && (page_size & (page_size - 1)) == 0;
+}
+
+/**
+ * Page ids are split between the files of a database: the high bits of a page id name its tablespace, the low
+ * TABLESPACE_PAGE_BITS the page within the tablespace's file.
+ * @return the tablespace that page_id lies in
+ */
+constexpr tablespace_id_t TablespaceOf(page_id_t page_id) { return page_id >> TABLESPACE_PAGE_BITS; }
+
+/** @return the id of the first page of a tablespace */
+constexpr page_id_t FirstPageOf(tablespace_id_t tablespace_id) { return tablespace_id << TABLESPACE_PAGE_BITS; }
 
 }  // namespace bustub
@@ -47,6 +47,8 @@ enum class ExceptionType {
   OUT_OF_MEMORY = 9,
   /** Method not implemented. */
   NOT_IMPLEMENTED = 11,
+  /** Page I/O failed, or returned a page that fails its checksum. */
+  IO = 12,
 };
 
 class Exception : public std::runtime_error {
@@ -98,6 +100,8 @@ class Exception : public std::runtime_error {
         return "Out of Memory";
       case ExceptionType::NOT_IMPLEMENTED:
         return "Not implemented";
+      case ExceptionType::IO:
+        return "I/O";
       default:
         return "Unknown";
     }
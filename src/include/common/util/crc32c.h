@@ -0,0 +1,43 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.h
+//
+// Identification: src/include/common/util/crc32c.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * Crc32c computes CRC-32C (Castagnoli) checksums, the CRC the SSE4.2 crc32 instruction implements. When the CPU has
+ * the instruction, three independent streams are run at once to hide its latency and their CRCs are combined with
+ * precomputed tables; otherwise a byte-at-a-time table is used.
+ */
+class Crc32c {
+ public:
+  /** @return the CRC of length bytes of data */
+  static uint32_t Value(const char *data, size_t length) { return Extend(0, data, length); }
+
+  /**
+   * @param crc the CRC of some bytes
+   * @return the CRC of those bytes followed by length bytes of data
+   */
+  static uint32_t Extend(uint32_t crc, const char *data, size_t length);
+
+  /** Extend, but always computed with the table, regardless of what the CPU supports. */
+  static uint32_t ExtendPortable(uint32_t crc, const char *data, size_t length);
+
+  /** @return true if Extend uses the crc32 instruction */
+  static bool IsHardwareAccelerated();
+};
+
+}  // namespace bustub
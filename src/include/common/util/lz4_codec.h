@@ -0,0 +1,47 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec.h
+//
+// Identification: src/include/common/util/lz4_codec.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+namespace bustub {
+
+/**
+ * Lz4Codec compresses small buffers, such as pages, into the LZ4 block format: a run of sequences, each a number of
+ * literal bytes followed by a copy of earlier output. The compressor is the greedy single-probe one of LZ4's fast
+ * mode, which trades some ratio for speed; the decompressor checks every length and offset, so a damaged block is
+ * rejected instead of read or written out of bounds.
+ */
+class Lz4Codec {
+ public:
+  /** Largest input the compressor handles, match offsets are 16 bits wide. */
+  static constexpr size_t MAX_INPUT_SIZE = 65535;
+
+  /**
+   * Compress size bytes of src.
+   * @param[out] dst output buffer
+   * @param capacity size of dst
+   * @return the size of the compressed block, or 0 if it does not fit in capacity
+   */
+  static size_t Compress(const char *src, size_t size, char *dst, size_t capacity);
+
+  /**
+   * Decompress a block.
+   * @param[out] dst output buffer
+   * @param size the exact size the block decompresses to
+   * @return true if the block is well-formed and decompresses to exactly size bytes
+   */
+  static bool Decompress(const char *src, size_t src_size, char *dst, size_t size);
+};
+
+}  // namespace bustub
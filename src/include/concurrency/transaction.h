@@ -48,6 +48,14 @@ enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
  */
 enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
 
+/**
+ * When a commit returns, relative to its COMMIT record reaching the disk.
+ * SYNCHRONOUS: the record is durable, the log is written out right away.
+ * GROUP_COMMIT: the record is durable, written out together with everything else logged within log_timeout.
+ * ASYNC: right away; a crash loses the commits of at most the last log_timeout.
+ */
+enum class DurabilityMode { SYNCHRONOUS, GROUP_COMMIT, ASYNC };
+
 /**
  * Type of write operation.
  */
@@ -148,9 +156,11 @@ class TransactionAbortException : public std::exception {
  */
 class Transaction {
  public:
-  explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ)
+  explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ,
+                       DurabilityMode durability_mode = DurabilityMode::SYNCHRONOUS)
       : state_(TransactionState::GROWING),
         isolation_level_(isolation_level),
+        durability_mode_(durability_mode),
         thread_id_(std::this_thread::get_id()),
         txn_id_(txn_id),
         prev_lsn_(INVALID_LSN),
@@ -176,6 +186,15 @@ class Transaction {
   /** @return the isolation level of this transaction */
   inline IsolationLevel GetIsolationLevel() const { return isolation_level_; }
 
+  /** @return how durable this transaction is once it has committed */
+  inline DurabilityMode GetDurabilityMode() const { return durability_mode_; }
+
+  /**
+   * Set how durable this transaction is once it has committed.
+   * @param durability_mode new durability mode
+   */
+  inline void SetDurabilityMode(DurabilityMode durability_mode) { durability_mode_ = durability_mode; }
+
   /** @return the list of table write records of this transaction */
   inline std::shared_ptr<std::deque<TableWriteRecord>> GetWriteSet() { return table_write_set_; }
 
@@ -251,6 +270,8 @@ class Transaction {
   TransactionState state_;
   /** The isolation level of the transaction. */
   IsolationLevel isolation_level_;
+  /** The durability mode of the transaction. */
+  DurabilityMode durability_mode_;
   /** The thread ID, used in single-threaded transactions. */
   std::thread::id thread_id_;
   /** The ID of this transaction. */
@@ -260,8 +281,8 @@ class Transaction {
   std::shared_ptr<std::deque<TableWriteRecord>> table_write_set_;
   /** The undo set of indexes. */
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
-  /** The LSN of the last record written by the transaction. */
-  lsn_t prev_lsn_;
+  /** The LSN of the last record written by the transaction, read by checkpoints while the transaction runs. */
+  std::atomic<lsn_t> prev_lsn_;
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
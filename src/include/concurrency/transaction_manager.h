@@ -13,9 +13,12 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>  // NOLINT
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
@@ -39,12 +42,15 @@ class TransactionManager {
    * Begins a new transaction.
    * @param txn an optional transaction object to be initialized, otherwise a new transaction is created.
    * @param isolation_level an optional isolation level of the transaction.
+   * @param durability_mode an optional durability mode of the transaction, used if a new transaction is created.
    * @return an initialized transaction
    */
-  Transaction *Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ);
+  Transaction *Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ,
+                     DurabilityMode durability_mode = DurabilityMode::SYNCHRONOUS);
 
   /**
-   * Commits a transaction.
+   * Commits a transaction. With logging enabled, this writes a COMMIT record and waits for it as the transaction's
+   * durability mode asks. Locks are released before waiting: whoever sees the changes commits with a later record.
    * @param txn the transaction to commit
    */
   void Commit(Transaction *txn);
@@ -77,6 +83,14 @@ class TransactionManager {
     return res;
   }
 
+  /**
+   * List the active-transaction table, for a fuzzy checkpoint: the transactions that have begun and not yet written
+   * their COMMIT or ABORT record. Transactions keep running meanwhile. Only kept with a log manager.
+   * @param[out] min_begin_lsn the oldest LSN any of them may have written a record at, INVALID_LSN if none is active
+   * @return (transaction id, LSN of its last record) of every active transaction
+   */
+  std::vector<std::pair<txn_id_t, lsn_t>> GetActiveTransactionTable(lsn_t *min_begin_lsn);
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
@@ -101,12 +115,30 @@ class TransactionManager {
     }
   }
 
+  /** A transaction of the active-transaction table. */
+  struct ActiveTransaction {
+    Transaction *txn_;
+    /** The next LSN of the log when the transaction began, all of its records come at or after it. */
+    lsn_t begin_lsn_;
+  };
+
+  /**
+   * Remove a transaction from the active-transaction table, once its last record is written.
+   * @param txn the transaction that committed or aborted
+   */
+  void EndTransaction(Transaction *txn);
+
   std::atomic<txn_id_t> next_txn_id_{0};
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
 
   /** The global transaction latch is used for checkpointing. */
   ReaderWriterLatch global_txn_latch_;
+
+  /** The active-transaction table, see GetActiveTransactionTable. */
+  std::unordered_map<txn_id_t, ActiveTransaction> active_txns_;
+  /** This latch protects active_txns_. */
+  std::mutex active_txns_latch_;
 };
 
 }  // namespace bustub
@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/extent_allocator.h"
 #include "concurrency/transaction.h"
 #include "container/hash/hash_function.h"
 #include "storage/page/hash_table_bucket_page.h"
@@ -25,25 +26,30 @@
 
 namespace bustub {
 
-#define HASH_TABLE_TYPE ExtendibleHashTable<KeyType, ValueType, KeyComparator>
+#define HASH_TABLE_TYPE ExtendibleHashTable<KeyType, ValueType, KeyComparator, PageSize>
 
 /**
  * Implementation of extendible hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table grows/shrinks dynamically as buckets become full/empty.
+ *
+ * PageSize is the page size of the buffer pool's file. It fixes the layout of the bucket pages at compile time, so a
+ * table in a file with larger pages gets larger buckets without any offset computed at run time.
  */
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize = PAGE_SIZE>
 class ExtendibleHashTable {
  public:
   /**
    * Creates a new ExtendibleHashTable.
    *
-   * @param buffer_pool_manager buffer pool manager to be used
+   * @param buffer_pool_manager buffer pool manager to be used, its page size must be PageSize
    * @param comparator comparator for keys
    * @param hash_fn the hash function
+   * @param tablespace_id the tablespace whose file the table's pages are placed in
    */
   explicit ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn);
+                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                               tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID);
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -123,19 +129,12 @@ class ExtendibleHashTable {
   inline uint32_t KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page);
 
   /**
-   * Fetches the directory page from the buffer pool manager.
+   * Fetches the directory page from the buffer pool manager. The directory is protected by table_latch_, so the guard
+   * only holds the pin.
    *
-   * @return a pointer to the directory page
+   * @return a guard holding the directory page
    */
-  HashTableDirectoryPage *FetchDirectoryPage();
-
-  /**
-   * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
-   *
-   * @param bucket_page_id the page_id to fetch
-   * @return a pointer to a bucket page
-   */
-  std::pair<Page *, HASH_TABLE_BUCKET_TYPE *> FetchBucketPage(page_id_t bucket_page_id);
+  BasicPageGuard FetchDirectoryPage();
 
   /**
    * Performs insertion with an optional bucket splitting.
@@ -165,6 +164,8 @@ class ExtendibleHashTable {
   // member variables
   page_id_t directory_page_id_;
   BufferPoolManager *buffer_pool_manager_;
+  /** Creates the directory and bucket pages, from extents so that the buckets are laid out together in the file. */
+  ExtentAllocator extent_allocator_;
   KeyComparator comparator_;
 
   // Readers includes inserts and removes, writers are splits and merges
@@ -19,7 +19,12 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager takes fuzzy checkpoints: transactions keep running and no page is written out for a checkpoint.
+ * A checkpoint reads the active-transaction table and the buffer pool's dirty-page table, logs a CHECKPOINT record,
+ * and then points the master record at the first record recovery needs. That is the smallest recLSN of a dirty page, or
+ * the first record of an active transaction if one is older (undo needs all of its records), or else the checkpoint
+ * itself. Eviction and the page cleaner write the dirty pages out as usual, which moves that point forward from one
+ * checkpoint to the next.
  */
 class CheckpointManager {
  public:
@@ -31,13 +36,26 @@ class CheckpointManager {
 
   ~CheckpointManager() = default;
 
+  /**
+   * Take the two tables and log the CHECKPOINT record, without waiting for anything. Does nothing unless logging is
+   * enabled. One checkpoint at a time.
+   */
   void BeginCheckpoint();
+
+  /** Wait for the CHECKPOINT record to be durable, then write the master record. */
   void EndCheckpoint();
 
+  /** @return the LSN recovery starts at after the last checkpoint, INVALID_LSN before the first one */
+  lsn_t GetRedoLSN() const { return redo_lsn_; }
+
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+
+  /** The LSN of the CHECKPOINT record of the checkpoint in progress, INVALID_LSN if none is. */
+  lsn_t checkpoint_lsn_{INVALID_LSN};
+  lsn_t redo_lsn_{INVALID_LSN};
 };
 
 }  // namespace bustub
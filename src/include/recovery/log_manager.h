@@ -13,9 +13,12 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
-#include <mutex>               // NOLINT
+#include <map>
+#include <mutex>  // NOLINT
+#include <thread>              // NOLINT
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -25,16 +28,29 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * Appending takes no latch. A record's LSN and its bytes in the log buffer are reserved together with a single
+ * fetch-add on one word that holds both, so LSNs grow in the order records lie in the log, and every appender then
+ * copies its record in while others copy theirs. A reservation that does not fit in the buffer any more is dropped (its
+ * LSN is never used) and retried once the flush thread has swapped in an empty buffer.
+ *
+ * The flush thread seals the log buffer, waits for the copies into it to finish, swaps it with the flush buffer and
+ * writes the flush buffer out with one DiskManager::WriteLog, while appenders fill the other buffer. Every transaction
+ * whose records were sealed in commits with that one write (group commit). The thread flushes when the buffer fills up,
+ * when somebody waits for the log in Flush, and at least every log_timeout. A write that fails is retried after a
+ * timeout, and the persistent LSN only moves past records that were written.
  */
 class LogManager {
  public:
-  explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
+  explicit LogManager(DiskManager *disk_manager) : persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
     flush_buffer_ = new char[LOG_BUFFER_SIZE];
+    log_size_ = disk_manager_->GetLogSize();
+    log_offsets_[0] = log_size_;
   }
 
   ~LogManager() {
+    StopFlushThread();
     delete[] log_buffer_;
     delete[] flush_buffer_;
     log_buffer_ = nullptr;
@@ -44,31 +60,130 @@ class LogManager {
   void RunFlushThread();
   void StopFlushThread();
 
+  /**
+   * Append a record to the log buffer, and set its LSN. Only call this while the flush thread runs, which empties the
+   * buffer.
+   * @param log_record the record, at most LOG_BUFFER_SIZE bytes
+   * @return the LSN assigned to the record
+   */
   lsn_t AppendLogRecord(LogRecord *log_record);
 
-  inline lsn_t GetNextLSN() { return next_lsn_; }
+  /**
+   * Wait until the log is durable up to and including lsn, asking the flush thread to write it out now. An LSN that was
+   * not handed out yet waits for every record appended so far. Returns right away if the flush thread is not running.
+   * @param lsn the LSN of the record that has to be durable, such as that of a COMMIT record or of a page's last change
+   */
+  void Flush(lsn_t lsn);
+
+  /**
+   * Wait until the log is durable up to and including lsn, without hurrying the flush thread: the log is written out
+   * when the buffer fills up, when somebody calls Flush, or after at most log_timeout, together with whatever has been
+   * appended meanwhile. Returns right away if the flush thread is not running.
+   * @param lsn the LSN of the record that has to be durable
+   */
+  void WaitForFlush(lsn_t lsn);
+
+  inline lsn_t GetNextLSN() { return ReservedLsn(reservation_); }
+
+  /**
+   * Continue with the LSNs after those already in the log, see LogRecovery::GetNextLSN. Only call this before the
+   * flush thread runs.
+   */
+  inline void SetNextLSN(lsn_t lsn) {
+    reservation_ = static_cast<uint64_t>(lsn) << LSN_SHIFT;
+    persistent_lsn_ = lsn - 1;
+    std::scoped_lock lock{latch_};
+    // recovery may have cut off the end of the log, or appended to it
+    log_size_ = disk_manager_->GetLogSize();
+    log_offsets_.clear();
+    log_offsets_[lsn] = log_size_;
+  }
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
   inline char *GetLogBuffer() { return log_buffer_; }
 
- private:
-  // TODO(students): you may add your own member variables
+  /**
+   * Find where to start reading the log to see every record with an LSN at or above lsn. The answer is exact to a log
+   * buffer, the records before lsn in the same write are read as well. Offsets of LSNs below the one asked for are
+   * forgotten: a checkpoint never needs an older LSN than the one the checkpoint before it needed.
+   * @param lsn an LSN that was handed out, or the next LSN
+   * @return offset in the log file of a record boundary at or before the record with that LSN
+   */
+  off_t GetLogOffset(lsn_t lsn);
+
+  /**
+   * Make recovery start reading the log at the record with redo_lsn, see DiskManager::WriteMasterRecord.
+   * @param redo_lsn the LSN of the first record recovery needs
+   */
+  void WriteMasterRecord(lsn_t redo_lsn) { disk_manager_->WriteMasterRecord(GetLogOffset(redo_lsn)); }
+
+  /**
+   * Write a record at data, in the format documented with LogRecord.
+   * @param log_record the record, with its LSN set
+   * @param data where to write it, at least the record's size in bytes
+   */
+  static void SerializeLogRecord(const LogRecord &log_record, char *data);
 
-  /** The atomic counter which records the next log sequence number. */
-  std::atomic<lsn_t> next_lsn_;
+ private:
+  /** A reservation holds the next LSN in its upper half and the next free byte of the log buffer in its lower half. */
+  static constexpr int LSN_SHIFT = 32;
+  static constexpr uint64_t OFFSET_MASK = (UINT64_C(1) << LSN_SHIFT) - 1;
+  /** The offset of a sealed buffer; every reservation after the seal lies beyond the end of the buffer. */
+  static constexpr uint64_t SEALED_OFFSET = LOG_BUFFER_SIZE + 1;
+  /** seal_ until the current buffer is sealed. */
+  static constexpr uint64_t NOT_SEALED = UINT64_MAX;
+
+  static lsn_t ReservedLsn(uint64_t reservation) { return static_cast<lsn_t>(reservation >> LSN_SHIFT); }
+  static uint64_t ReservedOffset(uint64_t reservation) { return reservation & OFFSET_MASK; }
+
+  /** Body of the flush thread. */
+  void FlushLoop();
+
+  /** Seal the log buffer, swap it with the flush buffer and write that out, if it holds any record. */
+  void FlushBuffer();
+
+  /** Wait for the persistent LSN to reach lsn, waking the flush thread up first if force is set. */
+  void WaitForLsn(lsn_t lsn, bool force);
+
+  /** Wake the flush thread up early; latch_ held. */
+  void RequestFlush();
+
+  /** The next LSN and offset in the log buffer, see LSN_SHIFT. */
+  std::atomic<uint64_t> reservation_{0};
+  /** The reservation that sealed the log buffer: its records lie before its offset and have LSNs below its LSN. */
+  std::atomic<uint64_t> seal_{NOT_SEALED};
+  /** Bytes of the log buffer that appenders have finished copying their records into. */
+  std::atomic<uint64_t> copied_{0};
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
   char *log_buffer_;
   char *flush_buffer_;
+  /** Size of the log file, only changed by the flush thread. */
+  off_t log_size_;
+  /** Set once a write of the log failed for good, nothing is written after it; only used by the flush thread. */
+  bool write_failed_{false};
 
+  /** This latch protects the fields below, and is held by whoever waits on or signals the condition variables. */
   std::mutex latch_;
-
-  std::thread *flush_thread_ __attribute__((__unused__));
-
+  std::thread flush_thread_;
+  bool flush_running_{false};
+  /** Set when somebody waits for the log or for an empty buffer, so the flush thread does not sleep out its timeout. */
+  bool flush_requested_{false};
+  /**
+   * For every log buffer written since the last checkpoint, the LSN its records start at mapped to where it starts in
+   * the log file. Every record with an LSN at or above a key lies at or after its offset.
+   */
+  std::map<lsn_t, off_t> log_offsets_;
+
+  /** Wakes up the flush thread. */
   std::condition_variable cv_;
+  /** Signalled whenever an empty log buffer has been swapped in. */
+  std::condition_variable append_cv_;
+  /** Signalled whenever the persistent LSN moves forward. */
+  std::condition_variable flushed_cv_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 
@@ -32,6 +33,12 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** A fuzzy checkpoint; where recovery starts is kept in the master record. */
+  CHECKPOINT,
+  /**
+   * A compensation log record (CLR): the change recovery made to undo a change of a transaction that did not finish.
+   */
+  CLR,
 };
 
 /**
@@ -49,14 +56,25 @@ enum class LogRecordType {
  *----------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
  *---------------------------------------------------------------
- * For update type log record
- *-----------------------------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
- *-----------------------------------------------------------------------------------
+ * For update type log record, with only the bytes between the prefix and the suffix that the old and the new tuple
+ * share (a delta: an update of one column of a wide row logs little more than that column)
+ *---------------------------------------------------------------------------------------------------------
+ * | HEADER | tuple_rid | prefix_size | suffix_size | old_size | old_changed_data | new_size | new_changed_data |
+ *---------------------------------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *-------------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *-------------------------------------
+ * For checkpoint type log record, only the HEADER: redo starts where the master record points, and the analysis
+ * rebuilds the active-transaction table from the records after that
+ * For compensation type log record, with the LSN of the next record of the transaction to undo and the change that
+ * undid a record, laid out as a record of the type of that change is after its HEADER
+ *------------------------------------------------------------
+ * | HEADER | undo_next_lsn | change_type | fields of change |
+ *------------------------------------------------------------
+ *
+ * The records built for appending do not copy their tuples, they refer to the bytes of the tuples they are built from,
+ * which have to stay put until the record is appended. Records read back from the log own their tuples.
  */
 class LogRecord {
   friend class LogManager;
@@ -65,7 +83,7 @@ class LogRecord {
  public:
   LogRecord() = default;
 
-  // constructor for Transaction type(BEGIN/COMMIT/ABORT)
+  // constructor for Transaction type(BEGIN/COMMIT/ABORT), and for CHECKPOINT type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type)
       : size_(HEADER_SIZE), txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type) {}
 
@@ -74,12 +92,12 @@ class LogRecord {
       : txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type) {
     if (log_record_type == LogRecordType::INSERT) {
       insert_rid_ = rid;
-      insert_tuple_ = tuple;
+      insert_tuple_ = View(tuple.data_, tuple.size_);
     } else {
       assert(log_record_type == LogRecordType::APPLYDELETE || log_record_type == LogRecordType::MARKDELETE ||
              log_record_type == LogRecordType::ROLLBACKDELETE);
       delete_rid_ = rid;
-      delete_tuple_ = tuple;
+      delete_tuple_ = View(tuple.data_, tuple.size_);
     }
     // calculate log record size
     size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
@@ -88,14 +106,22 @@ class LogRecord {
   // constructor for UPDATE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const RID &update_rid,
             const Tuple &old_tuple, const Tuple &new_tuple)
-      : txn_id_(txn_id),
-        prev_lsn_(prev_lsn),
-        log_record_type_(log_record_type),
-        update_rid_(update_rid),
-        old_tuple_(old_tuple),
-        new_tuple_(new_tuple) {
+      : txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type), update_rid_(update_rid) {
+    // the bytes the two tuples share at the front and at the back, which need not be logged
+    uint32_t max_shared = std::min(old_tuple.size_, new_tuple.size_);
+    while (update_prefix_ < max_shared && old_tuple.data_[update_prefix_] == new_tuple.data_[update_prefix_]) {
+      update_prefix_++;
+    }
+    max_shared -= update_prefix_;
+    while (update_suffix_ < max_shared && old_tuple.data_[old_tuple.size_ - update_suffix_ - 1] ==
+                                              new_tuple.data_[new_tuple.size_ - update_suffix_ - 1]) {
+      update_suffix_++;
+    }
+    old_tuple_ = View(old_tuple.data_ + update_prefix_, old_tuple.size_ - update_prefix_ - update_suffix_);
+    new_tuple_ = View(new_tuple.data_ + update_prefix_, new_tuple.size_ - update_prefix_ - update_suffix_);
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() + new_tuple.GetLength() + 2 * sizeof(int32_t);
+    size_ = HEADER_SIZE + sizeof(RID) + 2 * sizeof(uint32_t) + old_tuple_.GetLength() + new_tuple_.GetLength() +
+            2 * sizeof(int32_t);
   }
 
   // constructor for NEWPAGE type
@@ -110,6 +136,9 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for CLR type, with the change that undoes an INSERT/DELETE/UPDATE record (it refers to its tuples)
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const LogRecord &undone_record);
+
   ~LogRecord() = default;
 
   inline Tuple &GetDeleteTuple() { return delete_tuple_; }
@@ -120,10 +149,20 @@ class LogRecord {
 
   inline RID &GetInsertRID() { return insert_rid_; }
 
+  /** @return the bytes of the old tuple that an UPDATE changed, see ApplyUpdate */
   inline Tuple &GetOriginalTuple() { return old_tuple_; }
 
+  /** @return the bytes of the new tuple that an UPDATE changed, see ApplyUpdate */
   inline Tuple &GetUpdateTuple() { return new_tuple_; }
 
+  /**
+   * Rebuild a whole tuple from an UPDATE record and the tuple it was applied to or produced.
+   * @param tuple the old tuple to redo the update on, or the new tuple to undo it on
+   * @param redo true to build the new tuple, false to build the old one
+   * @return the tuple after the update if redo is set, the one before it otherwise
+   */
+  Tuple ApplyUpdate(const Tuple &tuple, bool redo) const;
+
   inline RID &GetUpdateRID() { return update_rid_; }
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
@@ -138,6 +177,14 @@ class LogRecord {
 
   inline LogRecordType &GetLogRecordType() { return log_record_type_; }
 
+  /** @return the type of the change the record makes, that of the change it holds for a CLR */
+  inline LogRecordType GetChangeType() const {
+    return log_record_type_ == LogRecordType::CLR ? change_type_ : log_record_type_;
+  }
+
+  /** @return for a CLR, the LSN of the record of its transaction that is undone next */
+  inline lsn_t GetUndoNextLSN() { return undo_next_lsn_; }
+
   // For debug purpose
   inline std::string ToString() const {
     std::ostringstream os;
@@ -152,6 +199,14 @@ class LogRecord {
   }
 
  private:
+  /** @return a tuple that refers to size bytes at data, without copying them */
+  static Tuple View(char *data, uint32_t size) {
+    Tuple tuple;
+    tuple.data_ = data;
+    tuple.size_ = size;
+    return tuple;
+  }
+
   // the length of log record(for serialization, in bytes)
   int32_t size_{0};
   // must have fields
@@ -168,14 +223,21 @@ class LogRecord {
   RID insert_rid_;
   Tuple insert_tuple_;
 
-  // case3: for update operation
+  // case3: for update operation, the tuples only hold the bytes between the shared prefix and suffix
   RID update_rid_;
+  uint32_t update_prefix_{0};
+  uint32_t update_suffix_{0};
   Tuple old_tuple_;
   Tuple new_tuple_;
 
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for compensation, the change itself is kept in the fields of its type
+  lsn_t undo_next_lsn_{INVALID_LSN};
+  LogRecordType change_type_{LogRecordType::INVALID};
+
   static const int HEADER_SIZE = 20;
 };  // namespace bustub
 
@@ -13,8 +13,13 @@
 #pragma once
 
 #include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <exception>
 #include <mutex>  // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
@@ -24,11 +29,31 @@ namespace bustub {
 
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Redo reads the log once, sequentially, building the table of active transactions as it goes (analysis), and hands
+ * every record that changes a page to the worker thread that owns the page. It starts where the master record of the
+ * last checkpoint points, see CheckpointManager, or at the beginning of the log if there was none. Pages are split
+ * between the workers by page id, so each worker replays the records of its pages in LSN order while the workers run
+ * in parallel, and while the log is still being read. Undo rolls the transactions that neither committed nor aborted
+ * back the same way, every worker undoing the changes to its pages from the newest to the oldest. The analysis also
+ * marks every page the log creates allocated, since the free space map may not have reached the disk before the crash.
+ *
+ * Redo cuts off a record at the end of the log that was only partly written. Undo logs a compensation record (CLR) for
+ * every change it undoes and an ABORT record for every loser, and makes them durable before it changes a page, so that
+ * a crash during or after recovery never undoes a change twice. The log manager continues after them, see GetNextLSN.
  */
 class LogRecovery {
  public:
-  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
+  /**
+   * @param disk_manager the disk manager whose log is replayed
+   * @param buffer_pool_manager the buffer pool the table pages are recovered in
+   * @param num_threads the number of worker threads that redo and undo records
+   */
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, size_t num_threads = 1)
+      : disk_manager_(disk_manager),
+        buffer_pool_manager_(buffer_pool_manager),
+        offset_(0),
+        num_threads_(std::max<size_t>(num_threads, 1)) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
   }
 
@@ -39,19 +64,87 @@ class LogRecovery {
 
   void Redo();
   void Undo();
-  bool DeserializeLogRecord(const char *data, LogRecord *log_record);
+
+  /**
+   * Deserialize a log record written in the format documented with LogRecord.
+   * @param data the serialized record
+   * @param size the bytes available at data
+   * @param[out] log_record the record
+   * @return false if the bytes do not hold a whole record, such as at the end of the log
+   */
+  bool DeserializeLogRecord(const char *data, int size, LogRecord *log_record);
+
+  /**
+   * @return the LSN after the last one in the log, including the records Undo appended, where LogManager::SetNextLSN
+   * has to continue after recovery
+   */
+  lsn_t GetNextLSN() const { return next_lsn_; }
 
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** The records of the pages of one worker, waiting to be redone or undone. */
+  struct Partition {
+    std::deque<std::vector<LogRecord>> batches_;
+    /** Set once no more batches come. */
+    bool done_{false};
+    /** This latch protects batches_ and done_. */
+    std::mutex latch_;
+    /** Signalled whenever a batch is queued or the partition is done. */
+    std::condition_variable cv_;
+  };
+
+  /** Redo or undo a record on the pages of one partition. */
+  using ApplyFunc = void (LogRecovery::*)(size_t partition, LogRecord *log_record);
+
+  /** @return the page a record changes, INVALID_PAGE_ID for BEGIN/COMMIT/ABORT */
+  static page_id_t PageOf(const LogRecord &log_record);
+
+  size_t PartitionOf(page_id_t page_id) const { return static_cast<size_t>(page_id) % num_threads_; }
+
+  /** Add a record to the batches of the partitions whose pages it changes. */
+  void AddToBatches(const LogRecord &log_record, std::vector<std::vector<LogRecord>> *batches) const;
+
+  /** Start one worker per partition, applying each record it is handed with apply. */
+  void StartWorkers(ApplyFunc apply);
+
+  /** Queue every non-empty batch with its partition's worker, and empty the batches. */
+  void Dispatch(std::vector<std::vector<LogRecord>> *batches);
+
+  /** Wait for the workers to apply everything queued and stop them, rethrowing the first error one of them hit. */
+  void StopWorkers();
+
+  /** Body of the worker of one partition. */
+  void RunWorker(size_t partition, ApplyFunc apply);
+
+  /** Redo a record on its page, or the change a CLR holds, unless the page has it already. */
+  void RedoRecord(size_t partition, LogRecord *log_record);
+
+  /** Read the record with an LSN that Redo came across back from the log. */
+  void ReadLogRecord(lsn_t lsn, LogRecord *log_record);
+
+  /** @return the bytes of a table page open to its layout, as TableHeap lays them out */
+  uint32_t UsablePageSize() const {
+    return static_cast<uint32_t>(buffer_pool_manager_->GetPageSize() - PAGE_CHECKSUM_SIZE);
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
   /** Mapping the log sequence number to log file offset for undos. */
-  std::unordered_map<lsn_t, int> lsn_mapping_;
+  std::unordered_map<lsn_t, off_t> lsn_mapping_;
+  lsn_t next_lsn_{0};
 
-  int offset_ __attribute__((__unused__));
+  /** Offset in the log file of the first byte in log_buffer_. */
+  off_t offset_;
   char *log_buffer_;
+
+  size_t num_threads_;
+  std::vector<Partition> partitions_;
+  std::vector<std::thread> workers_;
+  /** The first error a worker hit, it gives up on its partition then. */
+  std::exception_ptr error_;
+  std::mutex error_latch_;
 };
 
 }  // namespace bustub
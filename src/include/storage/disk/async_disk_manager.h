@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.h
+//
+// Identification: src/include/storage/disk/async_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <exception>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * AsyncDiskManager is a DiskManager backend that keeps many page I/Os in flight at once. Page reads and writes are
+ * queued to a pool of I/O threads, each of which issues the base class's positional reads/writes, so requests for
+ * different pages never wait on one another. The log file is still handled synchronously by the base DiskManager.
+ */
+class AsyncDiskManager : public DiskManager {
+ public:
+  /** Number of I/O threads used when none is specified. */
+  static constexpr size_t DEFAULT_NUM_WORKERS = 8;
+
+  /**
+   * Creates a new asynchronous disk manager that writes to the specified database file.
+   * @param db_file the file name of the database file to write to
+   * @param num_workers the number of I/O threads, i.e. how many page I/Os can be in flight at once
+   * @param direct_io open the database file with O_DIRECT, see DiskManager
+   * @param compress_pages keep data pages compressed, see DiskManager
+   * @param page_size the size of the pages of the database file, see DiskManager
+   */
+  explicit AsyncDiskManager(const std::string &db_file, size_t num_workers = DEFAULT_NUM_WORKERS,
+                            bool direct_io = false, bool compress_pages = false, size_t page_size = PAGE_SIZE);
+
+  /** Waits for every queued request and stops the I/O threads. */
+  ~AsyncDiskManager() override;
+
+  /**
+   * Waits for every queued request, stops the I/O threads and closes all the file resources.
+   */
+  void ShutDown() override;
+
+  std::future<void> ReadPageAsync(page_id_t page_id, char *page_data) override;
+
+  std::future<void> WritePageAsync(page_id_t page_id, const char *page_data) override;
+
+  std::future<void> SubmitBatch(std::vector<DiskRequest> requests, DiskCallback on_complete = nullptr) override;
+
+ private:
+  /** Completion state shared by every request of one submission. */
+  struct Batch {
+    Batch(size_t size, DiskCallback on_complete) : remaining_(size), on_complete_(std::move(on_complete)) {}
+    std::atomic<size_t> remaining_;
+    /** The failure of the first request of the batch that failed, protected by error_latch_. */
+    std::exception_ptr error_;
+    std::mutex error_latch_;
+    std::promise<void> done_;
+    DiskCallback on_complete_;
+  };
+
+  /** Queue the requests, the batch's future becomes ready once the last one completes. */
+  std::future<void> Submit(std::vector<DiskRequest> requests, DiskCallback on_complete = nullptr);
+
+  /** Body of every I/O thread: pop requests until the manager is stopped and the queue drained. */
+  void RunWorker();
+
+  /** Stop the I/O threads once the queue is drained, a no-op if they are already stopped. */
+  void StopWorkers();
+
+  /** Requests waiting for an I/O thread. */
+  std::deque<std::pair<DiskRequest, std::shared_ptr<Batch>>> queue_;
+  /** Set once the I/O threads should exit. */
+  bool stopped_{false};
+  /** This latch protects queue_ and stopped_. */
+  std::mutex queue_latch_;
+  /** Signalled whenever a request is queued or the manager is stopped. */
+  std::condition_variable queue_cv_;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace bustub
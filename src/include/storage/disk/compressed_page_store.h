@@ -0,0 +1,174 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_page_store.h
+//
+// Identification: src/include/storage/disk/compressed_page_store.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * CompressedPageStore keeps pages LZ4-compressed in a file of their own, each taking as many 512-byte sectors as its
+ * compressed form needs, so that a page that compresses well costs a fraction of PAGE_SIZE to store and to read. An
+ * in-memory indirection map says where each page's current record lies; a page that was never written has none.
+ *
+ * A page is never rewritten in place: its new record goes to free sectors, and the old one is only given up once the
+ * new one is written, so a torn write leaves the old version. Records carry their page id and a write sequence number,
+ * and every one is checksummed, so the map can be rebuilt by scanning the file: for each allocated page the newest
+ * valid record wins, and of two records that overlap, the newer. The map is saved when the store is closed and deleted
+ * as soon as it is loaded again, so after a crash the store is always rebuilt from the records themselves.
+ */
+class CompressedPageStore {
+ public:
+  /** The unit of space in the store. */
+  static constexpr size_t SECTOR_SIZE = 512;
+
+  /**
+   * Open or create a store.
+   * @param file_name the file the records are kept in; the map is saved next to it with a .map suffix
+   * @param is_allocated tells which pages are allocated, records of any other page are dropped when the map is rebuilt
+   */
+  CompressedPageStore(const std::string &file_name, const std::function<bool(page_id_t)> &is_allocated);
+
+  /** Closes the store, see Close. */
+  ~CompressedPageStore();
+
+  /** Save the map and close the file. A no-op if the store is already closed. */
+  void Close();
+
+  /**
+   * Compress a page and write it.
+   * @param page_id id of the page
+   * @param page_data PAGE_SIZE bytes of page data
+   * @throws Exception of type IO if the record cannot be written, the page keeps its old record then
+   */
+  void Write(page_id_t page_id, const char *page_data);
+
+  /**
+   * Read consecutive pages, with one read for every run of them whose records are adjacent in the file. A page that
+   * was never written reads as zeros.
+   * @param first_page_id id of the first page
+   * @param[out] page_data output buffers, one per page
+   * @param num_pages number of pages to read
+   * @param[out] corrupt if set, the ids of pages whose record is damaged are added to it and those pages read as zeros;
+   * otherwise a damaged record throws
+   * @throws Exception of type IO if a record is damaged and corrupt is null
+   */
+  void ReadPages(page_id_t first_page_id, char *const *page_data, size_t num_pages,
+                 std::vector<page_id_t> *corrupt = nullptr);
+
+  /** Forget a deallocated page, its space is reused. */
+  void Discard(page_id_t page_id);
+
+  /** @return the number of pages that have a record */
+  size_t GetNumPages();
+
+  /** @return the bytes taken by the records of all pages */
+  size_t GetStoredBytes();
+
+  /** @return the bytes read from the file so far */
+  uint64_t GetNumBytesRead() const { return bytes_read_; }
+
+  /** @return the bytes written to the file so far */
+  uint64_t GetNumBytesWritten() const { return bytes_written_; }
+
+ private:
+  /** Where a record lies, and its write sequence number; sectors_ is 0 for a page without one. */
+  struct Extent {
+    uint64_t sector_{0};
+    uint32_t sectors_{0};
+    uint64_t sequence_{0};
+  };
+
+  /** Precedes the (possibly compressed) page data of every record. */
+  struct RecordHeader {
+    /** CRC-32C of the rest of the header and of the payload. */
+    uint32_t checksum_;
+    page_id_t page_id_;
+    /** Order of the writes, the record with the highest one is the page's current version. */
+    uint64_t sequence_;
+    uint32_t payload_size_;
+    /** How the payload is encoded, see Codec. */
+    uint32_t codec_;
+  };
+
+  enum Codec : uint32_t { RAW = 1, LZ4 = 2 };
+
+  /** Most sectors a record takes, that of a page that did not compress and is stored as is. */
+  static constexpr size_t MAX_RECORD_SECTORS = (sizeof(RecordHeader) + PAGE_SIZE + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+  /** Most sectors read at once. */
+  static constexpr size_t MAX_READ_SECTORS = 64 * MAX_RECORD_SECTORS;
+
+  static uint32_t RecordChecksum(const RecordHeader &header, const char *payload);
+
+  /**
+   * Check a record and decode its page.
+   * @param record the record, size bytes of it are available
+   * @param page_id the page expected in it, INVALID_PAGE_ID for any
+   * @param[out] header the record's header
+   * @param[out] page_data if set, receives the decoded page
+   * @return true if the record is valid
+   */
+  static bool DecodeRecord(const char *record, size_t size, page_id_t page_id, RecordHeader *header, char *page_data);
+
+  /** Load the saved map, and delete it. @return false if there is no valid saved map */
+  bool LoadMap();
+
+  /** Rebuild the map from the records in the file. */
+  void ScanRecords(const std::function<bool(page_id_t)> &is_allocated);
+
+  /** Save the map next to the store. */
+  void SaveMap();
+
+  /**
+   * Turn every sector below the end of the store that no page uses into free space. Of two pages whose records
+   * overlap, the one with the older record loses it.
+   */
+  void RebuildFreeSpace(uint64_t file_sectors);
+
+  /** @return the first of sectors free sectors, taken from the free space or the end of the store; latch_ held */
+  uint64_t AllocateSectors(uint32_t sectors);
+
+  /** Return sectors to the free space; latch_ held. */
+  void FreeSectors(uint64_t sector, uint32_t sectors);
+
+  /** Read size bytes at offset, zero-filling whatever lies beyond the end of file. */
+  void ReadAt(uint64_t offset, char *data, size_t size);
+
+  std::string file_name_;
+  std::string map_file_name_;
+  int fd_{-1};
+
+  /** The indirection map, indexed by page id. */
+  std::vector<Extent> extents_;
+  /** Free sectors, by the length of the run they start: free_[n] holds the first sectors of free runs of n. */
+  std::vector<uint64_t> free_[MAX_RECORD_SECTORS + 1];
+  /** Sectors past the last one in use, where the store grows. */
+  uint64_t end_sector_{0};
+  uint64_t next_sequence_{1};
+  size_t num_pages_{0};
+  uint64_t stored_sectors_{0};
+  /** This latch protects the map and the free space, it is never held during I/O. */
+  std::mutex latch_;
+
+  std::atomic<uint64_t> bytes_read_{0};
+  std::atomic<uint64_t> bytes_written_{0};
+};
+
+}  // namespace bustub
@@ -12,53 +12,231 @@
 
 #pragma once
 
+#include <sys/types.h>
+
+#include <array>
 #include <atomic>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <future>  // NOLINT
-#include <mutex>   // NOLINT
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <vector>
 
 #include "common/config.h"
+#include "storage/disk/compressed_page_store.h"
 
 namespace bustub {
 
+/**
+ * A single page read or write, used to submit many page I/Os to the disk manager at once.
+ */
+struct DiskRequest {
+  /** True for a write of data_ to page_id_, false for a read of page_id_ into data_. */
+  bool is_write_;
+  /** The page being read or written. */
+  page_id_t page_id_;
+  /** A page of page data, GetPageSize() bytes, must stay valid until the request completes. */
+  char *data_;
+  /**
+   * Set by the disk manager for a read whose page failed its checksum or could not be read, data_ then holds whatever
+   * was on disk.
+   */
+  bool corrupt_{false};
+  /** Set by the disk manager for a request that failed, to the Exception describing the failure. */
+  std::exception_ptr error_{nullptr};
+};
+
+/** Invoked once for every request of a batch, right after that request's I/O has completed. */
+using DiskCallback = std::function<void(const DiskRequest &)>;
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * Every page of a database file, data or map page, has the file's page size, a power of two from PAGE_SIZE up to
+ * MAX_PAGE_SIZE chosen when the file is opened. The page size is not recorded in the file, so it must be opened with
+ * the size it was created with; pages read with the wrong size fail their checksums.
+ *
+ * Which pages are allocated is recorded in a free space map, a bitmap kept in the database file itself: every
+ * page size * 8 data pages are preceded by the map page that covers them. AllocatePage hands out the lowest free
+ * page, so deallocated pages are reused and the file only grows when every page below its end is in use. Map pages are
+ * written lazily, but always before any data page is written, so a page with contents on disk is never free on disk.
+ * A page whose creation only reached the log may still be free on disk after a crash; recovery marks it allocated
+ * again (see MarkAllocated).
+ *
+ * Every data page is written with a CRC-32C checksum of its contents and its page id in its last PAGE_CHECKSUM_SIZE
+ * bytes, and checked when it is read back, so a torn write or a page written to the wrong place is reported instead
+ * of handed to whatever interprets the page. A page that was allocated but never written reads as zeros and passes.
+ *
+ * With page compression on, data pages are not kept in the database file but LZ4-compressed in a CompressedPageStore
+ * next to it (the .zpg file), where a page takes only the sectors its compressed form needs. The database file then
+ * only holds the free space map. Pages are compressed when the buffer pool writes them back and decompressed when it
+ * reads them, so the rest of the system never sees the difference.
+ *
+ * A database may spread over several files, possibly on different devices, one per tablespace. The file the disk
+ * manager is created with is tablespace DEFAULT_TABLESPACE_ID, AddTablespace opens more, and the page id space is split
+ * between them (see TablespaceOf): each tablespace is a disk manager of its own, with its own free space map, that
+ * pages are routed to by the high bits of their ids. Each tablespace has a page size of its own, the main file's
+ * unless AddTablespace is given another, and shares the other settings of the main file; only the main file has a log.
+ * Neither the page sizes nor the list of tablespaces are recorded anywhere, so tablespaces must be added again in the
+ * same order and with the same page sizes every time the database is opened. A file that is opened with another page
+ * size, or as another tablespace, than it was written with is refused: its first written page fails its checksum. A
+ * buffer pool caches pages of the main file's size only, so the pages of a tablespace with another page size are read
+ * and written directly.
  */
 class DiskManager {
  public:
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param direct_io open the database file with O_DIRECT, bypassing the OS page cache; falls back to buffered I/O
+   * if the file system does not support it
+   * @param compress_pages keep data pages compressed in a store of their own; the store always uses buffered I/O, and
+   * only takes pages of PAGE_SIZE
+   * @param page_size the size of the pages of the database file, see IsValidPageSize
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, bool direct_io = false, bool compress_pages = false,
+                       size_t page_size = PAGE_SIZE);
+
+  virtual ~DiskManager();
 
-  ~DiskManager() = default;
+  /**
+   * Shut down the disk manager and close all the file resources, those of every tablespace included.
+   */
+  virtual void ShutDown();
 
   /**
-   * Shut down the disk manager and close all the file resources.
+   * Open or create another file of the database, whose pages get ids of a range of their own.
+   * @param file_name the file name of the tablespace's file, which must not be one the database already uses
+   * @param page_size the size of the tablespace's pages, see IsValidPageSize; 0 for the page size of the main file
+   * @return the id of the tablespace, to allocate pages in
+   * @throws Exception if the file is in use or cannot be opened, if it was written with another page size or as another
+   * tablespace, or if there are MAX_TABLESPACES tablespaces already
    */
-  void ShutDown();
+  tablespace_id_t AddTablespace(const std::string &file_name, size_t page_size = 0);
+
+  /** @return the number of tablespaces, the main file included */
+  tablespace_id_t GetNumTablespaces() const { return num_tablespaces_; }
 
   /**
-   * Write a page to the database file.
+   * Write a page to the database file, with its checksum in place of the last PAGE_CHECKSUM_SIZE bytes of page_data.
    * @param page_id id of the page
    * @param page_data raw page data
+   * @throws Exception of type IO if the write fails
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  virtual void WritePage(page_id_t page_id, const char *page_data);
 
   /**
-   * Read a page from the database file.
+   * Read a page from the database file and check it against its checksum, whose bytes are zeroed afterwards.
    * @param page_id id of the page
    * @param[out] page_data output buffer
+   * @throws Exception of type IO if the page fails its checksum or cannot be read
+   */
+  virtual void ReadPage(page_id_t page_id, char *page_data);
+
+  /**
+   * Read consecutive pages with as few vectored reads as possible, checking each like ReadPage does.
+   * @param first_page_id id of the first page
+   * @param[out] page_data output buffers, one per page
+   * @param num_pages number of pages to read
+   * @throws Exception of type IO if a page fails its checksum
+   */
+  void ReadPages(page_id_t first_page_id, char *const *page_data, size_t num_pages);
+
+  /**
+   * Check every allocated page of the database files against its checksum. Each file is read front to back in large
+   * sequential reads, bypassing the buffer pool. A page that is being written meanwhile may be reported as well.
+   * @return the ids of the pages that fail their checksum
+   */
+  std::vector<page_id_t> VerifyFile();
+
+  /** @return true if page_data, page_size bytes as read from disk for page page_id, matches its checksum */
+  static bool VerifyPage(page_id_t page_id, const char *page_data, size_t page_size = PAGE_SIZE);
+
+  /** @return the checksum of page_data for page page_id, computed over all but the last PAGE_CHECKSUM_SIZE bytes */
+  static uint32_t PageChecksum(page_id_t page_id, const char *page_data, size_t page_size = PAGE_SIZE);
+
+  /**
+   * Start reading a page from the database file. The default implementation completes synchronously.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer, must stay valid until the returned future is ready
+   * @return a future that becomes ready once page_data holds the page, and holds the Exception ReadPage would throw
+   */
+  virtual std::future<void> ReadPageAsync(page_id_t page_id, char *page_data);
+
+  /**
+   * Start writing a page to the database file. The default implementation completes synchronously.
+   * @param page_id id of the page
+   * @param page_data raw page data, must stay valid until the returned future is ready
+   * @return a future that becomes ready once the page is written, and holds the Exception WritePage would throw
+   */
+  virtual std::future<void> WritePageAsync(page_id_t page_id, const char *page_data);
+
+  /**
+   * Submit a batch of page reads and writes. Requests within a batch may complete in any order, so a batch should
+   * not contain two requests for the same page. A request that fails completes with error_ set, a read whose page
+   * fails its checksum or cannot be read with corrupt_ set as well.
+   * @param requests the page I/Os to perform
+   * @param on_complete if set, called for each request as soon as it completes, possibly on an I/O thread
+   * @return a future that becomes ready once every request in the batch has completed, holding the Exception of the
+   * first request that failed if any did
+   */
+  virtual std::future<void> SubmitBatch(std::vector<DiskRequest> requests, DiskCallback on_complete = nullptr);
+
+  /**
+   * Allocate the lowest free page whose id is congruent to instance_index modulo num_instances, so that each instance
+   * of a parallel buffer pool only gets pages it is responsible for.
+   * @param num_instances number of instances that page ids are striped over
+   * @param instance_index the stripe to allocate from
+   * @param tablespace_id the tablespace to allocate in
+   * @return the id of the allocated page
+   * @throws Exception of type OUT_OF_RANGE if the tablespace is full
+   */
+  virtual page_id_t AllocatePage(uint32_t num_instances = 1, uint32_t instance_index = 0,
+                                 tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID);
+
+  /**
+   * Allocate an extent, the lowest run of num_pages free pages that starts at a multiple of num_pages. Its pages are
+   * only reserved: nothing else is handed them, but the free space map on disk keeps them free until each is marked
+   * allocated with MarkAllocated, so the pages of an extent that are never used are free again once the file is
+   * reopened. Its pages are deallocated one by one like any others.
+   * @param num_pages number of pages in the extent, a power of two no larger than the reach of a map page
+   * @param tablespace_id the tablespace to allocate in
+   * @return id of the first page of the extent
+   * @throws Exception of type OUT_OF_RANGE if the tablespace is full
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  virtual page_id_t AllocateExtent(uint32_t num_pages, tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID);
+
+  /**
+   * Return a page to the free space map, so that it can be allocated again. Deallocating a free page is a no-op.
+   * @param page_id id of the page
+   */
+  virtual void DeallocatePage(page_id_t page_id);
+
+  /**
+   * Mark a page allocated, as recovery does for every page the log shows was created: the free space map on disk may
+   * be older than the log. A page reserved by AllocateExtent is allocated for good, other allocated pages are left
+   * as they are.
+   * @param page_id id of the page
+   */
+  void MarkAllocated(page_id_t page_id);
+
+  /** @return true if page_id is allocated */
+  bool IsAllocated(page_id_t page_id);
+
+  /** @return the number of allocated pages, over all tablespaces */
+  size_t GetNumAllocatedPages();
 
   /**
    * Flush the entire log buffer into disk.
    * @param log_data raw log data
    * @param size size of log entry
+   * @throws Exception of type IO if the log cannot be written or synced; none of the buffer is in the log then, so it
+   * can be written again
    */
   void WriteLog(char *log_data, int size);
 
@@ -69,7 +247,27 @@ class DiskManager {
    * @param offset offset of the log entry in the file
    * @return true if the read was successful, false otherwise
    */
-  bool ReadLog(char *log_data, int size, int offset);
+  bool ReadLog(char *log_data, int size, off_t offset);
+
+  /** @return the size of the log file in bytes */
+  off_t GetLogSize();
+
+  /**
+   * Cut the log file down to size bytes, durably. Recovery drops a record that was only partly written this way.
+   * @param size the bytes of the log to keep
+   * @throws Exception of type IO if the log cannot be truncated
+   */
+  void TruncateLog(off_t size);
+
+  /**
+   * Durably record where recovery starts reading the log, in the master record kept in <db file stem>.ckpt. A log
+   * that is created empty discards the master record of any log before it.
+   * @param redo_offset offset in the log file of the first record redo needs, at a record boundary
+   */
+  void WriteMasterRecord(off_t redo_offset);
+
+  /** @return the offset recorded by the last WriteMasterRecord, 0 (the whole log) if there is none */
+  off_t ReadMasterRecord();
 
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
@@ -89,20 +287,137 @@ class DiskManager {
   /** Checks if the non-blocking flush future was set. */
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
- private:
-  int GetFileSize(const std::string &file_name);
-  // stream to write log file
-  std::fstream log_io_;
+  /** @return the size of the pages of the database file */
+  inline size_t GetPageSize() const { return page_size_; }
+
+  /** @return the size of the pages of a tablespace */
+  size_t GetPageSize(tablespace_id_t tablespace_id) const {
+    return tablespace_id == DEFAULT_TABLESPACE_ID ? page_size_ : GetTablespace(tablespace_id)->page_size_;
+  }
+
+  /** @return true if page I/O bypasses the OS page cache */
+  inline bool IsDirectIo() const { return direct_io_; }
+
+  /** @return the store that holds the compressed data pages, nullptr unless pages are compressed */
+  inline CompressedPageStore *GetPageStore() { return page_store_.get(); }
+
+ protected:
+  /** Most pages that are read with a single vectored read. */
+  static constexpr size_t MAX_VECTORED_READ_PAGES = 64;
+
+  /** Most pages in one tablespace. */
+  static constexpr page_id_t MAX_TABLESPACE_PAGES = 1 << TABLESPACE_PAGE_BITS;
+
+  /**
+   * Opens a database file for the pages of one tablespace; only the file of the default tablespace has a log.
+   * @param first_page_id the id that page 0 of the file has in the database, checksums are computed over those ids
+   */
+  DiskManager(const std::string &db_file, bool direct_io, bool compress_pages, size_t page_size,
+              page_id_t first_page_id);
+
+  /** @return the disk manager of a tablespace other than the default one */
+  DiskManager *GetTablespace(tablespace_id_t tablespace_id) const;
+
+  /** One page of the free space map, a bit per data page that is set if the page is allocated. */
+  using SpaceMapPage = std::vector<uint64_t>;
+
+  /** @return the file offset of a data page, which is shifted by the map pages in front of it */
+  off_t PageOffset(page_id_t page_id) const;
+
+  /** @return the file offset of the map_index-th page of the free space map */
+  off_t MapPageOffset(size_t map_index) const;
+
+  /** Read the free space map back from the database file. */
+  void LoadSpaceMap();
+
+  /**
+   * Check that the file was written with pages of page_size_ and ids from first_page_id_, by reading the first
+   * allocated page that was written.
+   * @throws Exception of type INVALID if that page fails its checksum
+   */
+  void CheckPageSize();
+
+  /** Write out the map pages changed since the last flush. */
+  void FlushSpaceMap();
+
+  /** @return the map page covering page_id, appended to the map if needed; space_map_latch_ must be held */
+  SpaceMapPage *GetMapPage(page_id_t page_id);
+
+  /** @return true if page_id was reserved, which it no longer is; space_map_latch_ must be held */
+  bool Unreserve(page_id_t page_id);
+
+  /** Write a page at offset of the database file; throws an Exception of type IO if the write fails. */
+  void WriteBlock(off_t offset, const char *data);
+
+  /**
+   * Read size bytes at offset of the database file, zero-filling whatever lies beyond its end. Only reads of a single
+   * page may use memory that direct I/O cannot transfer into. Throws an Exception of type IO if the read fails.
+   */
+  void ReadBlock(off_t offset, char *data, size_t size);
+
+  /** Check a page that was just read against its checksum, then zero the checksum; throws if it does not match. */
+  void CheckPage(page_id_t page_id, char *page_data);
+
+  /**
+   * Serve the reads of consecutive pages for a batch. A page that fails its checksum or cannot be read flags its
+   * request instead of throwing.
+   * @param run the read requests, in page order without gaps
+   * @return true if every page passed its checksum
+   */
+  bool ReadRun(const std::vector<DiskRequest *> &run);
+
+  off_t GetFileSize(const std::string &file_name);
+  /** @return a scratch area of MAX_PAGE_SIZE bytes, aligned for direct I/O, one per thread */
+  static char *BounceBuffer();
+  // file descriptor of the log file, opened for appending
+  int log_fd_{-1};
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // file of the master record, next to the log
+  std::string master_name_;
+  // db file, accessed with positional I/O only so there is no shared cursor to protect
+  int db_fd_{-1};
+  bool direct_io_{false};
   std::string file_name_;
+  size_t page_size_;
+  /** Number of data pages covered by one page of the free space map. */
+  page_id_t pages_per_map_page_;
+  /** The database-wide id of the file's page 0, FirstPageOf its tablespace. */
+  page_id_t first_page_id_;
   int num_flushes_;
-  int num_writes_;
+  std::atomic<int> num_writes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
-  // With multiple buffer pool instances, need to protect file access
-  std::mutex db_io_latch_;
+  /** Holds the data pages if they are compressed. */
+  std::unique_ptr<CompressedPageStore> page_store_;
+
+  /** The free space map, the i-th page covering data pages [i * pages_per_map_page_, (i + 1) * pages_per_map_page_). */
+  std::vector<std::unique_ptr<SpaceMapPage>> space_map_;
+  /** Map pages changed since they were last written. */
+  std::vector<bool> space_map_dirty_;
+  size_t num_allocated_{0};
+  /** For the stripe count AllocatePage was last called with, the lowest page of each stripe that may be free. */
+  uint32_t free_hint_stripes_{0};
+  std::vector<page_id_t> free_hints_;
+  /** A multiple of 64 below which every page is allocated, where AllocateExtent starts looking. */
+  page_id_t extent_hint_{0};
+  /** The pages of extents that are reserved, first page to end; they are allocated in the map but written as free. */
+  std::map<page_id_t, page_id_t> reserved_pages_;
+  /** Bumped by every change to the free space map, and set to the version written out by every flush. */
+  std::atomic<uint64_t> space_map_version_{0};
+  std::atomic<uint64_t> space_map_flushed_version_{0};
+  // this protects the free space map and its book-keeping above
+  std::mutex space_map_latch_;
+  // this serializes the flushes of the free space map, so that an older copy never overwrites a newer one
+  std::mutex space_map_flush_latch_;
+
+  /**
+   * The disk managers of the other tablespaces, indexed by tablespace id; slot DEFAULT_TABLESPACE_ID stays empty. A
+   * slot is never changed once filled, so they are read without a latch.
+   */
+  std::array<std::unique_ptr<DiskManager>, MAX_TABLESPACES> tablespaces_;
+  std::atomic<tablespace_id_t> num_tablespaces_{1};
+  // this serializes AddTablespace
+  std::mutex tablespaces_latch_;
 };
 
 }  // namespace bustub
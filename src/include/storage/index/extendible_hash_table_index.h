@@ -29,7 +29,7 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTableIndex : public Index {
  public:
   ExtendibleHashTableIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
-                           const HashFunction<KeyType> &hash_fn);
+                           const HashFunction<KeyType> &hash_fn, tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID);
 
   ~ExtendibleHashTableIndex() override = default;
 
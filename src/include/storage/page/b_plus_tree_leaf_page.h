@@ -19,7 +19,10 @@ namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
 #define LEAF_PAGE_HEADER_SIZE 28
-#define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
+// the leaf page's capacity for pages of page_size; leaves use a flexible array, so a tree in a file with larger pages
+// only has to pass this as its leaf_max_size
+#define LEAF_PAGE_SIZE_OF(page_size) (((page_size)-PAGE_CHECKSUM_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
+#define LEAF_PAGE_SIZE LEAF_PAGE_SIZE_OF(PAGE_SIZE)
 
 /**
  * Store indexed key and record id(record id = page id combined with slot id,
@@ -34,9 +34,14 @@ namespace bustub {
  *  readable_ arrays. More information is in storage/page/hash_table_page_defs.h.
  *
  */
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize = PAGE_SIZE>
 class HashTableBucketPage {
+  static_assert(IsValidPageSize(PageSize));
+
  public:
+  /** Number of (key, value) pairs in a bucket, see BUCKET_ARRAY_SIZE_OF in storage/page/hash_table_page_defs.h. */
+  static constexpr size_t ARRAY_SIZE = BUCKET_ARRAY_SIZE_OF(PageSize);
+
   // Delete all constructor / destructor to ensure memory safety
   HashTableBucketPage() = delete;
 
@@ -139,9 +144,9 @@ class HashTableBucketPage {
 
  private:
   //  For more on BUCKET_ARRAY_SIZE see storage/page/hash_table_page_defs.h
-  char occupied_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+  char occupied_[(ARRAY_SIZE - 1) / 8 + 1];
   // 0 if tombstone/brand new (never occupied), 1 otherwise.
-  char readable_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+  char readable_[(ARRAY_SIZE - 1) / 8 + 1];
   MappingType array_[1];
 };
 
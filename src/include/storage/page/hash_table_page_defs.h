@@ -22,23 +22,27 @@
 /**
  * BLOCK_ARRAY_SIZE is the number of (key, value) pairs that can be stored in a linear probe hash block page. It is an
  * approximate calculation based on the size of MappingType (which is a std::pair of KeyType and ValueType). For each
- * key/value pair, we need two additional bits for occupied_ and readable_. 4 * PAGE_SIZE / (4 * sizeof (MappingType) +
- * 1) = PAGE_SIZE/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required to maintain the
- * occupied and readable flags for a key value pair.
+ * key/value pair, we need two additional bits for occupied_ and readable_. 4 * PAGE_USABLE_SIZE / (4 * sizeof
+ * (MappingType) + 1) = PAGE_USABLE_SIZE/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
+ * to maintain the occupied and readable flags for a key value pair. The page's checksum takes the rest of the page.
  */
-#define BLOCK_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+#define BLOCK_ARRAY_SIZE (4 * PAGE_USABLE_SIZE / (4 * sizeof(MappingType) + 1))
 
 /**
  * Extendible Hashing Definitions
  */
-#define HASH_TABLE_BUCKET_TYPE HashTableBucketPage<KeyType, ValueType, KeyComparator>
+#define HASH_TABLE_BUCKET_TYPE HashTableBucketPage<KeyType, ValueType, KeyComparator, PageSize>
 #define DIRECTORY_ARRAY_SIZE 512
 
 /**
  * BUCKET_ARRAY_SIZE is the number of (key, value) pairs that can be stored in an extendible hashing bucket page.
  * It is an approximate calculation based on the size of MappingType (which is a std::pair of KeyType and ValueType).
- * For each key/value pair, we need two additional bits for occupied_ and readable_. 4 * (PAGE_SIZE - 4) / (4 * sizeof
- * (MappingType) + 1) = (PAGE_SIZE - 4)/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
- * to maintain the occupied and readable flags for a key value pair.
+ * For each key/value pair, we need two additional bits for occupied_ and readable_. 4 * PAGE_USABLE_SIZE / (4 * sizeof
+ * (MappingType) + 1) = PAGE_USABLE_SIZE/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
+ * to maintain the occupied and readable flags for a key value pair. The page's checksum takes the rest of the page.
+ *
+ * BUCKET_ARRAY_SIZE is that of a bucket page of PAGE_SIZE, BUCKET_ARRAY_SIZE_OF(page_size) that of a bucket page of a
+ * hash table in a file with larger pages.
  */
-#define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+#define BUCKET_ARRAY_SIZE_OF(page_size) (4 * ((page_size)-PAGE_CHECKSUM_SIZE) / (4 * sizeof(MappingType) + 1))
+#define BUCKET_ARRAY_SIZE BUCKET_ARRAY_SIZE_OF(PAGE_SIZE)
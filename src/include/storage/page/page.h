@@ -12,10 +12,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <mutex>  // NOLINT
+#include <new>
 
 #include "common/config.h"
+#include "common/macros.h"
 #include "common/rwlatch.h"
 
 namespace bustub {
@@ -23,22 +27,42 @@ namespace bustub {
 /**
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
- * pin count, dirty flag, page id, etc.
+ * pin count, dirty flag, page id, etc. Pages are cache-line aligned, so the book-keeping of two frames of a buffer pool
+ * never shares a cache line. The last PAGE_CHECKSUM_SIZE bytes of the data belong to the disk manager, which keeps the
+ * page's checksum there on disk, so page layouts only use the first GetSize() - PAGE_CHECKSUM_SIZE bytes. A page has
+ * the page size of the database file it belongs to, PAGE_SIZE unless that file uses larger pages.
  */
-class Page {
+class alignas(CACHE_LINE_SIZE) Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManagerInstance;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() { ResetMemory(); }
-
-  /** Default destructor. */
-  ~Page() = default;
+  /** Constructor. Allocates and zeros out the page data, which the page owns. */
+  Page() : data_(new (std::align_val_t{PAGE_ALIGNMENT}) char[PAGE_SIZE]), owns_data_(true) { ResetMemory(); }
+
+  /**
+   * Constructor for a buffer pool frame. Zeros out the page data.
+   * @param data size bytes of PAGE_ALIGNMENT-aligned memory, owned by the caller
+   * @param size the page size
+   */
+  explicit Page(char *data, size_t size = PAGE_SIZE) : data_(data), size_(size) { ResetMemory(); }
+
+  /** Destructor. Frees the page data if the page owns it. */
+  ~Page() {
+    if (owns_data_) {
+      operator delete[](data_, std::align_val_t{PAGE_ALIGNMENT});
+    }
+  }
+
+  /** A page may own its data, so it is neither copied nor moved. */
+  DISALLOW_COPY_AND_MOVE(Page);
 
   /** @return the actual data contained within this page */
   inline char *GetData() { return data_; }
 
+  /** @return the size of the page data */
+  inline size_t GetSize() const { return size_; }
+
   /** @return the page id of this page */
   inline page_id_t GetPageId() { return page_id_; }
 
@@ -57,14 +81,27 @@ class Page {
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
 
+  /** Acquire the page read latch if no writer holds it or waits for it. @return true if the latch was acquired */
+  inline bool TryRLatch() { return rwlatch_.TryRLock(); }
+
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
   /** @return the page LSN. */
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
-  /** Sets the page LSN. */
-  inline void SetLSN(lsn_t lsn) { memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t)); }
+  /** Sets the page LSN. The first LSN set since the page was last written out also becomes its recLSN. */
+  inline void SetLSN(lsn_t lsn) {
+    memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t));
+    lsn_t rec_lsn = INVALID_LSN;
+    rec_lsn_.compare_exchange_strong(rec_lsn, lsn);
+  }
+
+  /**
+   * @return the recLSN: the LSN of the oldest logged change that may not be on disk yet, INVALID_LSN if there is none.
+   * Redo has to start at or before it for the page.
+   */
+  inline lsn_t GetRecLSN() const { return rec_lsn_; }
 
  protected:
   static_assert(sizeof(page_id_t) == 4);
@@ -76,16 +113,30 @@ class Page {
 
  private:
   /** Zeroes out the data that is held within the page. */
-  inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
-
-  /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
-  /** The ID of this page. */
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, size_); }
+
+  /** The actual data that is stored within a page, PAGE_ALIGNMENT-aligned so it can be used for direct I/O. */
+  char *data_;
+  size_t size_{PAGE_SIZE};
+  /** True if data_ was allocated by this page. */
+  bool owns_data_ = false;
+  /** The ID of this page, read by lock-free fetches while the buffer pool reassigns the frame. */
+  std::atomic<page_id_t> page_id_ = INVALID_PAGE_ID;
+  /** The pin count of this page. The buffer pool pins resident pages without holding its latch. */
+  std::atomic<int> pin_count_ = 0;
+  /** Orders the buffer pool's replacer updates for this frame with the pin count changes they follow. */
+  std::mutex pin_latch_;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_ = false;
+  /** True while the buffer pool is reading this frame in or writing its previous contents out. */
+  std::atomic<bool> io_in_progress_ = false;
+  /**
+   * True while the page cleaner or a flush is writing this frame out; the page stays usable but the frame cannot be
+   * reused.
+   */
+  bool cleaning_ = false;
+  /** See GetRecLSN; the buffer pool forgets it once the page is written out. */
+  std::atomic<lsn_t> rec_lsn_ = INVALID_LSN;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
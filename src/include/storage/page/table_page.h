@@ -26,9 +26,9 @@ namespace bustub {
 
 /**
  * Slotted page format:
- *  ---------------------------------------------------------
- *  | HEADER | ... FREE SPACE ... | ... INSERTED TUPLES ... |
- *  ---------------------------------------------------------
+ *  --------------------------------------------------------------------
+ *  | HEADER | ... FREE SPACE ... | ... INSERTED TUPLES ... | CHECKSUM |
+ *  --------------------------------------------------------------------
  *                                ^
  *                                free space pointer
  *
@@ -83,6 +83,14 @@ class TablePage : public Page {
    */
   bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
 
+  /**
+   * Insert a tuple into a given slot, without locking or logging. Recovery puts tuples back where the log has them.
+   * @param tuple tuple to insert
+   * @param rid the slot to insert into, an empty one or the one after the last
+   * @return true if the insert is successful (i.e. there is enough space)
+   */
+  bool InsertTupleAt(const Tuple &tuple, const RID &rid);
+
   /**
    * Mark a tuple as deleted. This does not actually delete the tuple.
    * @param rid rid of the tuple to mark as deleted
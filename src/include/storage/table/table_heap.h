@@ -12,7 +12,11 @@
 
 #pragma once
 
+#include <mutex>  // NOLINT
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/extent_allocator.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
 #include "storage/table/table_iterator.h"
@@ -31,7 +35,7 @@ class TableHeap {
   ~TableHeap() = default;
 
   /**
-   * Create a table heap without a transaction. (open table)
+   * Create a table heap without a transaction. (open table) The heap grows in the tablespace of its first page.
    * @param buffer_pool_manager the buffer pool manager
    * @param lock_manager the lock manager
    * @param log_manager the log manager
@@ -46,9 +50,10 @@ class TableHeap {
    * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @param txn the creating transaction
+   * @param tablespace_id the tablespace whose file the table's pages are placed in
    */
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-            Transaction *txn);
+            Transaction *txn, tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID);
 
   /**
    * Insert a tuple into the table. If the tuple is too large (>= page_size), return false.
@@ -109,10 +114,36 @@ class TableHeap {
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
  private:
+  /**
+   * Record that next_page_id follows page_id in the page chain, so that scans can read ahead of it.
+   * @param page_id a page of this table
+   * @param next_page_id the page after it, may be INVALID_PAGE_ID
+   */
+  void RecordNextPage(page_id_t page_id, page_id_t next_page_id);
+
+  /**
+   * Prefetch the pages at positions [begin, end) of the page chain, as far as the chain is known.
+   * @param begin position of the first page to prefetch
+   * @param end position after the last page to prefetch
+   * @return the position after the last known page that was considered, at most end
+   */
+  size_t ReadAhead(size_t begin, size_t end);
+
+  /** @return the bytes of a table page open to its layout, which depend on the page size of the buffer pool */
+  uint32_t UsablePageSize() const {
+    return static_cast<uint32_t>(buffer_pool_manager_->GetPageSize() - PAGE_CHECKSUM_SIZE);
+  }
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
+  /** Creates the heap's new pages, from extents so that the page chain is laid out sequentially in the file. */
+  ExtentAllocator extent_allocator_;
   page_id_t first_page_id_{};
+  /** The known prefix of the page chain, in chain order. Pages are never unlinked, so it never goes stale. */
+  std::vector<page_id_t> page_ids_;
+  /** This latch protects page_ids_. */
+  std::mutex page_ids_latch_;
 };
 
 }  // namespace bustub
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 
 #include "common/rid.h"
 #include "concurrency/transaction.h"
@@ -29,10 +30,24 @@ class TableIterator {
   friend class Cursor;
 
  public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  /** Position of a page whose place in the page chain is unknown, the iterator does not read ahead from it. */
+  static constexpr size_t UNKNOWN_PAGE_INDEX = SIZE_MAX;
+
+  /**
+   * Create an iterator positioned at rid.
+   * @param table_heap the table being scanned
+   * @param rid the first tuple, or an invalid page id for the end iterator
+   * @param txn the transaction performing the scan
+   * @param page_index position of rid's page in the page chain, if known, to read ahead of it
+   */
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, size_t page_index = UNKNOWN_PAGE_INDEX);
 
   TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+      : table_heap_(other.table_heap_),
+        tuple_(new Tuple(*other.tuple_)),
+        txn_(other.txn_),
+        page_index_(other.page_index_),
+        read_ahead_end_(other.read_ahead_end_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -52,13 +67,25 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     *tuple_ = *other.tuple_;
     txn_ = other.txn_;
+    page_index_ = other.page_index_;
+    read_ahead_end_ = other.read_ahead_end_;
     return *this;
   }
 
  private:
+  /**
+   * Keep the next scan_read_ahead_pages pages after the current one in flight, capped at a quarter of the buffer pool
+   * so that read-ahead does not evict the pages being scanned.
+   */
+  void ReadAhead();
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  /** Position of the current page in the page chain. */
+  size_t page_index_;
+  /** Position after the last page already prefetched. */
+  size_t read_ahead_end_{0};
 };
 
 }  // namespace bustub
@@ -31,6 +31,7 @@ class Tuple {
   friend class TablePage;
   friend class TableHeap;
   friend class TableIterator;
+  friend class LogRecord;
 
  public:
   // Default constructor (to create a dummy tuple)
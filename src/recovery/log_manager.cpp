@@ -12,6 +12,12 @@
 
 #include "recovery/log_manager.h"
 
+#include <cstring>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/macros.h"
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -22,33 +28,226 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  std::scoped_lock lock{latch_};
+  if (flush_running_) {
+    return;
+  }
+  flush_running_ = true;
+  enable_logging = true;
+  flush_thread_ = std::thread(&LogManager::FlushLoop, this);
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
+ * The thread writes out whatever is left in the log buffer before it exits
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  {
+    std::scoped_lock lock{latch_};
+    if (!flush_running_) {
+      return;
+    }
+    flush_running_ = false;
+    enable_logging = false;
+  }
+  cv_.notify_one();
+  flush_thread_.join();
+  // nobody is left to flush for those still waiting
+  flushed_cv_.notify_all();
+}
+
+void LogManager::FlushLoop() {
+  std::unique_lock lock{latch_};
+  while (true) {
+    cv_.wait_for(lock, log_timeout, [this] { return flush_requested_ || !flush_running_; });
+    flush_requested_ = false;
+    bool running = flush_running_;
+    lock.unlock();
+    FlushBuffer();
+    lock.lock();
+    if (!running) {
+      break;
+    }
+  }
+}
+
+void LogManager::RequestFlush() {
+  if (!flush_requested_) {
+    flush_requested_ = true;
+    cv_.notify_one();
+  }
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
  *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
+ * The LSN and the bytes are reserved with one fetch-add, so the record is copied in without a latch
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  auto size = static_cast<uint64_t>(log_record->GetSize());
+  BUSTUB_ASSERT(size <= static_cast<uint64_t>(LOG_BUFFER_SIZE), "log record larger than the log buffer");
+  while (true) {
+    uint64_t reservation = reservation_.fetch_add((UINT64_C(1) << LSN_SHIFT) + size);
+    uint64_t offset = ReservedOffset(reservation);
+    if (offset + size <= static_cast<uint64_t>(LOG_BUFFER_SIZE)) {
+      log_record->lsn_ = ReservedLsn(reservation);
+      SerializeLogRecord(*log_record, log_buffer_ + offset);
+      copied_.fetch_add(size);
+      return log_record->lsn_;
+    }
+    // The first reservation that does not fit seals the buffer, the ones after it see a sealed buffer. All of them
+    // wait for an empty one.
+    if (offset <= static_cast<uint64_t>(LOG_BUFFER_SIZE)) {
+      seal_ = reservation;
+    }
+    std::unique_lock lock{latch_};
+    RequestFlush();
+    append_cv_.wait(lock, [this] { return ReservedOffset(reservation_) < SEALED_OFFSET; });
+  }
+}
+
+void LogManager::SerializeLogRecord(const LogRecord &log_record, char *data) {
+  // the five header fields, in the order they are declared in
+  memcpy(data, &log_record, LogRecord::HEADER_SIZE);
+  char *pos = data + LogRecord::HEADER_SIZE;
+  if (log_record.log_record_type_ == LogRecordType::CLR) {
+    memcpy(pos, &log_record.undo_next_lsn_, sizeof(lsn_t));
+    memcpy(pos + sizeof(lsn_t), &log_record.change_type_, sizeof(LogRecordType));
+    pos += sizeof(lsn_t) + sizeof(LogRecordType);
+  }
+  switch (log_record.GetChangeType()) {
+    case LogRecordType::INSERT:
+      memcpy(pos, &log_record.insert_rid_, sizeof(RID));
+      log_record.insert_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(pos, &log_record.delete_rid_, sizeof(RID));
+      log_record.delete_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(pos, &log_record.update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      memcpy(pos, &log_record.update_prefix_, sizeof(uint32_t));
+      memcpy(pos + sizeof(uint32_t), &log_record.update_suffix_, sizeof(uint32_t));
+      pos += 2 * sizeof(uint32_t);
+      log_record.old_tuple_.SerializeTo(pos);
+      pos += sizeof(int32_t) + log_record.old_tuple_.GetLength();
+      log_record.new_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(pos, &log_record.prev_page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &log_record.page_id_, sizeof(page_id_t));
+      break;
+    default:
+      break;
+  }
+}
+
+void LogManager::FlushBuffer() {
+  // seal the buffer, unless a reservation that did not fit has done so already
+  uint64_t reservation = reservation_;
+  while (ReservedOffset(reservation) < SEALED_OFFSET) {
+    if (ReservedOffset(reservation) == 0) {
+      return;
+    }
+    if (reservation_.compare_exchange_weak(reservation, (reservation & ~OFFSET_MASK) | SEALED_OFFSET)) {
+      seal_ = reservation;
+      break;
+    }
+  }
+  uint64_t seal;
+  while ((seal = seal_) == NOT_SEALED) {
+    std::this_thread::yield();
+  }
+  // the appenders of the sealed buffer are only ever copying their records by now
+  uint64_t size = ReservedOffset(seal);
+  while (copied_ != size) {
+    std::this_thread::yield();
+  }
+
+  std::swap(log_buffer_, flush_buffer_);
+  copied_ = 0;
+  seal_ = NOT_SEALED;
+  {
+    // Open the empty buffer, keeping the LSNs the appenders turned away meanwhile have taken. This happens under the
+    // latch so that an appender about to wait for the buffer cannot miss it.
+    std::scoped_lock lock{latch_};
+    reservation = reservation_;
+    while (!reservation_.compare_exchange_weak(reservation, reservation & ~OFFSET_MASK)) {
+    }
+  }
+  append_cv_.notify_all();
+
+  // The records are only durable once written: until then the persistent LSN stays put, and the same buffer is
+  // written again after a timeout. Once the thread is stopped it gives up, and for good, since nothing written after
+  // the lost records could be recovered.
+  while (true) {
+    if (write_failed_) {
+      return;
+    }
+    try {
+      disk_manager_->WriteLog(flush_buffer_, static_cast<int>(size));
+      break;
+    } catch (const Exception &e) {
+      std::unique_lock lock{latch_};
+      if (!flush_running_) {
+        LOG_WARN("the log records from LSN %d on are lost: %s", persistent_lsn_ + 1, e.what());
+        write_failed_ = true;
+        return;
+      }
+      LOG_WARN("can't write the log, trying again: %s", e.what());
+      cv_.wait_for(lock, log_timeout, [this] { return !flush_running_; });
+    }
+  }
+  {
+    std::scoped_lock lock{latch_};
+    persistent_lsn_ = ReservedLsn(seal) - 1;
+    // the records of the next buffer come after these, with LSNs from the seal on
+    log_size_ += static_cast<off_t>(size);
+    log_offsets_[ReservedLsn(seal)] = log_size_;
+  }
+  flushed_cv_.notify_all();
+}
+
+off_t LogManager::GetLogOffset(lsn_t lsn) {
+  std::scoped_lock lock{latch_};
+  auto it = log_offsets_.upper_bound(lsn);
+  // older than anything still known, read the whole log
+  if (it == log_offsets_.begin()) {
+    return 0;
+  }
+  --it;
+  off_t offset = it->second;
+  log_offsets_.erase(log_offsets_.begin(), it);
+  return offset;
+}
+
+/*
+ * Wait for the flush thread to make the log durable up to lsn
+ * Whoever waits meanwhile is served by the same write
+ */
+void LogManager::Flush(lsn_t lsn) { WaitForLsn(lsn, true); }
+
+void LogManager::WaitForFlush(lsn_t lsn) { WaitForLsn(lsn, false); }
+
+void LogManager::WaitForLsn(lsn_t lsn, bool force) {
+  lsn = std::min(lsn, GetNextLSN() - 1);
+  if (persistent_lsn_ >= lsn) {
+    return;
+  }
+  std::unique_lock lock{latch_};
+  if (!flush_running_) {
+    return;
+  }
+  if (force) {
+    RequestFlush();
+  }
+  flushed_cv_.wait(lock, [this, lsn] { return persistent_lsn_ >= lsn || !flush_running_; });
+}
 
 }  // namespace bustub
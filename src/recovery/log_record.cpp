@@ -0,0 +1,82 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_record.cpp
+//
+// Identification: src/recovery/log_record.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/log_record.h"
+
+#include <cstring>
+#include <string>
+
+#include "common/exception.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+LogRecord::LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const LogRecord &undone_record)
+    : txn_id_(txn_id),
+      prev_lsn_(prev_lsn),
+      log_record_type_(log_record_type),
+      undo_next_lsn_(undone_record.prev_lsn_) {
+  BUSTUB_ASSERT(log_record_type == LogRecordType::CLR, "only a compensation record holds the undo of another");
+  switch (undone_record.log_record_type_) {
+    case LogRecordType::INSERT:
+      change_type_ = LogRecordType::APPLYDELETE;
+      delete_rid_ = undone_record.insert_rid_;
+      delete_tuple_ = View(undone_record.insert_tuple_.data_, undone_record.insert_tuple_.size_);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      change_type_ = undone_record.log_record_type_ == LogRecordType::MARKDELETE ? LogRecordType::ROLLBACKDELETE
+                                                                                 : LogRecordType::MARKDELETE;
+      delete_rid_ = undone_record.delete_rid_;
+      delete_tuple_ = View(undone_record.delete_tuple_.data_, undone_record.delete_tuple_.size_);
+      break;
+    case LogRecordType::APPLYDELETE:
+      // the tuple goes back into the slot it was removed from
+      change_type_ = LogRecordType::INSERT;
+      insert_rid_ = undone_record.delete_rid_;
+      insert_tuple_ = View(undone_record.delete_tuple_.data_, undone_record.delete_tuple_.size_);
+      break;
+    case LogRecordType::UPDATE:
+      change_type_ = LogRecordType::UPDATE;
+      update_rid_ = undone_record.update_rid_;
+      update_prefix_ = undone_record.update_prefix_;
+      update_suffix_ = undone_record.update_suffix_;
+      old_tuple_ = View(undone_record.new_tuple_.data_, undone_record.new_tuple_.size_);
+      new_tuple_ = View(undone_record.old_tuple_.data_, undone_record.old_tuple_.size_);
+      break;
+    default:
+      BUSTUB_ASSERT(false, "only a change to a tuple is undone");
+  }
+  // the change is laid out as the undone one, after the undo-next LSN and its type
+  size_ = undone_record.size_ + sizeof(lsn_t) + sizeof(LogRecordType);
+}
+
+Tuple LogRecord::ApplyUpdate(const Tuple &tuple, bool redo) const {
+  BUSTUB_ASSERT(GetChangeType() == LogRecordType::UPDATE, "only an update has a delta to apply");
+  const Tuple &from = redo ? old_tuple_ : new_tuple_;
+  const Tuple &to = redo ? new_tuple_ : old_tuple_;
+  // a tuple that is missing reads back empty
+  if (tuple.size_ != update_prefix_ + from.size_ + update_suffix_) {
+    throw Exception(ExceptionType::IO, "update " + std::to_string(lsn_) + " does not match the tuple it applies to");
+  }
+
+  Tuple result(tuple.rid_);
+  result.size_ = update_prefix_ + to.size_ + update_suffix_;
+  result.data_ = new char[result.size_];
+  result.allocated_ = true;
+  memcpy(result.data_, tuple.data_, update_prefix_);
+  memcpy(result.data_ + update_prefix_, to.data_, to.size_);
+  memcpy(result.data_ + update_prefix_ + to.size_, tuple.data_ + tuple.size_ - update_suffix_, update_suffix_);
+  return result;
+}
+
+}  // namespace bustub
@@ -12,29 +12,404 @@
 
 #include "recovery/log_recovery.h"
 
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "buffer/page_guard.h"
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/macros.h"
+#include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
+
+/** Batches a partition may have queued before the analysis pass waits for its worker to catch up. */
+static constexpr size_t MAX_QUEUED_BATCHES = 8;
+
 /*
  * deserialize a log record from log buffer
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) { return false; }
+bool LogRecovery::DeserializeLogRecord(const char *data, int size, LogRecord *log_record) {
+  if (size < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  memcpy(&log_record->size_, data, sizeof(int32_t));
+  memcpy(&log_record->lsn_, data + 4, sizeof(lsn_t));
+  memcpy(&log_record->txn_id_, data + 8, sizeof(txn_id_t));
+  memcpy(&log_record->prev_lsn_, data + 12, sizeof(lsn_t));
+  memcpy(&log_record->log_record_type_, data + 16, sizeof(LogRecordType));
+  // the log ends in zeros, or in a record that was only partly written out
+  if (log_record->size_ < LogRecord::HEADER_SIZE || log_record->size_ > size ||
+      log_record->log_record_type_ <= LogRecordType::INVALID || log_record->log_record_type_ > LogRecordType::CLR) {
+    return false;
+  }
+
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  if (log_record->log_record_type_ == LogRecordType::CLR) {
+    memcpy(&log_record->undo_next_lsn_, pos, sizeof(lsn_t));
+    memcpy(&log_record->change_type_, pos + sizeof(lsn_t), sizeof(LogRecordType));
+    if (log_record->change_type_ < LogRecordType::INSERT || log_record->change_type_ > LogRecordType::UPDATE) {
+      return false;
+    }
+    pos += sizeof(lsn_t) + sizeof(LogRecordType);
+  }
+  switch (log_record->GetChangeType()) {
+    case LogRecordType::INSERT:
+      memcpy(&log_record->insert_rid_, pos, sizeof(RID));
+      log_record->insert_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(&log_record->delete_rid_, pos, sizeof(RID));
+      log_record->delete_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(&log_record->update_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      memcpy(&log_record->update_prefix_, pos, sizeof(uint32_t));
+      memcpy(&log_record->update_suffix_, pos + sizeof(uint32_t), sizeof(uint32_t));
+      pos += 2 * sizeof(uint32_t);
+      log_record->old_tuple_.DeserializeFrom(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.DeserializeFrom(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(&log_record->prev_page_id_, pos, sizeof(page_id_t));
+      memcpy(&log_record->page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+      break;
+    default:
+      break;
+  }
+  return true;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
- *read log file from the beginning to end (you must prefetch log records into
+ *read log file from the master record to end (you must prefetch log records into
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
+ *
+ *The log is read on the calling thread while the workers replay what has been read so far
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  BUSTUB_ASSERT(!enable_logging, "recovery has to finish before anything is logged");
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  next_lsn_ = 0;
+
+  StartWorkers(&LogRecovery::RedoRecord);
+  std::vector<std::vector<LogRecord>> batches(num_threads_);
+  // the last checkpoint knows where the first record lies that may not be on disk, or belongs to a loser
+  offset_ = disk_manager_->ReadMasterRecord();
+  // bytes at the start of log_buffer_ left over from the last read, the beginning of a record
+  int leftover = 0;
+  while (disk_manager_->ReadLog(log_buffer_ + leftover, LOG_BUFFER_SIZE - leftover, offset_ + leftover)) {
+    int pos = 0;
+    while (true) {
+      LogRecord log_record;
+      if (!DeserializeLogRecord(log_buffer_ + pos, LOG_BUFFER_SIZE - pos, &log_record)) {
+        break;
+      }
+      next_lsn_ = std::max(next_lsn_, log_record.lsn_ + 1);
+      lsn_mapping_[log_record.lsn_] = offset_ + pos;
+      if (log_record.log_record_type_ == LogRecordType::COMMIT ||
+          log_record.log_record_type_ == LogRecordType::ABORT) {
+        active_txn_.erase(log_record.txn_id_);
+      } else if (log_record.log_record_type_ != LogRecordType::CHECKPOINT) {
+        active_txn_[log_record.txn_id_] = log_record.lsn_;
+      }
+      // the page may be free in the space map on disk, and must not be handed out again
+      if (log_record.log_record_type_ == LogRecordType::NEWPAGE) {
+        disk_manager_->MarkAllocated(log_record.page_id_);
+      }
+      AddToBatches(log_record, &batches);
+      pos += log_record.size_;
+    }
+    Dispatch(&batches);
+    // not even one record in a full buffer, the log ends here
+    if (pos == 0) {
+      break;
+    }
+    leftover = LOG_BUFFER_SIZE - pos;
+    memmove(log_buffer_, log_buffer_ + pos, leftover);
+    offset_ += pos;
+  }
+  StopWorkers();
+  // the log goes on after its last whole record, whatever is appended to it from now on has to be read back
+  off_t log_size = disk_manager_->GetLogSize();
+  if (log_size > offset_) {
+    LOG_WARN("dropping the last %s bytes of the log, a record that was not written completely",
+             std::to_string(log_size - offset_).c_str());
+    disk_manager_->TruncateLog(offset_);
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
+ *
+ *The records of the losers are collected first, and a compensation record (CLR) that undoes each of them is logged,
+ *newest first, followed by an ABORT record for every loser. Only once those are durable the workers redo the CLRs on
+ *their pages. The pages never get ahead of the log this way, and recovery after a crash during or after undo redoes
+ *what was undone rather than undoing it again: it follows the undo-next LSN of a loser's last CLR, and skips a loser
+ *with an ABORT record altogether.
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  BUSTUB_ASSERT(!enable_logging, "recovery has to finish before anything is logged");
+  std::vector<LogRecord> undone_records;
+  for (const auto &[txn_id, last_lsn] : active_txn_) {
+    lsn_t lsn = last_lsn;
+    while (lsn != INVALID_LSN) {
+      LogRecord log_record;
+      ReadLogRecord(lsn, &log_record);
+      // the records from the one before it up to the undo-next LSN were undone by an earlier recovery
+      if (log_record.log_record_type_ == LogRecordType::CLR) {
+        lsn = log_record.undo_next_lsn_;
+        continue;
+      }
+      lsn = log_record.prev_lsn_;
+      // a new page stays in its table heap, empty
+      if (log_record.log_record_type_ != LogRecordType::NEWPAGE && PageOf(log_record) != INVALID_PAGE_ID) {
+        undone_records.push_back(std::move(log_record));
+      }
+    }
+  }
+  // the changes of different transactions to one page are undone in the reverse order they were made in
+  std::sort(undone_records.begin(), undone_records.end(),
+            [](const LogRecord &a, const LogRecord &b) { return a.lsn_ > b.lsn_; });
+
+  // the CLRs refer to the tuples of the records they undo
+  std::vector<LogRecord> log_records;
+  log_records.reserve(undone_records.size() + active_txn_.size());
+  size_t size = 0;
+  for (const auto &undone_record : undone_records) {
+    lsn_t &last_lsn = active_txn_[undone_record.txn_id_];
+    log_records.emplace_back(undone_record.txn_id_, last_lsn, LogRecordType::CLR, undone_record);
+    log_records.back().lsn_ = last_lsn = next_lsn_++;
+    size += log_records.back().size_;
+  }
+  for (const auto &[txn_id, last_lsn] : active_txn_) {
+    log_records.emplace_back(txn_id, last_lsn, LogRecordType::ABORT);
+    log_records.back().lsn_ = next_lsn_++;
+    size += log_records.back().size_;
+  }
+  std::vector<char> data(size);
+  size_t pos = 0;
+  for (const auto &log_record : log_records) {
+    LogManager::SerializeLogRecord(log_record, data.data() + pos);
+    pos += log_record.size_;
+  }
+  if (size > 0) {
+    disk_manager_->WriteLog(data.data(), static_cast<int>(size));
+  }
+
+  std::vector<std::vector<LogRecord>> batches(num_threads_);
+  for (const auto &log_record : log_records) {
+    AddToBatches(log_record, &batches);
+  }
+  StartWorkers(&LogRecovery::RedoRecord);
+  Dispatch(&batches);
+  StopWorkers();
+  active_txn_.clear();
+}
+
+void LogRecovery::ReadLogRecord(lsn_t lsn, LogRecord *log_record) {
+  auto it = lsn_mapping_.find(lsn);
+  BUSTUB_ASSERT(it != lsn_mapping_.end(), "the previous record of a transaction is not in the log");
+  int32_t size;
+  disk_manager_->ReadLog(log_buffer_, LogRecord::HEADER_SIZE, it->second);
+  memcpy(&size, log_buffer_, sizeof(size));
+  disk_manager_->ReadLog(log_buffer_, size, it->second);
+  if (!DeserializeLogRecord(log_buffer_, size, log_record)) {
+    throw Exception(ExceptionType::IO, "record " + std::to_string(lsn) + " of the log can not be read back");
+  }
+}
+
+page_id_t LogRecovery::PageOf(const LogRecord &log_record) {
+  switch (log_record.GetChangeType()) {
+    case LogRecordType::INSERT:
+      return log_record.insert_rid_.GetPageId();
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      return log_record.delete_rid_.GetPageId();
+    case LogRecordType::UPDATE:
+      return log_record.update_rid_.GetPageId();
+    case LogRecordType::NEWPAGE:
+      return log_record.page_id_;
+    default:
+      return INVALID_PAGE_ID;
+  }
+}
+
+void LogRecovery::AddToBatches(const LogRecord &log_record, std::vector<std::vector<LogRecord>> *batches) const {
+  page_id_t page_id = PageOf(log_record);
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  size_t partition = PartitionOf(page_id);
+  (*batches)[partition].push_back(log_record);
+  // a new page is also linked into the page before it, by whoever redoes that page
+  if (log_record.log_record_type_ == LogRecordType::NEWPAGE && log_record.prev_page_id_ != INVALID_PAGE_ID &&
+      PartitionOf(log_record.prev_page_id_) != partition) {
+    (*batches)[PartitionOf(log_record.prev_page_id_)].push_back(log_record);
+  }
+}
+
+void LogRecovery::StartWorkers(ApplyFunc apply) {
+  partitions_ = std::vector<Partition>(num_threads_);
+  error_ = nullptr;
+  for (size_t partition = 0; partition < num_threads_; partition++) {
+    workers_.emplace_back(&LogRecovery::RunWorker, this, partition, apply);
+  }
+}
+
+void LogRecovery::Dispatch(std::vector<std::vector<LogRecord>> *batches) {
+  for (size_t partition = 0; partition < num_threads_; partition++) {
+    auto &batch = (*batches)[partition];
+    if (batch.empty()) {
+      continue;
+    }
+    Partition &part = partitions_[partition];
+    {
+      std::unique_lock lock{part.latch_};
+      // do not read the log further ahead of a worker than a few batches
+      part.cv_.wait(lock, [&part] { return part.batches_.size() < MAX_QUEUED_BATCHES; });
+      part.batches_.push_back(std::move(batch));
+    }
+    part.cv_.notify_all();
+    batch.clear();
+  }
+}
+
+void LogRecovery::StopWorkers() {
+  for (auto &part : partitions_) {
+    {
+      std::scoped_lock lock{part.latch_};
+      part.done_ = true;
+    }
+    part.cv_.notify_all();
+  }
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  if (error_ != nullptr) {
+    std::rethrow_exception(error_);
+  }
+}
+
+void LogRecovery::RunWorker(size_t partition, ApplyFunc apply) {
+  Partition &part = partitions_[partition];
+  bool failed = false;
+  while (true) {
+    std::vector<LogRecord> batch;
+    {
+      std::unique_lock lock{part.latch_};
+      part.cv_.wait(lock, [&part] { return part.done_ || !part.batches_.empty(); });
+      if (part.batches_.empty()) {
+        return;
+      }
+      batch = std::move(part.batches_.front());
+      part.batches_.pop_front();
+    }
+    part.cv_.notify_all();
+    // the pages of a partition are left alone after an error, but its batches are still drained
+    if (failed) {
+      continue;
+    }
+    try {
+      for (auto &log_record : batch) {
+        (this->*apply)(partition, &log_record);
+      }
+    } catch (...) {
+      failed = true;
+      std::scoped_lock lock{error_latch_};
+      if (error_ == nullptr) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+}
+
+void LogRecovery::RedoRecord(size_t partition, LogRecord *log_record) {
+  lsn_t lsn = log_record->lsn_;
+  if (log_record->log_record_type_ == LogRecordType::NEWPAGE) {
+    page_id_t page_id = log_record->page_id_;
+    page_id_t prev_page_id = log_record->prev_page_id_;
+    if (PartitionOf(page_id) == partition) {
+      WritePageGuard guard = buffer_pool_manager_->FetchPageWrite(page_id);
+      if (!guard) {
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "no free frame to recover a page in");
+      }
+      auto page = static_cast<TablePage *>(guard.GetPage());
+      // Initializing twice does no harm. This also covers a page that never made it to disk, which reads back as
+      // zeros, that is with LSN 0.
+      if (page->GetLSN() <= lsn) {
+        page->Init(page_id, UsablePageSize(), prev_page_id, nullptr, nullptr);
+        page->SetLSN(lsn);
+        guard.SetDirty();
+      }
+    }
+    // the link from the page before is not logged on its own
+    if (prev_page_id != INVALID_PAGE_ID && PartitionOf(prev_page_id) == partition) {
+      WritePageGuard guard = buffer_pool_manager_->FetchPageWrite(prev_page_id);
+      if (!guard) {
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "no free frame to recover a page in");
+      }
+      auto page = static_cast<TablePage *>(guard.GetPage());
+      if (page->GetNextPageId() != page_id) {
+        page->SetNextPageId(page_id);
+        guard.SetDirty();
+      }
+    }
+    return;
+  }
+
+  WritePageGuard guard = buffer_pool_manager_->FetchPageWrite(PageOf(*log_record));
+  if (!guard) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "no free frame to recover a page in");
+  }
+  auto page = static_cast<TablePage *>(guard.GetPage());
+  // the page already holds the change
+  if (page->GetLSN() >= lsn) {
+    return;
+  }
+  switch (log_record->GetChangeType()) {
+    case LogRecordType::INSERT:
+      if (!page->InsertTupleAt(log_record->insert_tuple_, log_record->insert_rid_)) {
+        throw Exception(ExceptionType::IO, "insert " + std::to_string(lsn) + " does not fit the page it applies to");
+      }
+      break;
+    case LogRecordType::MARKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      // the record only holds the bytes that changed, the rest of the new tuple comes from the old one
+      Tuple old_tuple;
+      page->GetTuple(log_record->update_rid_, &old_tuple, nullptr, nullptr);
+      Tuple new_tuple = log_record->ApplyUpdate(old_tuple, true);
+      page->UpdateTuple(new_tuple, &old_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+      break;
+    }
+    default:
+      break;
+  }
+  page->SetLSN(lsn);
+  guard.SetDirty();
+}
 
 }  // namespace bustub
@@ -0,0 +1,142 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.cpp
+//
+// Identification: src/storage/disk/async_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/async_disk_manager.h"
+
+#include "common/exception.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+AsyncDiskManager::AsyncDiskManager(const std::string &db_file, size_t num_workers, bool direct_io,
+                                   bool compress_pages, size_t page_size)
+    : DiskManager(db_file, direct_io, compress_pages, page_size) {
+  workers_.reserve(num_workers);
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers_.emplace_back(&AsyncDiskManager::RunWorker, this);
+  }
+}
+
+AsyncDiskManager::~AsyncDiskManager() { StopWorkers(); }
+
+void AsyncDiskManager::ShutDown() {
+  StopWorkers();
+  DiskManager::ShutDown();
+}
+
+std::future<void> AsyncDiskManager::ReadPageAsync(page_id_t page_id, char *page_data) {
+  return Submit({{false, page_id, page_data}});
+}
+
+std::future<void> AsyncDiskManager::WritePageAsync(page_id_t page_id, const char *page_data) {
+  return Submit({{true, page_id, const_cast<char *>(page_data)}});
+}
+
+std::future<void> AsyncDiskManager::SubmitBatch(std::vector<DiskRequest> requests, DiskCallback on_complete) {
+  return Submit(std::move(requests), std::move(on_complete));
+}
+
+std::future<void> AsyncDiskManager::Submit(std::vector<DiskRequest> requests, DiskCallback on_complete) {
+  auto batch = std::make_shared<Batch>(requests.size(), std::move(on_complete));
+  auto done = batch->done_.get_future();
+  if (requests.empty()) {
+    batch->done_.set_value();
+    return done;
+  }
+  {
+    std::scoped_lock lock{queue_latch_};
+    BUSTUB_ASSERT(!stopped_, "submitting I/O to a disk manager that was shut down");
+    for (const auto &request : requests) {
+      queue_.emplace_back(request, batch);
+    }
+  }
+  if (requests.size() == 1) {
+    queue_cv_.notify_one();
+  } else {
+    queue_cv_.notify_all();
+  }
+  return done;
+}
+
+void AsyncDiskManager::RunWorker() {
+  while (true) {
+    std::unique_lock lock{queue_latch_};
+    queue_cv_.wait(lock, [this] { return stopped_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    // take along the reads of the pages that directly follow, they are done with one vectored read
+    std::vector<std::pair<DiskRequest, std::shared_ptr<Batch>>> run;
+    run.push_back(std::move(queue_.front()));
+    queue_.pop_front();
+    const DiskRequest first = run.front().first;
+    while (!first.is_write_ && !queue_.empty() && run.size() < MAX_VECTORED_READ_PAGES &&
+           !queue_.front().first.is_write_ &&
+           queue_.front().first.page_id_ == first.page_id_ + static_cast<page_id_t>(run.size())) {
+      run.push_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+    lock.unlock();
+
+    if (first.is_write_) {
+      try {
+        WritePage(first.page_id_, first.data_);
+      } catch (const Exception &e) {
+        run.front().first.error_ = std::current_exception();
+      }
+    } else {
+      std::vector<DiskRequest *> reads;
+      reads.reserve(run.size());
+      for (auto &[request, batch] : run) {
+        reads.push_back(&request);
+      }
+      ReadRun(reads);
+    }
+    for (const auto &[request, batch] : run) {
+      if (request.error_ != nullptr) {
+        std::scoped_lock error_lock{batch->error_latch_};
+        if (batch->error_ == nullptr) {
+          batch->error_ = request.error_;
+        }
+      }
+      if (batch->on_complete_) {
+        batch->on_complete_(request);
+      }
+      if (--batch->remaining_ != 0) {
+        continue;
+      }
+      std::scoped_lock error_lock{batch->error_latch_};
+      if (batch->error_ != nullptr) {
+        batch->done_.set_exception(batch->error_);
+      } else {
+        batch->done_.set_value();
+      }
+    }
+  }
+}
+
+void AsyncDiskManager::StopWorkers() {
+  {
+    std::scoped_lock lock{queue_latch_};
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+  }
+  queue_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+}
+
+}  // namespace bustub
@@ -0,0 +1,454 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_page_store.cpp
+//
+// Identification: src/storage/disk/compressed_page_store.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/compressed_page_store.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/macros.h"
+#include "common/util/crc32c.h"
+#include "common/util/lz4_codec.h"
+
+namespace bustub {
+
+namespace {
+
+constexpr uint32_t MAP_MAGIC = 0x5a4d4150;
+
+/** One page of a saved map. */
+struct MapEntry {
+  page_id_t page_id_;
+  uint32_t sectors_;
+  uint64_t sector_;
+  uint64_t sequence_;
+};
+
+}  // namespace
+
+CompressedPageStore::CompressedPageStore(const std::string &file_name,
+                                         const std::function<bool(page_id_t)> &is_allocated)
+    : file_name_(file_name), map_file_name_(file_name + ".map") {
+  static_assert(sizeof(RecordHeader) == 24);
+  fd_ = open(file_name.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (fd_ < 0) {
+    throw Exception("can't open compressed page store");
+  }
+  struct stat stat_buf;
+  if (fstat(fd_, &stat_buf) != 0) {
+    throw Exception("can't stat compressed page store");
+  }
+  auto file_sectors = static_cast<uint64_t>((stat_buf.st_size + SECTOR_SIZE - 1) / SECTOR_SIZE);
+  if (!LoadMap()) {
+    if (file_sectors > 0) {
+      LOG_INFO("rebuilding the page map of %s from its records", file_name_.c_str());
+    }
+    ScanRecords(is_allocated);
+  }
+  RebuildFreeSpace(file_sectors);
+}
+
+CompressedPageStore::~CompressedPageStore() { Close(); }
+
+void CompressedPageStore::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+  // the records have to be on disk before a map that points to them
+  fdatasync(fd_);
+  SaveMap();
+  close(fd_);
+  fd_ = -1;
+}
+
+void CompressedPageStore::Write(page_id_t page_id, const char *page_data) {
+  BUSTUB_ASSERT(page_id >= 0, "invalid page id");
+  static thread_local std::array<char, MAX_RECORD_SECTORS * SECTOR_SIZE> record;
+  char *payload = record.data() + sizeof(RecordHeader);
+  RecordHeader header{};
+  header.page_id_ = page_id;
+  // a compressed page has to save at least a sector over an uncompressed one to be worth decompressing
+  size_t capacity = (PAGE_SIZE / SECTOR_SIZE - 1) * SECTOR_SIZE - sizeof(RecordHeader);
+  size_t compressed_size = Lz4Codec::Compress(page_data, PAGE_SIZE, payload, capacity);
+  if (compressed_size == 0) {
+    header.codec_ = RAW;
+    header.payload_size_ = PAGE_SIZE;
+    memcpy(payload, page_data, PAGE_SIZE);
+  } else {
+    header.codec_ = LZ4;
+    header.payload_size_ = static_cast<uint32_t>(compressed_size);
+  }
+  auto sectors = static_cast<uint32_t>((sizeof(RecordHeader) + header.payload_size_ + SECTOR_SIZE - 1) / SECTOR_SIZE);
+  size_t record_size = sectors * SECTOR_SIZE;
+  memset(payload + header.payload_size_, 0, record_size - sizeof(RecordHeader) - header.payload_size_);
+
+  auto index = static_cast<size_t>(page_id);
+  uint64_t sector;
+  {
+    std::scoped_lock lock{latch_};
+    header.sequence_ = next_sequence_++;
+    if (index >= extents_.size()) {
+      extents_.resize(index + 1);
+    }
+    sector = AllocateSectors(sectors);
+  }
+  header.checksum_ = RecordChecksum(header, payload);
+  memcpy(record.data(), &header, sizeof(header));
+
+  size_t done = 0;
+  while (done < record_size) {
+    ssize_t ret = pwrite(fd_, record.data() + done, record_size - done, sector * SECTOR_SIZE + done);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      int error = errno;
+      // the page keeps its old record, the sectors of the new one are free again
+      {
+        std::scoped_lock lock{latch_};
+        FreeSectors(sector, sectors);
+      }
+      throw Exception(ExceptionType::IO, "I/O error while writing " + file_name_ + ": " + strerror(error));
+    }
+    done += ret;
+  }
+  bytes_written_ += record_size;
+
+  // the old record is only given up once the new one is written, a crash in between leaves the old version
+  std::scoped_lock lock{latch_};
+  Extent &current = extents_[index];
+  if (current.sectors_ != 0) {
+    FreeSectors(current.sector_, current.sectors_);
+  }
+  num_pages_ += current.sectors_ == 0 ? 1 : 0;
+  stored_sectors_ = stored_sectors_ - current.sectors_ + sectors;
+  current = {sector, sectors, header.sequence_};
+}
+
+void CompressedPageStore::ReadPages(page_id_t first_page_id, char *const *page_data, size_t num_pages,
+                                    std::vector<page_id_t> *corrupt) {
+  static thread_local std::vector<char> buf;
+  std::vector<Extent> run;
+  size_t done = 0;
+  while (done < num_pages) {
+    // the pages whose records follow each other in the file are read at once
+    run.clear();
+    uint64_t run_sectors = 0;
+    {
+      std::scoped_lock lock{latch_};
+      for (size_t i = done; i < num_pages; ++i) {
+        auto index = static_cast<size_t>(first_page_id) + i;
+        Extent extent = index < extents_.size() ? extents_[index] : Extent{};
+        if (extent.sectors_ == 0 || run_sectors + extent.sectors_ > MAX_READ_SECTORS ||
+            (!run.empty() && extent.sector_ != run.back().sector_ + run.back().sectors_)) {
+          break;
+        }
+        run.push_back(extent);
+        run_sectors += extent.sectors_;
+      }
+    }
+    if (run.empty()) {
+      memset(page_data[done++], 0, PAGE_SIZE);
+      continue;
+    }
+
+    buf.resize(run_sectors * SECTOR_SIZE);
+    ReadAt(run.front().sector_ * SECTOR_SIZE, buf.data(), buf.size());
+    bytes_read_ += buf.size();
+    const char *record = buf.data();
+    for (const Extent &extent : run) {
+      page_id_t page_id = first_page_id + static_cast<page_id_t>(done);
+      RecordHeader header;
+      if (!DecodeRecord(record, extent.sectors_ * SECTOR_SIZE, page_id, &header, page_data[done])) {
+        if (corrupt == nullptr) {
+          throw Exception(ExceptionType::IO,
+                          "the record of page " + std::to_string(page_id) + " in " + file_name_ + " is damaged");
+        }
+        corrupt->push_back(page_id);
+        memset(page_data[done], 0, PAGE_SIZE);
+      }
+      record += extent.sectors_ * SECTOR_SIZE;
+      done++;
+    }
+  }
+}
+
+void CompressedPageStore::Discard(page_id_t page_id) {
+  std::scoped_lock lock{latch_};
+  auto index = static_cast<size_t>(page_id);
+  if (index >= extents_.size() || extents_[index].sectors_ == 0) {
+    return;
+  }
+  // the record stays valid on disk; if the page is still allocated after a crash it is found again, as it would be in
+  // the database file
+  FreeSectors(extents_[index].sector_, extents_[index].sectors_);
+  stored_sectors_ -= extents_[index].sectors_;
+  num_pages_--;
+  extents_[index] = Extent{};
+}
+
+size_t CompressedPageStore::GetNumPages() {
+  std::scoped_lock lock{latch_};
+  return num_pages_;
+}
+
+size_t CompressedPageStore::GetStoredBytes() {
+  std::scoped_lock lock{latch_};
+  return stored_sectors_ * SECTOR_SIZE;
+}
+
+uint32_t CompressedPageStore::RecordChecksum(const RecordHeader &header, const char *payload) {
+  uint32_t crc = Crc32c::Value(reinterpret_cast<const char *>(&header) + sizeof(header.checksum_),
+                               sizeof(RecordHeader) - sizeof(header.checksum_));
+  return Crc32c::Extend(crc, payload, header.payload_size_);
+}
+
+bool CompressedPageStore::DecodeRecord(const char *record, size_t size, page_id_t page_id, RecordHeader *header,
+                                       char *page_data) {
+  if (size < sizeof(RecordHeader)) {
+    return false;
+  }
+  memcpy(header, record, sizeof(RecordHeader));
+  if (header->payload_size_ > size - sizeof(RecordHeader) || header->payload_size_ > PAGE_SIZE ||
+      (header->codec_ != RAW && header->codec_ != LZ4) ||
+      (header->codec_ == RAW && header->payload_size_ != PAGE_SIZE) || header->page_id_ < 0 ||
+      (page_id != INVALID_PAGE_ID && header->page_id_ != page_id)) {
+    return false;
+  }
+  const char *payload = record + sizeof(RecordHeader);
+  if (header->checksum_ != RecordChecksum(*header, payload)) {
+    return false;
+  }
+  if (page_data == nullptr) {
+    return true;
+  }
+  if (header->codec_ == RAW) {
+    memcpy(page_data, payload, PAGE_SIZE);
+    return true;
+  }
+  return Lz4Codec::Decompress(payload, header->payload_size_, page_data, PAGE_SIZE);
+}
+
+/**
+ * Saved map layout: magic, number of entries, next sequence number, the entries, and a CRC-32C of all of that
+ */
+bool CompressedPageStore::LoadMap() {
+  std::ifstream in(map_file_name_, std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+  std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  // a map is only good until the store changes again, from here on the records are what counts
+  remove(map_file_name_.c_str());
+
+  const size_t header_size = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+  uint32_t magic = 0;
+  uint32_t count = 0;
+  uint32_t checksum = 0;
+  if (data.size() >= header_size + sizeof(checksum)) {
+    memcpy(&magic, data.data(), sizeof(magic));
+    memcpy(&count, data.data() + sizeof(magic), sizeof(count));
+    memcpy(&checksum, data.data() + data.size() - sizeof(checksum), sizeof(checksum));
+  }
+  if (magic != MAP_MAGIC || data.size() != header_size + count * sizeof(MapEntry) + sizeof(checksum) ||
+      checksum != Crc32c::Value(data.data(), data.size() - sizeof(checksum))) {
+    LOG_WARN("ignoring the damaged page map %s", map_file_name_.c_str());
+    return false;
+  }
+
+  std::vector<MapEntry> entries(count);
+  memcpy(&next_sequence_, data.data() + 2 * sizeof(uint32_t), sizeof(next_sequence_));
+  memcpy(entries.data(), data.data() + header_size, count * sizeof(MapEntry));
+  for (const MapEntry &entry : entries) {
+    if (entry.page_id_ < 0 || entry.sectors_ == 0 || entry.sectors_ > MAX_RECORD_SECTORS) {
+      LOG_WARN("ignoring the damaged page map %s", map_file_name_.c_str());
+      extents_.clear();
+      return false;
+    }
+    auto index = static_cast<size_t>(entry.page_id_);
+    if (index >= extents_.size()) {
+      extents_.resize(index + 1);
+    }
+    extents_[index] = {entry.sector_, entry.sectors_, entry.sequence_};
+  }
+  return true;
+}
+
+void CompressedPageStore::SaveMap() {
+  std::vector<char> data(2 * sizeof(uint32_t) + sizeof(uint64_t));
+  uint32_t count = 0;
+  for (size_t i = 0; i < extents_.size(); ++i) {
+    if (extents_[i].sectors_ == 0) {
+      continue;
+    }
+    MapEntry entry{static_cast<page_id_t>(i), extents_[i].sectors_, extents_[i].sector_, extents_[i].sequence_};
+    data.insert(data.end(), reinterpret_cast<char *>(&entry), reinterpret_cast<char *>(&entry) + sizeof(entry));
+    count++;
+  }
+  memcpy(data.data(), &MAP_MAGIC, sizeof(MAP_MAGIC));
+  memcpy(data.data() + sizeof(MAP_MAGIC), &count, sizeof(count));
+  memcpy(data.data() + 2 * sizeof(uint32_t), &next_sequence_, sizeof(next_sequence_));
+  uint32_t checksum = Crc32c::Value(data.data(), data.size());
+  data.insert(data.end(), reinterpret_cast<char *>(&checksum), reinterpret_cast<char *>(&checksum) + sizeof(checksum));
+
+  std::ofstream out(map_file_name_, std::ios::binary | std::ios::trunc);
+  out.write(data.data(), static_cast<std::streamsize>(data.size()));
+  out.close();
+  if (out.fail()) {
+    // the map is rebuilt from the records on the next start
+    LOG_WARN("can't save the page map %s", map_file_name_.c_str());
+    remove(map_file_name_.c_str());
+  }
+}
+
+/**
+ * Records start on sector boundaries, so every sector is tried as the start of one; a valid record is skipped as a
+ * whole, since nothing is written inside a record without invalidating it
+ */
+void CompressedPageStore::ScanRecords(const std::function<bool(page_id_t)> &is_allocated) {
+  struct stat stat_buf;
+  if (fstat(fd_, &stat_buf) != 0) {
+    throw Exception("can't stat compressed page store");
+  }
+  auto file_sectors = static_cast<uint64_t>((stat_buf.st_size + SECTOR_SIZE - 1) / SECTOR_SIZE);
+  std::vector<char> window(MAX_READ_SECTORS * SECTOR_SIZE);
+  uint64_t window_sector = 0;
+  bool window_loaded = false;
+  for (uint64_t sector = 0; sector < file_sectors;) {
+    // the window always holds a whole record starting at sector
+    if (!window_loaded || sector + MAX_RECORD_SECTORS > window_sector + MAX_READ_SECTORS) {
+      window_sector = sector;
+      ReadAt(sector * SECTOR_SIZE, window.data(), window.size());
+      bytes_read_ += window.size();
+      window_loaded = true;
+    }
+    RecordHeader header;
+    if (!DecodeRecord(window.data() + (sector - window_sector) * SECTOR_SIZE, MAX_RECORD_SECTORS * SECTOR_SIZE,
+                      INVALID_PAGE_ID, &header, nullptr)) {
+      sector++;
+      continue;
+    }
+    auto sectors = static_cast<uint32_t>((sizeof(RecordHeader) + header.payload_size_ + SECTOR_SIZE - 1) / SECTOR_SIZE);
+    next_sequence_ = std::max(next_sequence_, header.sequence_ + 1);
+    if (is_allocated(header.page_id_)) {
+      auto index = static_cast<size_t>(header.page_id_);
+      if (index >= extents_.size()) {
+        extents_.resize(index + 1);
+      }
+      if (header.sequence_ > extents_[index].sequence_) {
+        extents_[index] = {sector, sectors, header.sequence_};
+      }
+    }
+    sector += sectors;
+  }
+}
+
+/**
+ * The records a scan finds never overlap, but a saved map is only trusted for its checksum; of two records that
+ * overlap, the newer one was written over the older one, which is dropped
+ */
+void CompressedPageStore::RebuildFreeSpace(uint64_t file_sectors) {
+  std::vector<size_t> used;
+  for (size_t i = 0; i < extents_.size(); ++i) {
+    if (extents_[i].sectors_ != 0) {
+      used.push_back(i);
+    }
+  }
+  std::sort(used.begin(), used.end(),
+            [this](size_t a, size_t b) { return extents_[a].sector_ < extents_[b].sector_; });
+  // the pages whose records are kept, in the order of their sectors; only the last one can reach into the next record
+  std::vector<size_t> kept;
+  for (size_t index : used) {
+    if (!kept.empty() && extents_[kept.back()].sector_ + extents_[kept.back()].sectors_ > extents_[index].sector_) {
+      size_t older = extents_[kept.back()].sequence_ < extents_[index].sequence_ ? kept.back() : index;
+      LOG_WARN("dropping the record of page %zu in %s, a newer record overlaps it", older, file_name_.c_str());
+      extents_[older] = Extent{};
+      if (older == index) {
+        continue;
+      }
+      kept.pop_back();
+    }
+    kept.push_back(index);
+  }
+  num_pages_ = kept.size();
+  stored_sectors_ = 0;
+  uint64_t next_sector = 0;
+  auto free_gap = [this](uint64_t from, uint64_t to) {
+    while (from < to) {
+      auto sectors = static_cast<uint32_t>(std::min<uint64_t>(to - from, MAX_RECORD_SECTORS));
+      FreeSectors(from, sectors);
+      from += sectors;
+    }
+  };
+  for (size_t index : kept) {
+    const Extent &extent = extents_[index];
+    free_gap(next_sector, extent.sector_);
+    next_sector = extent.sector_ + extent.sectors_;
+    stored_sectors_ += extent.sectors_;
+  }
+  // whatever lies past the last record is overwritten as the store grows
+  end_sector_ = next_sector;
+  if (file_sectors > end_sector_) {
+    LOG_DEBUG("%lu unused sectors at the end of %s", static_cast<unsigned long>(file_sectors - end_sector_),  // NOLINT
+              file_name_.c_str());
+  }
+}
+
+uint64_t CompressedPageStore::AllocateSectors(uint32_t sectors) {
+  // the smallest free run that is large enough, its rest stays free
+  for (uint32_t run = sectors; run <= MAX_RECORD_SECTORS; ++run) {
+    if (free_[run].empty()) {
+      continue;
+    }
+    uint64_t sector = free_[run].back();
+    free_[run].pop_back();
+    if (run > sectors) {
+      FreeSectors(sector + sectors, run - sectors);
+    }
+    return sector;
+  }
+  uint64_t sector = end_sector_;
+  end_sector_ += sectors;
+  return sector;
+}
+
+void CompressedPageStore::FreeSectors(uint64_t sector, uint32_t sectors) { free_[sectors].push_back(sector); }
+
+void CompressedPageStore::ReadAt(uint64_t offset, char *data, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t ret = pread(fd_, data + done, size - done, static_cast<off_t>(offset + done));
+    if (ret < 0) {
+      LOG_DEBUG("I/O error while reading");
+      break;
+    }
+    if (ret == 0) {
+      break;
+    }
+    done += ret;
+  }
+  memset(data + done, 0, size - done);
+}
+
+}  // namespace bustub
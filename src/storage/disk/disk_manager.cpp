@@ -10,16 +10,25 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <utility>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/macros.h"
+#include "common/util/crc32c.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
@@ -29,104 +38,801 @@ static char *buffer_used;
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
+ * @input direct_io: bypass the OS page cache for the database file if the file system allows it
+ * @input compress_pages: keep the data pages compressed in <db file stem>.zpg
+ * @input page_size: size of the pages of the database file
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, bool direct_io, bool compress_pages, size_t page_size)
+    : DiskManager(db_file, direct_io, compress_pages, page_size, FirstPageOf(DEFAULT_TABLESPACE_ID)) {}
+
+/**
+ * Constructor: open/create the database file of one tablespace, and the log file if it is the default tablespace
+ * @input first_page_id: the database-wide id of the file's page 0
+ */
+DiskManager::DiskManager(const std::string &db_file, bool direct_io, bool compress_pages, size_t page_size,
+                         page_id_t first_page_id)
+    : file_name_(db_file),
+      page_size_(page_size),
+      pages_per_map_page_(static_cast<page_id_t>(page_size * 8)),
+      first_page_id_(first_page_id),
+      num_flushes_(0),
+      num_writes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr) {
+  if (!IsValidPageSize(page_size)) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "invalid page size " + std::to_string(page_size));
+  }
+  if (compress_pages && page_size != PAGE_SIZE) {
+    throw NotImplementedException("page compression is only supported for pages of PAGE_SIZE");
+  }
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
-  log_name_ = file_name_.substr(0, n) + ".log";
-
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
+  // the other tablespaces log to the main file's log
+  if (TablespaceOf(first_page_id_) == DEFAULT_TABLESPACE_ID) {
+    log_name_ = file_name_.substr(0, n) + ".log";
+
+    log_fd_ = open(log_name_.c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+    if (log_fd_ < 0) {
       throw Exception("can't open dblog file");
     }
+    master_name_ = file_name_.substr(0, n) + ".ckpt";
+    // a master record points into the log it was written for, not into a new one
+    if (GetFileSize(log_name_) == 0) {
+      remove(master_name_.c_str());
+    }
+    buffer_used = nullptr;
   }
 
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
-      throw Exception("can't open db file");
+  int flags = O_RDWR | O_CREAT;
+  if (direct_io) {
+    db_fd_ = open(db_file.c_str(), flags | O_DIRECT, S_IRUSR | S_IWUSR);
+    // not every file system supports direct I/O, fall back to the page cache there
+    if (db_fd_ < 0 && errno == EINVAL) {
+      LOG_WARN("direct I/O is not supported for %s, using buffered I/O", db_file.c_str());
+    }
+    direct_io_ = db_fd_ >= 0;
+  }
+  if (db_fd_ < 0) {
+    db_fd_ = open(db_file.c_str(), flags, S_IRUSR | S_IWUSR);
+  }
+  if (db_fd_ < 0) {
+    throw Exception("can't open db file");
+  }
+  LoadSpaceMap();
+  if (compress_pages) {
+    page_store_ = std::make_unique<CompressedPageStore>(file_name_.substr(0, n) + ".zpg",
+                                                        [this](page_id_t page_id) { return IsAllocated(page_id); });
+  }
+  // a compressed store only holds pages of PAGE_SIZE
+  if (page_store_ == nullptr) {
+    try {
+      CheckPageSize();
+    } catch (...) {
+      close(db_fd_);
+      if (log_fd_ >= 0) {
+        close(log_fd_);
+      }
+      throw;
     }
   }
-  buffer_used = nullptr;
+}
+
+DiskManager::~DiskManager() {
+  if (page_store_ != nullptr) {
+    page_store_->Close();
+  }
+  if (db_fd_ >= 0) {
+    try {
+      FlushSpaceMap();
+    } catch (const Exception &e) {
+      LOG_WARN("the free space map of %s could not be written: %s", file_name_.c_str(), e.what());
+    }
+    close(db_fd_);
+  }
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+  }
 }
 
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
-  {
-    std::scoped_lock scoped_db_io_latch(db_io_latch_);
-    db_io_.close();
+  for (tablespace_id_t tablespace_id = 1; tablespace_id < num_tablespaces_; ++tablespace_id) {
+    tablespaces_[tablespace_id]->ShutDown();
+  }
+  if (page_store_ != nullptr) {
+    page_store_->Close();
+  }
+  if (db_fd_ >= 0) {
+    FlushSpaceMap();
+    close(db_fd_);
+    db_fd_ = -1;
+  }
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+    log_fd_ = -1;
   }
-  log_io_.close();
+}
+
+/**
+ * Open the file of a new tablespace, with the settings of this one
+ */
+tablespace_id_t DiskManager::AddTablespace(const std::string &file_name, size_t page_size) {
+  std::scoped_lock lock{tablespaces_latch_};
+  tablespace_id_t tablespace_id = num_tablespaces_;
+  if (tablespace_id == MAX_TABLESPACES) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "too many tablespaces");
+  }
+  for (tablespace_id_t i = 0; i < tablespace_id; ++i) {
+    if ((i == DEFAULT_TABLESPACE_ID ? file_name_ : tablespaces_[i]->file_name_) == file_name) {
+      throw Exception(ExceptionType::INVALID, file_name + " is already a file of the database");
+    }
+  }
+  tablespaces_[tablespace_id] = std::unique_ptr<DiskManager>(
+      new DiskManager(file_name, direct_io_, page_store_ != nullptr, page_size == 0 ? page_size_ : page_size,
+                      FirstPageOf(tablespace_id)));
+  // publish the tablespace only once its disk manager is complete
+  num_tablespaces_ = tablespace_id + 1;
+  return tablespace_id;
+}
+
+DiskManager *DiskManager::GetTablespace(tablespace_id_t tablespace_id) const {
+  BUSTUB_ASSERT(tablespace_id > DEFAULT_TABLESPACE_ID && tablespace_id < num_tablespaces_, "no such tablespace");
+  return tablespaces_[tablespace_id].get();
 }
 
 /**
  * Write the contents of the specified page into disk file
+ * Positional write, so writers of different pages never wait for each other
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
+  if (page_id >= MAX_TABLESPACE_PAGES) {
+    GetTablespace(TablespaceOf(page_id))->WritePage(page_id - FirstPageOf(TablespaceOf(page_id)), page_data);
+    return;
+  }
+  // the page's allocation has to be on disk before its contents are
+  if (space_map_flushed_version_ < space_map_version_) {
+    FlushSpaceMap();
+  }
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
+  // Checksum a private copy: a page being flushed can still change under a reader's latch (the LSN, say), and the
+  // checksum has to match the bytes that actually reach the disk.
+  char *buf = BounceBuffer();
+  size_t usable_size = page_size_ - PAGE_CHECKSUM_SIZE;
+  memcpy(buf, page_data, usable_size);
+  uint32_t checksum = PageChecksum(first_page_id_ + page_id, buf, page_size_);
+  memcpy(buf + usable_size, &checksum, sizeof(checksum));
+  if (page_store_ != nullptr) {
+    page_store_->Write(page_id, buf);
     return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  WriteBlock(PageOffset(page_id), buf);
 }
 
 /**
  * Read the contents of the specified page into the given memory area
+ * Positional read, so readers of different pages never wait for each other
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
+  if (page_id >= MAX_TABLESPACE_PAGES) {
+    GetTablespace(TablespaceOf(page_id))->ReadPage(page_id - FirstPageOf(TablespaceOf(page_id)), page_data);
+    return;
+  }
+  if (page_store_ != nullptr) {
+    page_store_->ReadPages(page_id, &page_data, 1);
   } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
-      LOG_DEBUG("I/O error while reading");
+    ReadBlock(PageOffset(page_id), page_data, page_size_);
+  }
+  CheckPage(page_id, page_data);
+}
+
+uint32_t DiskManager::PageChecksum(page_id_t page_id, const char *page_data, size_t page_size) {
+  // the page id is part of the checksum, so a page written to the wrong place fails it too
+  return Crc32c::Extend(Crc32c::Value(page_data, page_size - PAGE_CHECKSUM_SIZE),
+                        reinterpret_cast<const char *>(&page_id), sizeof(page_id));
+}
+
+bool DiskManager::VerifyPage(page_id_t page_id, const char *page_data, size_t page_size) {
+  static_assert(PAGE_CHECKSUM_SIZE == sizeof(uint32_t));
+  size_t usable_size = page_size - PAGE_CHECKSUM_SIZE;
+  uint32_t checksum;
+  memcpy(&checksum, page_data + usable_size, sizeof(checksum));
+  if (checksum == PageChecksum(page_id, page_data, page_size)) {
+    return true;
+  }
+  // an allocated page that was never written, it lies in a hole or beyond the end of file
+  return checksum == 0 && std::all_of(page_data, page_data + usable_size, [](char c) { return c == 0; });
+}
+
+void DiskManager::CheckPage(page_id_t page_id, char *page_data) {
+  if (!VerifyPage(first_page_id_ + page_id, page_data, page_size_)) {
+    throw Exception(ExceptionType::IO, "page " + std::to_string(first_page_id_ + page_id) + " of " + file_name_ +
+                                           " does not match its checksum");
+  }
+  memset(page_data + page_size_ - PAGE_CHECKSUM_SIZE, 0, PAGE_CHECKSUM_SIZE);
+}
+
+/**
+ * Read consecutive pages with one preadv per stretch that lies between two map pages
+ * Falls back to page-by-page reads for buffers direct I/O cannot use, and for stretches that run past the end of file
+ * Compressed pages are read by the store, which merges the reads of records that are adjacent in its file
+ */
+void DiskManager::ReadPages(page_id_t first_page_id, char *const *page_data, size_t num_pages) {
+  if (num_pages == 0) {
+    return;
+  }
+  tablespace_id_t tablespace_id = TablespaceOf(first_page_id);
+  auto last_page_id = first_page_id + static_cast<page_id_t>(num_pages - 1);
+  if (TablespaceOf(last_page_id) != tablespace_id) {
+    // the pages of each tablespace are read from its own file
+    auto count = static_cast<size_t>(FirstPageOf(tablespace_id + 1) - first_page_id);
+    ReadPages(first_page_id, page_data, count);
+    ReadPages(first_page_id + static_cast<page_id_t>(count), page_data + count, num_pages - count);
+    return;
+  }
+  if (tablespace_id != DEFAULT_TABLESPACE_ID) {
+    GetTablespace(tablespace_id)->ReadPages(first_page_id - FirstPageOf(tablespace_id), page_data, num_pages);
+    return;
+  }
+  if (page_store_ != nullptr) {
+    page_store_->ReadPages(first_page_id, page_data, num_pages);
+    for (size_t i = 0; i < num_pages; ++i) {
+      CheckPage(first_page_id + static_cast<page_id_t>(i), page_data[i]);
+    }
+    return;
+  }
+  size_t done = 0;
+  while (done < num_pages) {
+    page_id_t page_id = first_page_id + static_cast<page_id_t>(done);
+    size_t count = std::min({num_pages - done, MAX_VECTORED_READ_PAGES,
+                             static_cast<size_t>(pages_per_map_page_ - page_id % pages_per_map_page_)});
+    iovec iov[MAX_VECTORED_READ_PAGES];
+    bool aligned = true;
+    for (size_t i = 0; i < count; ++i) {
+      iov[i].iov_base = page_data[done + i];
+      iov[i].iov_len = page_size_;
+      aligned = aligned && reinterpret_cast<uintptr_t>(page_data[done + i]) % PAGE_ALIGNMENT == 0;
+    }
+    ssize_t ret = -1;
+    if (count > 1 && (aligned || !direct_io_)) {
+      ret = preadv(db_fd_, iov, static_cast<int>(count), PageOffset(page_id));
+    }
+    if (ret != static_cast<ssize_t>(count * page_size_)) {
+      for (size_t i = 0; i < count; ++i) {
+        ReadPage(page_id + static_cast<page_id_t>(i), page_data[done + i]);
+      }
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        CheckPage(page_id + static_cast<page_id_t>(i), page_data[done + i]);
+      }
+    }
+    done += count;
+  }
+}
+
+bool DiskManager::ReadRun(const std::vector<DiskRequest *> &run) {
+  std::vector<char *> page_data;
+  page_data.reserve(run.size());
+  for (const DiskRequest *request : run) {
+    page_data.push_back(request->data_);
+  }
+  try {
+    ReadPages(run.front()->page_id_, page_data.data(), page_data.size());
+    return true;
+  } catch (const Exception &e) {
+    // corruption is rare, so find the culprits by simply reading the pages once more, one at a time
+  }
+  bool all_verified = true;
+  for (DiskRequest *request : run) {
+    try {
+      ReadPage(request->page_id_, request->data_);
+    } catch (const Exception &e) {
+      request->corrupt_ = true;
+      request->error_ = std::current_exception();
+      all_verified = false;
+    }
+  }
+  return all_verified;
+}
+
+/**
+ * Read each stretch of data pages between two map pages with large sequential reads, checking the allocated ones
+ */
+std::vector<page_id_t> DiskManager::VerifyFile() {
+  std::vector<page_id_t> corrupt;
+  for (tablespace_id_t tablespace_id = 1; tablespace_id < num_tablespaces_; ++tablespace_id) {
+    for (page_id_t page_id : tablespaces_[tablespace_id]->VerifyFile()) {
+      corrupt.push_back(FirstPageOf(tablespace_id) + page_id);
+    }
+  }
+  std::vector<char> buf_space(MAX_VECTORED_READ_PAGES * page_size_ + PAGE_ALIGNMENT);
+  char *buf = buf_space.data() + (PAGE_ALIGNMENT - reinterpret_cast<uintptr_t>(buf_space.data()) % PAGE_ALIGNMENT);
+  SpaceMapPage map_page;
+  size_t num_map_pages;
+  {
+    std::scoped_lock lock{space_map_latch_};
+    num_map_pages = space_map_.size();
+  }
+  for (size_t map_index = 0; map_index < num_map_pages; ++map_index) {
+    {
+      std::scoped_lock lock{space_map_latch_};
+      map_page = *space_map_[map_index];
+    }
+    auto is_allocated = [this, &map_page](page_id_t page_id) {
+      auto bit = static_cast<size_t>(page_id % pages_per_map_page_);
+      return (map_page[bit / 64] & (UINT64_C(1) << (bit % 64))) != 0;
+    };
+    // a stretch holds no page worth reading once the rest of its group is free
+    auto first_page_id = static_cast<page_id_t>(map_index) * pages_per_map_page_;
+    page_id_t end_page_id = first_page_id;
+    for (page_id_t page_id = first_page_id; page_id < first_page_id + pages_per_map_page_; ++page_id) {
+      if (is_allocated(page_id)) {
+        end_page_id = page_id + 1;
+      }
+    }
+    for (page_id_t page_id = first_page_id; page_id < end_page_id;) {
+      auto count = static_cast<size_t>(std::min<page_id_t>(end_page_id - page_id, MAX_VECTORED_READ_PAGES));
+      // a damaged record of a compressed page reads as zeros, which would pass
+      std::vector<page_id_t> damaged;
+      if (page_store_ != nullptr) {
+        char *page_data[MAX_VECTORED_READ_PAGES];
+        for (size_t i = 0; i < count; ++i) {
+          page_data[i] = buf + i * page_size_;
+        }
+        page_store_->ReadPages(page_id, page_data, count, &damaged);
+      } else {
+        ReadBlock(PageOffset(page_id), buf, count * page_size_);
+      }
+      for (size_t i = 0; i < count; ++i, ++page_id) {
+        bool is_damaged = std::find(damaged.begin(), damaged.end(), page_id) != damaged.end();
+        if (is_allocated(page_id) &&
+            (is_damaged || !VerifyPage(first_page_id_ + page_id, buf + i * page_size_, page_size_))) {
+          corrupt.push_back(page_id);
+        }
+      }
+    }
+  }
+  return corrupt;
+}
+
+void DiskManager::WriteBlock(off_t offset, const char *data) {
+  const char *buf = data;
+  if (direct_io_ && reinterpret_cast<uintptr_t>(data) % PAGE_ALIGNMENT != 0) {
+    // direct I/O can only transfer from aligned memory
+    buf = BounceBuffer();
+    memcpy(const_cast<char *>(buf), data, page_size_);
+  }
+  auto total = static_cast<ssize_t>(page_size_);
+  ssize_t done = 0;
+  while (done < total) {
+    ssize_t ret = pwrite(db_fd_, buf + done, total - done, offset + done);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw Exception(ExceptionType::IO, "I/O error while writing " + file_name_ + ": " + strerror(errno));
+    }
+    done += ret;
+  }
+}
+
+void DiskManager::ReadBlock(off_t offset, char *data, size_t size) {
+  char *buf = data;
+  if (direct_io_ && reinterpret_cast<uintptr_t>(data) % PAGE_ALIGNMENT != 0) {
+    // direct I/O can only transfer into aligned memory
+    BUSTUB_ASSERT(size <= page_size_, "only single pages are read through the bounce buffer");
+    buf = BounceBuffer();
+  }
+  auto total = static_cast<ssize_t>(size);
+  ssize_t done = 0;
+  while (done < total) {
+    ssize_t ret = pread(db_fd_, buf + done, total - done, offset + done);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw Exception(ExceptionType::IO, "I/O error while reading " + file_name_ + ": " + strerror(errno));
+    }
+    // if file ends before reading size bytes
+    if (ret == 0) {
+      if (done == 0) {
+        LOG_DEBUG("I/O error reading past end of file");
+      } else {
+        LOG_DEBUG("Read less than a page");
+      }
+      memset(buf + done, 0, total - done);
+      break;
+    }
+    done += ret;
+  }
+  if (buf != data) {
+    memcpy(data, buf, size);
+  }
+}
+
+/**
+ * File layout, with N data pages per map page: map page 0, data pages [0, N), map page 1, data pages [N, 2N), ...
+ */
+off_t DiskManager::PageOffset(page_id_t page_id) const {
+  return (static_cast<off_t>(page_id) + page_id / pages_per_map_page_ + 1) * static_cast<off_t>(page_size_);
+}
+
+off_t DiskManager::MapPageOffset(size_t map_index) const {
+  return static_cast<off_t>(map_index) * (pages_per_map_page_ + 1) * static_cast<off_t>(page_size_);
+}
+
+/**
+ * Rebuild the allocator state from the map pages in the database file
+ */
+void DiskManager::LoadSpaceMap() {
+  struct stat stat_buf;
+  if (fstat(db_fd_, &stat_buf) != 0) {
+    throw Exception("can't stat db file");
+  }
+  // every map page lies before the data pages it covers, so a file ending anywhere in a group holds its map page
+  auto num_map_pages = static_cast<size_t>((stat_buf.st_size + MapPageOffset(1) - 1) / MapPageOffset(1));
+  for (size_t i = 0; i < num_map_pages; ++i) {
+    auto map_page = std::make_unique<SpaceMapPage>(page_size_ / sizeof(uint64_t));
+    ReadBlock(MapPageOffset(i), reinterpret_cast<char *>(map_page->data()), page_size_);
+    for (uint64_t word : *map_page) {
+      num_allocated_ += __builtin_popcountll(word);
+    }
+    space_map_.push_back(std::move(map_page));
+    space_map_dirty_.push_back(false);
+  }
+}
+
+void DiskManager::CheckPageSize() {
+  const std::string error = file_name_ + " does not hold pages of " + std::to_string(page_size_) + " bytes from page " +
+                            std::to_string(first_page_id_) + " on";
+  const off_t file_size = GetFileSize(file_name_);
+  if (file_size % static_cast<off_t>(page_size_) != 0) {
+    throw Exception(ExceptionType::INVALID, error);
+  }
+  std::vector<char> page_data(page_size_);
+  // A page that was never written reads back as zeros, and so does a part of a map page read at a smaller page size,
+  // so only a page that is not all zeros tells anything. Returns false if the page tells nothing.
+  auto check = [&](page_id_t page_id) {
+    ReadBlock(PageOffset(page_id), page_data.data(), page_size_);
+    if (std::all_of(page_data.begin(), page_data.end(), [](char c) { return c == 0; })) {
+      return false;
+    }
+    if (!VerifyPage(first_page_id_ + page_id, page_data.data(), page_size_)) {
+      throw Exception(ExceptionType::INVALID, error);
+    }
+    return true;
+  };
+  // The first pages that were allocated are usually written, unless the page size is too small and they are read from
+  // within the map page. Only a few are looked at, the last page of the file is checked instead of scanning on. A file
+  // too short to hold a written page where the pages of a larger size would be cannot be told apart.
+  const int max_checked = 16;
+  int num_checked = 0;
+  for (size_t i = 0; i < space_map_.size() && num_checked < max_checked; ++i) {
+    const SpaceMapPage &map_page = *space_map_[i];
+    for (size_t w = 0; w < map_page.size() && num_checked < max_checked; ++w) {
+      for (uint64_t word = map_page[w]; word != 0 && num_checked < max_checked; word &= word - 1) {
+        num_checked++;
+        if (check(static_cast<page_id_t>(i * pages_per_map_page_ + w * 64 + __builtin_ctzll(word)))) {
+          return;
+        }
+      }
+    }
+  }
+  auto last = static_cast<page_id_t>(file_size / static_cast<off_t>(page_size_)) - 1;
+  if (last > 0 && last % (pages_per_map_page_ + 1) != 0) {
+    check(last - last / (pages_per_map_page_ + 1) - 1);
+  }
+}
+
+void DiskManager::FlushSpaceMap() {
+  std::scoped_lock flush_lock{space_map_flush_latch_};
+  std::vector<std::pair<size_t, SpaceMapPage>> dirty;
+  uint64_t version;
+  {
+    std::scoped_lock lock{space_map_latch_};
+    version = space_map_version_;
+    if (space_map_flushed_version_ >= version) {
       return;
     }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    for (size_t i = 0; i < space_map_.size(); ++i) {
+      if (space_map_dirty_[i]) {
+        dirty.emplace_back(i, *space_map_[i]);
+        space_map_dirty_[i] = false;
+        // reserved pages are written as free, an extent never spans two map pages
+        auto first_page_id = static_cast<page_id_t>(i) * pages_per_map_page_;
+        for (auto it = reserved_pages_.lower_bound(first_page_id);
+             it != reserved_pages_.end() && it->first < first_page_id + pages_per_map_page_; ++it) {
+          for (page_id_t page_id = it->first; page_id < it->second; ++page_id) {
+            auto bit = static_cast<size_t>(page_id - first_page_id);
+            dirty.back().second[bit / 64] &= ~(UINT64_C(1) << (bit % 64));
+          }
+        }
+      }
     }
   }
+  for (size_t i = 0; i < dirty.size(); ++i) {
+    try {
+      WriteBlock(MapPageOffset(dirty[i].first), reinterpret_cast<const char *>(dirty[i].second.data()));
+    } catch (const Exception &e) {
+      // the map pages that did not make it are still to be written
+      std::scoped_lock lock{space_map_latch_};
+      for (size_t j = i; j < dirty.size(); ++j) {
+        space_map_dirty_[dirty[j].first] = true;
+      }
+      throw;
+    }
+  }
+  space_map_flushed_version_ = version;
+}
+
+DiskManager::SpaceMapPage *DiskManager::GetMapPage(page_id_t page_id) {
+  auto map_index = static_cast<size_t>(page_id / pages_per_map_page_);
+  while (space_map_.size() <= map_index) {
+    space_map_.push_back(std::make_unique<SpaceMapPage>(page_size_ / sizeof(uint64_t)));
+    space_map_dirty_.push_back(true);
+  }
+  return space_map_[map_index].get();
+}
+
+bool DiskManager::Unreserve(page_id_t page_id) {
+  auto it = reserved_pages_.upper_bound(page_id);
+  if (it == reserved_pages_.begin() || (--it)->second <= page_id) {
+    return false;
+  }
+  auto [first_page_id, end_page_id] = *it;
+  reserved_pages_.erase(it);
+  if (first_page_id < page_id) {
+    reserved_pages_[first_page_id] = page_id;
+  }
+  if (page_id + 1 < end_page_id) {
+    reserved_pages_[page_id + 1] = end_page_id;
+  }
+  return true;
+}
+
+/**
+ * Allocate the lowest free page of a stripe
+ * Every stripe keeps a hint below which all of its pages are allocated, so a scan never passes a page twice
+ */
+page_id_t DiskManager::AllocatePage(uint32_t num_instances, uint32_t instance_index, tablespace_id_t tablespace_id) {
+  BUSTUB_ASSERT(instance_index < num_instances, "instance index out of range");
+  if (tablespace_id != DEFAULT_TABLESPACE_ID) {
+    // the stripes are of database-wide ids, which are offset by the tablespace's first page
+    const page_id_t first_page_id = FirstPageOf(tablespace_id);
+    uint32_t local_index = (instance_index + num_instances - first_page_id % num_instances) % num_instances;
+    return first_page_id + GetTablespace(tablespace_id)->AllocatePage(num_instances, local_index);
+  }
+  std::scoped_lock lock{space_map_latch_};
+  if (free_hint_stripes_ != num_instances) {
+    free_hint_stripes_ = num_instances;
+    free_hints_.resize(num_instances);
+    for (uint32_t i = 0; i < num_instances; ++i) {
+      free_hints_[i] = static_cast<page_id_t>(i);
+    }
+  }
+  page_id_t page_id = free_hints_[instance_index];
+  while (true) {
+    if (page_id >= MAX_TABLESPACE_PAGES) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, file_name_ + " is full");
+    }
+    auto bit = static_cast<size_t>(page_id % pages_per_map_page_);
+    uint64_t &word = (*GetMapPage(page_id))[bit / 64];
+    if ((word & (UINT64_C(1) << (bit % 64))) == 0) {
+      word |= UINT64_C(1) << (bit % 64);
+      break;
+    }
+    page_id += static_cast<page_id_t>(num_instances);
+  }
+  free_hints_[instance_index] = page_id + static_cast<page_id_t>(num_instances);
+  space_map_dirty_[page_id / pages_per_map_page_] = true;
+  num_allocated_++;
+  space_map_version_++;
+  return page_id;
+}
+
+/**
+ * Allocate the lowest aligned run of free pages
+ * Extents are aligned to their size, so one never spans two map pages and whole words can be tested at once. The scan
+ * starts past the full words at the front of the map, which no extent can start in.
+ */
+page_id_t DiskManager::AllocateExtent(uint32_t num_pages, tablespace_id_t tablespace_id) {
+  BUSTUB_ASSERT(num_pages > 0 && (num_pages & (num_pages - 1)) == 0 &&
+                    num_pages <= static_cast<uint32_t>(pages_per_map_page_),
+                "extent size must be a power of two no larger than a map page's reach");
+  if (tablespace_id != DEFAULT_TABLESPACE_ID) {
+    // a tablespace starts at a multiple of every extent size, so its extents stay aligned
+    return FirstPageOf(tablespace_id) + GetTablespace(tablespace_id)->AllocateExtent(num_pages);
+  }
+  std::scoped_lock lock{space_map_latch_};
+  // a mask of the extent's bits within a word, all of the word for extents of 64 pages or more
+  const uint64_t mask = num_pages >= 64 ? UINT64_MAX : (UINT64_C(1) << num_pages) - 1;
+  const size_t num_words = std::max<size_t>(1, num_pages / 64);
+  while (extent_hint_ < MAX_TABLESPACE_PAGES &&
+         (*GetMapPage(extent_hint_))[(extent_hint_ % pages_per_map_page_) / 64] == UINT64_MAX) {
+    extent_hint_ += 64;
+  }
+  page_id_t first_page_id = extent_hint_ / static_cast<page_id_t>(num_pages) * static_cast<page_id_t>(num_pages);
+  while (true) {
+    if (first_page_id >= MAX_TABLESPACE_PAGES) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, file_name_ + " is full");
+    }
+    auto bit = static_cast<size_t>(first_page_id % pages_per_map_page_);
+    uint64_t *words = GetMapPage(first_page_id)->data() + bit / 64;
+    bool free = true;
+    for (size_t i = 0; i < num_words && free; ++i) {
+      free = (words[i] & (mask << (bit % 64))) == 0;
+    }
+    if (free) {
+      for (size_t i = 0; i < num_words; ++i) {
+        words[i] |= mask << (bit % 64);
+      }
+      break;
+    }
+    first_page_id += static_cast<page_id_t>(num_pages);
+  }
+  reserved_pages_[first_page_id] = first_page_id + static_cast<page_id_t>(num_pages);
+  num_allocated_ += num_pages;
+  space_map_version_++;
+  return first_page_id;
+}
+
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  if (page_id >= MAX_TABLESPACE_PAGES) {
+    GetTablespace(TablespaceOf(page_id))->DeallocatePage(page_id - FirstPageOf(TablespaceOf(page_id)));
+    return;
+  }
+  std::scoped_lock lock{space_map_latch_};
+  auto map_index = static_cast<size_t>(page_id / pages_per_map_page_);
+  auto bit = static_cast<size_t>(page_id % pages_per_map_page_);
+  if (map_index >= space_map_.size()) {
+    return;
+  }
+  uint64_t &word = (*space_map_[map_index])[bit / 64];
+  if ((word & (UINT64_C(1) << (bit % 64))) == 0) {
+    return;
+  }
+  word &= ~(UINT64_C(1) << (bit % 64));
+  Unreserve(page_id);
+  if (free_hint_stripes_ != 0) {
+    page_id_t &hint = free_hints_[page_id % free_hint_stripes_];
+    hint = std::min(hint, page_id);
+  }
+  extent_hint_ = std::min(extent_hint_, page_id / 64 * 64);
+  space_map_dirty_[map_index] = true;
+  num_allocated_--;
+  space_map_version_++;
+  if (page_store_ != nullptr) {
+    page_store_->Discard(page_id);
+  }
+}
+
+void DiskManager::MarkAllocated(page_id_t page_id) {
+  if (page_id >= MAX_TABLESPACE_PAGES) {
+    GetTablespace(TablespaceOf(page_id))->MarkAllocated(page_id - FirstPageOf(TablespaceOf(page_id)));
+    return;
+  }
+  std::scoped_lock lock{space_map_latch_};
+  auto bit = static_cast<size_t>(page_id % pages_per_map_page_);
+  uint64_t &word = (*GetMapPage(page_id))[bit / 64];
+  if ((word & (UINT64_C(1) << (bit % 64))) != 0) {
+    if (Unreserve(page_id)) {
+      space_map_dirty_[page_id / pages_per_map_page_] = true;
+      space_map_version_++;
+    }
+    return;
+  }
+  // every page below the free hint of its stripe is allocated, so the hint lies at or below this one and stays
+  word |= UINT64_C(1) << (bit % 64);
+  space_map_dirty_[page_id / pages_per_map_page_] = true;
+  num_allocated_++;
+  space_map_version_++;
+}
+
+bool DiskManager::IsAllocated(page_id_t page_id) {
+  if (page_id >= MAX_TABLESPACE_PAGES) {
+    tablespace_id_t tablespace_id = TablespaceOf(page_id);
+    return tablespace_id < num_tablespaces_ &&
+           GetTablespace(tablespace_id)->IsAllocated(page_id - FirstPageOf(tablespace_id));
+  }
+  std::scoped_lock lock{space_map_latch_};
+  auto map_index = static_cast<size_t>(page_id / pages_per_map_page_);
+  auto bit = static_cast<size_t>(page_id % pages_per_map_page_);
+  return map_index < space_map_.size() && ((*space_map_[map_index])[bit / 64] & (UINT64_C(1) << (bit % 64))) != 0;
+}
+
+size_t DiskManager::GetNumAllocatedPages() {
+  size_t num_allocated = 0;
+  for (tablespace_id_t tablespace_id = 1; tablespace_id < num_tablespaces_; ++tablespace_id) {
+    num_allocated += tablespaces_[tablespace_id]->GetNumAllocatedPages();
+  }
+  std::scoped_lock lock{space_map_latch_};
+  return num_allocated + num_allocated_;
+}
+
+/**
+ * Per-thread scratch area for a page of any size, aligned for direct I/O
+ */
+char *DiskManager::BounceBuffer() {
+  struct AlignedPage {
+    alignas(PAGE_ALIGNMENT) char data_[MAX_PAGE_SIZE];
+  };
+  static thread_local AlignedPage bounce;
+  return bounce.data_;
+}
+
+/**
+ * Synchronous fallback for asynchronous reads: do the read now and hand back a ready future
+ */
+std::future<void> DiskManager::ReadPageAsync(page_id_t page_id, char *page_data) {
+  std::promise<void> done;
+  try {
+    ReadPage(page_id, page_data);
+    done.set_value();
+  } catch (const Exception &e) {
+    done.set_exception(std::current_exception());
+  }
+  return done.get_future();
+}
+
+/**
+ * Synchronous fallback for asynchronous writes: do the write now and hand back a ready future
+ */
+std::future<void> DiskManager::WritePageAsync(page_id_t page_id, const char *page_data) {
+  std::promise<void> done;
+  try {
+    WritePage(page_id, page_data);
+    done.set_value();
+  } catch (const Exception &e) {
+    done.set_exception(std::current_exception());
+  }
+  return done.get_future();
+}
+
+/**
+ * Synchronous fallback for batches: perform every request in submission order
+ */
+std::future<void> DiskManager::SubmitBatch(std::vector<DiskRequest> requests, DiskCallback on_complete) {
+  std::promise<void> done;
+  std::exception_ptr error;
+  for (size_t i = 0; i < requests.size();) {
+    if (requests[i].is_write_) {
+      try {
+        WritePage(requests[i].page_id_, requests[i].data_);
+      } catch (const Exception &e) {
+        requests[i].error_ = std::current_exception();
+        error = error != nullptr ? error : requests[i].error_;
+      }
+      if (on_complete) {
+        on_complete(requests[i]);
+      }
+      i++;
+      continue;
+    }
+    // reads of consecutive pages, such as those of an extent, are merged into one
+    std::vector<DiskRequest *> run{&requests[i]};
+    while (i + run.size() < requests.size() && !requests[i + run.size()].is_write_ &&
+           requests[i + run.size()].page_id_ == requests[i].page_id_ + static_cast<page_id_t>(run.size())) {
+      run.push_back(&requests[i + run.size()]);
+    }
+    ReadRun(run);
+    for (const DiskRequest *request : run) {
+      error = error != nullptr ? error : request->error_;
+      if (on_complete) {
+        on_complete(*request);
+      }
+    }
+    i += run.size();
+  }
+  if (error == nullptr) {
+    done.set_value();
+  } else {
+    done.set_exception(error);
+  }
+  return done.get_future();
 }
 
 /**
@@ -150,16 +856,36 @@ void DiskManager::WriteLog(char *log_data, int size) {
   }
 
   num_flushes_ += 1;
+  struct stat stat_buf;
+  off_t log_size = fstat(log_fd_, &stat_buf) == 0 ? stat_buf.st_size : -1;
+  ssize_t done = 0;
+  auto fail = [this, log_size, &done](const char *what) {
+    int error = errno;
+    // cut off whatever part made it, so that writing the same buffer again appends it where it belongs
+    if (done > 0 && log_size >= 0 && ftruncate(log_fd_, log_size) != 0) {
+      LOG_WARN("can't truncate %s after a failed write: %s", log_name_.c_str(), strerror(errno));
+    }
+    buffer_used = nullptr;
+    flush_log_ = false;
+    throw Exception(ExceptionType::IO,
+                    std::string("I/O error while ") + what + " " + log_name_ + ": " + strerror(error));
+  };
   // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+  while (done < size) {
+    ssize_t ret = write(log_fd_, log_data + done, size - done);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fail("writing");
+    }
+    done += ret;
+  }
+  // the log is only durable once it is on the device, not in the page cache; after a failed sync the page cache may
+  // no longer hold the data either, so all of it is written again
+  if (fdatasync(log_fd_) != 0) {
+    fail("syncing");
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
@@ -168,27 +894,76 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * Always read from the beginning and perform sequence read
  * @return: false means already reach the end
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
+bool DiskManager::ReadLog(char *log_data, int size, off_t offset) {
   if (offset >= GetFileSize(log_name_)) {
     // LOG_DEBUG("end of log file");
     // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  ssize_t done = 0;
+  while (done < size) {
+    ssize_t ret = pread(log_fd_, log_data + done, size - done, offset + done);
+    if (ret < 0) {
+      LOG_DEBUG("I/O error while reading log");
+      return false;
+    }
+    // if log file ends before reading "size"
+    if (ret == 0) {
+      memset(log_data + done, 0, size - done);
+      break;
+    }
+    done += ret;
+  }
 
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
-    return false;
+  return true;
+}
+
+/**
+ * Returns the size of the log file
+ */
+off_t DiskManager::GetLogSize() { return std::max<off_t>(GetFileSize(log_name_), 0); }
+
+void DiskManager::TruncateLog(off_t size) {
+  if (ftruncate(log_fd_, size) != 0 || fdatasync(log_fd_) != 0) {
+    throw Exception(ExceptionType::IO, "I/O error while truncating " + log_name_ + ": " + strerror(errno));
   }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+}
+
+/**
+ * Write the master record: the offset in the log recovery starts at, made durable before returning
+ */
+void DiskManager::WriteMasterRecord(off_t redo_offset) {
+  int fd = open(master_name_.c_str(), O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    throw Exception(ExceptionType::IO, "can't open master record file");
   }
+  // a single aligned write of a few bytes is never torn
+  auto offset = static_cast<int64_t>(redo_offset);
+  bool written = pwrite(fd, &offset, sizeof(offset), 0) == static_cast<ssize_t>(sizeof(offset)) && fdatasync(fd) == 0;
+  close(fd);
+  if (!written) {
+    throw Exception(ExceptionType::IO, "I/O error while writing the master record");
+  }
+}
 
-  return true;
+/**
+ * Read the master record back, falling back to the start of the log if it is missing or points beyond its end
+ */
+off_t DiskManager::ReadMasterRecord() {
+  int fd = open(master_name_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  int64_t offset = 0;
+  if (pread(fd, &offset, sizeof(offset), 0) != static_cast<ssize_t>(sizeof(offset))) {
+    offset = 0;
+  }
+  close(fd);
+  if (offset < 0 || offset > GetLogSize()) {
+    LOG_WARN("the master record does not match the log, recovering from the start of the log");
+    return 0;
+  }
+  return static_cast<off_t>(offset);
 }
 
 /**
@@ -197,9 +972,15 @@ bool DiskManager::ReadLog(char *log_data, int size, int offset) {
 int DiskManager::GetNumFlushes() const { return num_flushes_; }
 
 /**
- * Returns number of Writes made so far
+ * Returns number of Writes made so far, to the files of all tablespaces
  */
-int DiskManager::GetNumWrites() const { return num_writes_; }
+int DiskManager::GetNumWrites() const {
+  int num_writes = num_writes_;
+  for (tablespace_id_t tablespace_id = 1; tablespace_id < num_tablespaces_; ++tablespace_id) {
+    num_writes += tablespaces_[tablespace_id]->GetNumWrites();
+  }
+  return num_writes;
+}
 
 /**
  * Returns true if the log is currently being flushed
@@ -209,10 +990,10 @@ bool DiskManager::GetFlushState() const { return flush_log_; }
 /**
  * Private helper function to get disk file size
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
+off_t DiskManager::GetFileSize(const std::string &file_name) {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? static_cast<int>(stat_buf.st_size) : -1;
+  return rc == 0 ? stat_buf.st_size : -1;
 }
 
 }  // namespace bustub
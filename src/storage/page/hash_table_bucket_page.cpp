@@ -24,10 +24,10 @@
 
 namespace bustub {
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) {
   bool success{false};
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; ++i) {
+  for (size_t i = 0; i < ARRAY_SIZE; ++i) {
     if (!IsOccupied(i)) {
       break;
     }
@@ -39,10 +39,10 @@ bool HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vecto
   return success;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp) {
   std::optional<size_t> first_free{};
-  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; ++i) {
+  for (uint32_t i = 0; i < ARRAY_SIZE; ++i) {
     if (IsReadable(i)) {
       if (cmp(KeyAt(i), key) == 0 && value == ValueAt(i)) {
         return false;
@@ -67,9 +67,9 @@ bool HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator
   return false;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp) {
-  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; ++i) {
+  for (uint32_t i = 0; i < ARRAY_SIZE; ++i) {
     if (!IsOccupied(i)) {
       break;
     }
@@ -81,7 +81,7 @@ bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator
   return false;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 KeyType HASH_TABLE_BUCKET_TYPE::KeyAt(uint32_t bucket_idx) const {
   if (IsReadable(bucket_idx)) {
     return array_[bucket_idx].first;
@@ -89,7 +89,7 @@ KeyType HASH_TABLE_BUCKET_TYPE::KeyAt(uint32_t bucket_idx) const {
   return {};
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 ValueType HASH_TABLE_BUCKET_TYPE::ValueAt(uint32_t bucket_idx) const {
   if (IsReadable(bucket_idx)) {
     return array_[bucket_idx].second;
@@ -97,34 +97,34 @@ ValueType HASH_TABLE_BUCKET_TYPE::ValueAt(uint32_t bucket_idx) const {
   return {};
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 void HASH_TABLE_BUCKET_TYPE::RemoveAt(uint32_t bucket_idx) {
   readable_[bucket_idx / 8] &= ~(1U << (bucket_idx % 8));
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_BUCKET_TYPE::IsOccupied(uint32_t bucket_idx) const {
   return occupied_[bucket_idx / 8] & (1U << (bucket_idx % 8));
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 void HASH_TABLE_BUCKET_TYPE::SetOccupied(uint32_t bucket_idx) {
   occupied_[bucket_idx / 8] |= (1U << (bucket_idx % 8));
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_BUCKET_TYPE::IsReadable(uint32_t bucket_idx) const {
   return readable_[bucket_idx / 8] & (1U << (bucket_idx % 8));
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 void HASH_TABLE_BUCKET_TYPE::SetReadable(uint32_t bucket_idx) {
   readable_[bucket_idx / 8] |= (1U << (bucket_idx % 8));
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_BUCKET_TYPE::IsFull() {
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; ++i) {
+  for (size_t i = 0; i < ARRAY_SIZE; ++i) {
     if (!IsReadable(i)) {
       return false;
     }
@@ -132,14 +132,14 @@ bool HASH_TABLE_BUCKET_TYPE::IsFull() {
   return true;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 uint32_t HASH_TABLE_BUCKET_TYPE::NumReadable() {
   return 0;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 bool HASH_TABLE_BUCKET_TYPE::IsEmpty() {
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; ++i) {
+  for (size_t i = 0; i < ARRAY_SIZE; ++i) {
     if (!IsOccupied(i)) {
       break;
     }
@@ -150,12 +150,12 @@ bool HASH_TABLE_BUCKET_TYPE::IsEmpty() {
   return true;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator, int PageSize>
 void HASH_TABLE_BUCKET_TYPE::PrintBucket() {
   uint32_t size = 0;
   uint32_t taken = 0;
   uint32_t free = 0;
-  for (size_t bucket_idx = 0; bucket_idx < BUCKET_ARRAY_SIZE; bucket_idx++) {
+  for (size_t bucket_idx = 0; bucket_idx < ARRAY_SIZE; bucket_idx++) {
     if (!IsOccupied(bucket_idx)) {
       break;
     }
@@ -169,7 +169,7 @@ void HASH_TABLE_BUCKET_TYPE::PrintBucket() {
     }
   }
 
-  LOG_INFO("Bucket Capacity: %lu, Size: %u, Taken: %u, Free: %u", BUCKET_ARRAY_SIZE, size, taken, free);
+  LOG_INFO("Bucket Capacity: %lu, Size: %u, Taken: %u, Free: %u", ARRAY_SIZE, size, taken, free);
 }
 
 // DO NOT REMOVE ANYTHING BELOW THIS LINE
@@ -181,6 +181,10 @@ template class HashTableBucketPage<GenericKey<16>, RID, GenericComparator<16>>;
 template class HashTableBucketPage<GenericKey<32>, RID, GenericComparator<32>>;
 template class HashTableBucketPage<GenericKey<64>, RID, GenericComparator<64>>;
 
+// buckets of hash tables in files with large pages
+template class HashTableBucketPage<int, int, IntComparator, 16 * 1024>;
+template class HashTableBucketPage<GenericKey<8>, RID, GenericComparator<8>, 64 * 1024>;
+
 // template class HashTableBucketPage<hash_t, TmpTuple, HashComparator>;
 
 }  // namespace bustub
@@ -85,6 +85,26 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
   return true;
 }
 
+bool TablePage::InsertTupleAt(const Tuple &tuple, const RID &rid) {
+  BUSTUB_ASSERT(tuple.size_ > 0, "Cannot have empty tuples.");
+  uint32_t slot_num = rid.GetSlotNum();
+  BUSTUB_ASSERT(slot_num <= GetTupleCount(), "Cannot skip slots.");
+  bool new_slot = slot_num == GetTupleCount();
+  BUSTUB_ASSERT(new_slot || GetTupleSize(slot_num) == 0, "The slot has to be free.");
+  if (GetFreeSpaceRemaining() < tuple.size_ + (new_slot ? SIZE_TUPLE : 0)) {
+    return false;
+  }
+
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
+  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+  SetTupleOffsetAtSlot(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple.size_);
+  if (new_slot) {
+    SetTupleCount(GetTupleCount() + 1);
+  }
+  return true;
+}
+
 bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager) {
   uint32_t slot_num = rid.GetSlotNum();
   // If the slot number is invalid, abort the transaction.
@@ -209,17 +229,14 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
   }
   // Otherwise we are rolling back an insert.
 
-  // We need to copy out the deleted tuple for undo purposes.
-  Tuple delete_tuple;
-  delete_tuple.size_ = tuple_size;
-  delete_tuple.data_ = new char[delete_tuple.size_];
-  memcpy(delete_tuple.data_, GetData() + tuple_offset, delete_tuple.size_);
-  delete_tuple.rid_ = rid;
-  delete_tuple.allocated_ = true;
-
   if (enable_logging) {
     BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own the exclusive lock!");
 
+    // Log the deleted tuple for undo purposes, straight from the page: the record is appended before it is removed.
+    Tuple delete_tuple;
+    delete_tuple.size_ = tuple_size;
+    delete_tuple.data_ = GetData() + tuple_offset;
+    delete_tuple.rid_ = rid;
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE, rid, delete_tuple);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
     SetLSN(lsn);
@@ -10,15 +10,17 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
 
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, size_t page_index)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn), page_index_(page_index) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
+    ReadAhead();
     table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
   }
 }
@@ -35,19 +37,23 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
+  ReadPageGuard cur_guard = buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId());
+  assert(cur_guard);  // all pages are pinned
+  auto cur_page = static_cast<TablePage *>(cur_guard.GetPage());
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  &next_tuple_rid)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      BasicPageGuard next_pin = buffer_pool_manager->FetchPageBasic(cur_page->GetNextPageId());
+      cur_guard.Drop();
+      cur_guard = next_pin.UpgradeRead();
+      cur_page = static_cast<TablePage *>(cur_guard.GetPage());
+      if (page_index_ != UNKNOWN_PAGE_INDEX) {
+        page_index_++;
+        table_heap_->RecordNextPage(cur_page->GetTablePageId(), cur_page->GetNextPageId());
+        ReadAhead();
+      }
       if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
         break;
       }
@@ -59,11 +65,20 @@ TableIterator &TableIterator::operator++() {
     table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
   }
   // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
   return *this;
 }
 
+void TableIterator::ReadAhead() {
+  if (page_index_ == UNKNOWN_PAGE_INDEX) {
+    return;
+  }
+  size_t window = std::min<size_t>(scan_read_ahead_pages, table_heap_->buffer_pool_manager_->GetPoolSize() / 4);
+  size_t begin = std::max(read_ahead_end_, page_index_ + 1);
+  if (begin < page_index_ + 1 + window) {
+    read_ahead_end_ = table_heap_->ReadAhead(begin, page_index_ + 1 + window);
+  }
+}
+
 TableIterator TableIterator::operator++(int) {
   TableIterator clone(*this);
   ++(*this);
@@ -11,14 +11,79 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <fstream>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
+#include "common/logger.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
 
+/** A disk manager whose reads take a fixed amount of time, to make cache misses expensive. */
+class SlowDiskManager : public DiskManager {
+ public:
+  SlowDiskManager(const std::string &db_file, std::chrono::milliseconds read_latency)
+      : DiskManager(db_file), read_latency_(read_latency) {}
+
+  void ReadPage(page_id_t page_id, char *page_data) override {
+    std::this_thread::sleep_for(read_latency_);
+    DiskManager::ReadPage(page_id, page_data);
+  }
+
+ private:
+  std::chrono::milliseconds read_latency_;
+};
+
+// A DiskManager that counts the reads of the first num_counted pages.
+class CountingDiskManager : public DiskManager {
+ public:
+  CountingDiskManager(const std::string &db_file, page_id_t num_counted)
+      : DiskManager(db_file), num_counted_(num_counted) {}
+
+  void ReadPage(page_id_t page_id, char *page_data) override {
+    num_reads_ += page_id < num_counted_ ? 1 : 0;
+    DiskManager::ReadPage(page_id, page_data);
+  }
+
+  size_t GetNumReads() const { return num_reads_; }
+
+ private:
+  page_id_t num_counted_;
+  std::atomic<size_t> num_reads_{0};
+};
+
+// A DiskManager that checks that every page it writes was filled with a single byte value.
+class TornWriteDiskManager : public DiskManager {
+ public:
+  explicit TornWriteDiskManager(const std::string &db_file) : DiskManager(db_file) {}
+
+  void WritePage(page_id_t page_id, const char *page_data) override {
+    char copy[FILL_SIZE];
+    memcpy(copy, page_data, FILL_SIZE);
+    if (std::any_of(copy, copy + FILL_SIZE, [&copy](char c) { return c != copy[0]; })) {
+      num_torn_++;
+    }
+    DiskManager::WritePage(page_id, page_data);
+  }
+
+  size_t GetNumTorn() const { return num_torn_; }
+
+  /** Bytes at the start of a page that writers fill. */
+  static constexpr size_t FILL_SIZE = 1024;
+
+ private:
+  std::atomic<size_t> num_torn_{0};
+};
+
 // NOLINTNEXTLINE
 // Check whether pages containing terminal characters can be recovered
 TEST(BufferPoolManagerInstanceTest, BinaryDataTest) {
@@ -39,7 +104,8 @@ TEST(BufferPoolManagerInstanceTest, BinaryDataTest) {
   ASSERT_NE(nullptr, page0);
   EXPECT_EQ(0, page_id_temp);
 
-  char random_binary_data[PAGE_SIZE];
+  // the rest of the page holds its checksum on disk
+  char random_binary_data[PAGE_USABLE_SIZE];
   // Generate random binary data
   for (char &i : random_binary_data) {
     i = uniform_dist(rng);
@@ -47,11 +113,11 @@ TEST(BufferPoolManagerInstanceTest, BinaryDataTest) {
 
   // Insert terminal characters both in the middle and at end
   random_binary_data[PAGE_SIZE / 2] = '\0';
-  random_binary_data[PAGE_SIZE - 1] = '\0';
+  random_binary_data[PAGE_USABLE_SIZE - 1] = '\0';
 
   // Scenario: Once we have a page, we should be able to read and write content.
-  std::memcpy(page0->GetData(), random_binary_data, PAGE_SIZE);
-  EXPECT_EQ(0, std::memcmp(page0->GetData(), random_binary_data, PAGE_SIZE));
+  std::memcpy(page0->GetData(), random_binary_data, PAGE_USABLE_SIZE);
+  EXPECT_EQ(0, std::memcmp(page0->GetData(), random_binary_data, PAGE_USABLE_SIZE));
 
   // Scenario: We should be able to create new pages until we fill up the buffer pool.
   for (size_t i = 1; i < buffer_pool_size; ++i) {
@@ -74,7 +140,7 @@ TEST(BufferPoolManagerInstanceTest, BinaryDataTest) {
   }
   // Scenario: We should be able to fetch the data we wrote a while ago.
   page0 = bpm->FetchPage(0);
-  EXPECT_EQ(0, memcmp(page0->GetData(), random_binary_data, PAGE_SIZE));
+  EXPECT_EQ(0, memcmp(page0->GetData(), random_binary_data, PAGE_USABLE_SIZE));
   EXPECT_EQ(true, bpm->UnpinPage(0, true));
 
   // Shutdown the disk manager and remove the temporary file we created.
@@ -141,4 +207,725 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DirectIoTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+
+  auto *disk_manager = new DiskManager(db_name, true);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: every frame is aligned for direct I/O.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(bpm->GetPages()[i].GetData()) % PAGE_ALIGNMENT);
+  }
+
+  // Scenario: pages survive a round trip through the disk when the pool is cycled.
+  page_id_t page_id_temp;
+  for (int i = 0; i < 3 * static_cast<int>(buffer_pool_size); ++i) {
+    Page *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  for (int i = 0; i < 3 * static_cast<int>(buffer_pool_size); ++i) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentMissTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const int num_resident = 5;
+  const int num_missers = 4;
+  const auto window = std::chrono::milliseconds(200);
+
+  auto *disk_manager = new SlowDiskManager(db_name, std::chrono::milliseconds(20));
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Keep a few pages resident (and pinned) so the hit path always finds them.
+  page_id_t page_id_temp;
+  for (int i = 0; i < num_resident; ++i) {
+    Page *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+  }
+
+  // Count the FetchPage/UnpinPage pairs a single thread can do on resident pages within the window.
+  auto run_hits = [&]() {
+    size_t hits = 0;
+    auto deadline = std::chrono::steady_clock::now() + window;
+    while (std::chrono::steady_clock::now() < deadline) {
+      page_id_t page_id = static_cast<page_id_t>(hits % num_resident);
+      Page *page = bpm->FetchPage(page_id);
+      EXPECT_NE(nullptr, page);
+      EXPECT_EQ(page_id, page->GetPageId());
+      bpm->UnpinPage(page_id, false);
+      ++hits;
+    }
+    return hits;
+  };
+
+  size_t idle_hits = run_hits();
+
+  // Now do the same while other threads keep missing on pages that are not resident.
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> misses{0};
+  std::vector<std::thread> missers;
+  for (int t = 0; t < num_missers; ++t) {
+    missers.emplace_back([&, t] {
+      page_id_t page_id = 100 + t;
+      while (!stop) {
+        Page *page = bpm->FetchPage(page_id);
+        if (page != nullptr) {
+          bpm->UnpinPage(page_id, false);
+          ++misses;
+        }
+        page_id += num_missers;
+      }
+    });
+  }
+  size_t busy_hits = run_hits();
+  stop = true;
+  for (auto &thread : missers) {
+    thread.join();
+  }
+
+  LOG_INFO("hits without misses: %zu, hits with %d missers: %zu (%zu misses)", idle_hits, num_missers, busy_hits,
+           misses.load());
+  // A hit never waits for somebody else's read, so it gets far more than one turn per outstanding miss.
+  EXPECT_GT(misses.load(), 0);
+  EXPECT_GT(busy_hits, misses.load() * 10);
+
+  for (int i = 0; i < num_resident; ++i) {
+    Page *page = bpm->FetchPage(i);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    bpm->UnpinPage(i, false);
+    EXPECT_TRUE(bpm->UnpinPage(i, true));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PageCleanerTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  bpm->RunPageCleaner(0.5, 0.0);
+
+  // Scenario: dirty the whole pool, the cleaner should write it out in the background.
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    Page *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  for (int i = 0; i < 100 && bpm->GetBackgroundWrites() < buffer_pool_size; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(buffer_pool_size, bpm->GetBackgroundWrites());
+
+  // Scenario: now that every frame is clean, replacing them needs no foreground writes.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, false));
+  }
+  EXPECT_EQ(0, bpm->GetForegroundWrites());
+
+  // Scenario: the pages that were cleaned and evicted read back intact.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %zu", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+  }
+
+  bpm->StopPageCleaner();
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentPageCleanerTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const int num_pages = 30;
+  const int num_threads = 4;
+  const int num_rounds = 2000;
+
+  auto saved_interval = page_cleaner_interval;
+  page_cleaner_interval = std::chrono::milliseconds(1);
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  bpm->RunPageCleaner(0.1, 0.0);
+
+  page_id_t page_id_temp;
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Every thread keeps fetching, checking and re-dirtying pages while the cleaner races with evictions.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      std::default_random_engine rng(t);
+      std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+      for (int i = 0; i < num_rounds; ++i) {
+        page_id_t page_id = dist(rng);
+        Page *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        char expected[PAGE_SIZE];
+        snprintf(expected, PAGE_SIZE, "page %d", page_id);
+        page->RLatch();
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        page->RUnlatch();
+        bpm->UnpinPage(page_id, true);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  bpm->StopPageCleaner();
+  page_cleaner_interval = saved_interval;
+  LOG_INFO("foreground writes: %zu, background writes: %zu", bpm->GetForegroundWrites(), bpm->GetBackgroundWrites());
+
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PageCleanerLatchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const int num_threads = 4;
+  const int num_rounds = 2000;
+
+  auto saved_interval = page_cleaner_interval;
+  page_cleaner_interval = std::chrono::milliseconds(1);
+  auto *disk_manager = new TornWriteDiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  bpm->RunPageCleaner(0.1, 0.0);
+
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Writers refill resident pages byte by byte under the write latch, while the cleaner writes them out.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      std::default_random_engine rng(t);
+      std::uniform_int_distribution<page_id_t> dist(0, buffer_pool_size - 1);
+      for (int i = 0; i < num_rounds; ++i) {
+        page_id_t page_id = dist(rng);
+        Page *page = bpm->FetchPage(page_id);
+        ASSERT_NE(nullptr, page);
+        page->WLatch();
+        volatile char *data = page->GetData();
+        for (size_t j = 0; j < TornWriteDiskManager::FILL_SIZE; ++j) {
+          data[j] = static_cast<char>(i);
+        }
+        page->WUnlatch();
+        EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  bpm->StopPageCleaner();
+  page_cleaner_interval = saved_interval;
+
+  // the cleaner never writes a page that is half refilled
+  EXPECT_LT(0, bpm->GetBackgroundWrites());
+  EXPECT_EQ(0, disk_manager->GetNumTorn());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FlushLatchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const int num_threads = 4;
+  const int num_rounds = 2000;
+
+  auto *disk_manager = new TornWriteDiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Writers refill pinned pages under the write latch, while they are flushed one by one and all at once.
+  std::atomic<bool> done{false};
+  std::thread flusher([&] {
+    for (int i = 0; !done; ++i) {
+      if (i % 2 == 0) {
+        bpm->FlushAllPages();
+      } else {
+        bpm->FlushPage(i / 2 % buffer_pool_size);
+      }
+    }
+  });
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      std::default_random_engine rng(t);
+      std::uniform_int_distribution<page_id_t> dist(0, buffer_pool_size - 1);
+      for (int i = 0; i < num_rounds; ++i) {
+        page_id_t page_id = dist(rng);
+        Page *page = bpm->FetchPage(page_id);
+        ASSERT_NE(nullptr, page);
+        page->WLatch();
+        volatile char *data = page->GetData();
+        for (size_t j = 0; j < TornWriteDiskManager::FILL_SIZE; ++j) {
+          data[j] = static_cast<char>(i);
+        }
+        page->WUnlatch();
+        EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  done = true;
+  flusher.join();
+
+  // no flush wrote a page that was half refilled, and every page on disk matches its checksum
+  EXPECT_LT(0, disk_manager->GetNumWrites());
+  EXPECT_EQ(0, disk_manager->GetNumTorn());
+  bpm->FlushAllPages();
+  char data[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); ++page_id) {
+    EXPECT_NO_THROW(disk_manager->ReadPage(page_id, data));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Write out twice as many pages as fit in the pool.
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size * 2; ++i) {
+    Page *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  bpm->FlushAllPages();
+
+  // Pages 10..19 are resident, 0..4 are not; page 5 is pinned so its frame cannot be reused.
+  Page *pinned = bpm->FetchPage(5);
+  ASSERT_NE(nullptr, pinned);
+  bpm->PrefetchPages({0, 1, 2, 3, 4, 18, 19});
+  EXPECT_EQ(5, bpm->GetPrefetchedPages());
+
+  // Prefetched pages are resident and unpinned once their reads complete.
+  for (page_id_t page_id = 0; page_id < 5; ++page_id) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(1, page->GetPinCount());
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(5, bpm->GetPrefetchedPages());
+
+  // A prefetch never writes: with only dirty victims left it is skipped.
+  for (page_id_t page_id = 0; page_id < 5; ++page_id) {
+    Page *page = bpm->FetchPage(page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page->GetPageId(), true));
+  }
+  for (page_id_t page_id = 16; page_id < 20; ++page_id) {
+    Page *page = bpm->FetchPage(page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page->GetPageId(), true));
+  }
+  size_t writes = disk_manager->GetNumWrites();
+  bpm->PrefetchPages({6, 7});
+  EXPECT_EQ(5, bpm->GetPrefetchedPages());
+  EXPECT_EQ(writes, disk_manager->GetNumWrites());
+  EXPECT_TRUE(bpm->UnpinPage(5, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ReplacerHitRatioTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 64;
+  const int num_hot_pages = 24;
+  const int num_scan_pages = 512;
+  const int num_scans = 3;
+  const int fetches_per_scan_page = 4;
+  const int scan_pages_per_lookup = 2;
+
+  // Point lookups go to a small set of hot pages, like index inner pages, while a big scan runs through the pool.
+  auto run = [&](ReplacerType replacer_type) {
+    auto *disk_manager = new CountingDiskManager(db_name, num_hot_pages);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, replacer_type);
+    page_id_t page_id_temp;
+    for (int i = 0; i < num_hot_pages + num_scan_pages; ++i) {
+      EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+      bpm->UnpinPage(page_id_temp, true);
+    }
+
+    std::default_random_engine rng(0);
+    std::uniform_int_distribution<page_id_t> hot_page(0, num_hot_pages - 1);
+    size_t lookups = 0;
+    size_t reads_before = disk_manager->GetNumReads();
+    for (int scan = 0; scan < num_scans; ++scan) {
+      for (page_id_t page_id = num_hot_pages; page_id < num_hot_pages + num_scan_pages; ++page_id) {
+        // a scan fetches its page once per tuple
+        for (int i = 0; i < fetches_per_scan_page; ++i) {
+          EXPECT_NE(nullptr, bpm->FetchPage(page_id));
+          bpm->UnpinPage(page_id, false);
+        }
+        if (page_id % scan_pages_per_lookup == 0) {
+          page_id_t lookup_page_id = hot_page(rng);
+          EXPECT_NE(nullptr, bpm->FetchPage(lookup_page_id));
+          bpm->UnpinPage(lookup_page_id, false);
+          ++lookups;
+        }
+      }
+    }
+    double hit_ratio = 1.0 - static_cast<double>(disk_manager->GetNumReads() - reads_before) / lookups;
+
+    disk_manager->ShutDown();
+    remove("test.db");
+    delete bpm;
+    delete disk_manager;
+    return hit_ratio;
+  };
+
+  double lru = run(ReplacerType::LRU);
+  double lru_k = run(ReplacerType::LRU_K);
+  double two_q = run(ReplacerType::TWO_Q);
+  double clock = run(ReplacerType::CLOCK);
+  LOG_INFO("point lookup hit ratio during scans: LRU %.3f, LRU-K %.3f, 2Q %.3f, CLOCK %.3f", lru, lru_k, two_q, clock);
+  EXPECT_GT(lru_k, lru);
+  EXPECT_GT(two_q, lru);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentFetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const int num_pages = 40;
+  const int num_threads = 8;
+  const int rounds = 5000;
+
+  for (auto replacer_type : {ReplacerType::LRU, ReplacerType::LRU_K, ReplacerType::TWO_Q, ReplacerType::CLOCK}) {
+    auto *disk_manager = new DiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, replacer_type);
+    page_id_t page_id_temp;
+    for (int i = 0; i < num_pages; ++i) {
+      Page *page = bpm->NewPage(&page_id_temp);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+      bpm->UnpinPage(page_id_temp, true);
+    }
+
+    // Hits race with evictions  : every fetched frame must hold the page that was asked for.
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t] {
+        std::default_random_engine rng(t);
+        // most fetches go to a few hot pages, the rest keep the pool turning over
+        std::uniform_int_distribution<page_id_t> hot_page(0, 7);
+        std::uniform_int_distribution<page_id_t> any_page(0, num_pages - 1);
+        char expected[PAGE_SIZE];
+        for (int i = 0; i < rounds; ++i) {
+          page_id_t page_id = i % 4 == 0 ? any_page(rng) : hot_page(rng);
+          Page *page = bpm->FetchPage(page_id);
+          if (page == nullptr) {
+            continue;
+          }
+          EXPECT_EQ(page_id, page->GetPageId());
+          snprintf(expected, PAGE_SIZE, "page %d", page_id);
+          EXPECT_EQ(0, strcmp(page->GetData(), expected));
+          EXPECT_TRUE(bpm->UnpinPage(page_id, i % 16 == 0));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    // the replacer agrees with the pin counts: nothing is pinned, so every frame can be evicted
+    EXPECT_EQ(buffer_pool_size, bpm->GetStats().replacer_size_);
+
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      Page *page = bpm->FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(1, page->GetPinCount());
+      EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+      EXPECT_FALSE(bpm->UnpinPage(page_id, false));
+    }
+
+    disk_manager->ShutDown();
+    remove("test.db");
+
+    delete bpm;
+    delete disk_manager;
+  }
+}
+
+// Read-only FetchPage/UnpinPage throughput on a resident working set.
+// FetchPage and UnpinPage against a pool holding most of a skewed working set, about a tenth of the fetches missing.
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FetchBenchmarkTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 1024;
+  const auto num_pages = static_cast<page_id_t>(buffer_pool_size * 4);
+  const int num_fetches = 1 << 20;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  page_id_t page_id_temp;
+  for (page_id_t i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    bpm->UnpinPage(page_id_temp, true);
+  }
+  bpm->FlushAllPages();
+
+  std::default_random_engine rng(0);
+  std::uniform_int_distribution<page_id_t> hot(0, buffer_pool_size * 3 / 4);
+  std::uniform_int_distribution<page_id_t> cold(0, num_pages - 1);
+  std::vector<page_id_t> fetches(num_fetches);
+  for (auto &page_id : fetches) {
+    page_id = rng() % 10 == 0 ? cold(rng) : hot(rng);
+  }
+
+  auto before = bpm->GetStats();
+  auto start = std::chrono::steady_clock::now();
+  for (page_id_t page_id : fetches) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    bpm->UnpinPage(page_id, false);
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  auto after = bpm->GetStats();
+  uint64_t misses = after.misses_ - before.misses_;
+  EXPECT_EQ(static_cast<uint64_t>(num_fetches), after.hits_ - before.hits_ + misses);
+  LOG_INFO("%d fetches, %lu misses: %.1f ns per fetch and unpin", num_fetches,
+           static_cast<unsigned long>(misses), elapsed * 1e9 / num_fetches);  // NOLINT
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, HitScalingBenchmarkTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 64;
+  const size_t total_fetches = 1 << 18;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, ReplacerType::CLOCK);
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    bpm->UnpinPage(page_id_temp, false);
+  }
+
+  for (size_t num_threads = 1; num_threads <= 64; num_threads *= 4) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t] {
+        for (size_t i = t; i < total_fetches; i += num_threads) {
+          auto page_id = static_cast<page_id_t>(i % buffer_pool_size);
+          EXPECT_NE(nullptr, bpm->FetchPage(page_id));
+          bpm->UnpinPage(page_id, false);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("%2zu threads: %6.2f M fetch/unpin per second", num_threads, total_fetches / elapsed / 1e6);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// Creating and deleting pages for a long time has to reuse the deleted pages instead of growing the file.
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PageReuseTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const size_t num_live_pages = 64;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  std::default_random_engine rng(0);
+  std::vector<page_id_t> live_pages;
+  page_id_t page_id;
+
+  for (int i = 0; i < 5000; ++i) {
+    if (live_pages.size() == num_live_pages) {
+      // delete a random page, some of them are resident and some only on disk
+      size_t victim = rng() % live_pages.size();
+      ASSERT_TRUE(bpm->DeletePage(live_pages[victim]));
+      live_pages[victim] = live_pages.back();
+      live_pages.pop_back();
+    }
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+    live_pages.push_back(page_id);
+  }
+  bpm->FlushAllPages();
+
+  // pages ids, and with them the file, stay within the live set
+  for (page_id_t live_page : live_pages) {
+    EXPECT_LT(live_page, static_cast<page_id_t>(num_live_pages));
+    Page *page = bpm->FetchPage(live_page);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(live_page), std::string(page->GetData()));
+    bpm->UnpinPage(live_page, false);
+  }
+  EXPECT_EQ(num_live_pages, disk_manager->GetNumAllocatedPages());
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat(db_name.c_str(), &stat_buf));
+  EXPECT_LE(stat_buf.st_size, static_cast<off_t>((num_live_pages + 1) * PAGE_SIZE));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// A page that fails its checksum is reported to whoever fetches it, and costs the pool no frame.
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ChecksumTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const int num_pages = 8;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+
+  // pages 0 to 3 are only on disk; the pages of the first map page follow it in the file
+  std::fstream file(db_name, std::ios::binary | std::ios::in | std::ios::out);
+  file.seekp(static_cast<std::streamoff>(1 + 1) * PAGE_SIZE + 100);
+  file.write("torn", 4);
+  file.close();
+
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    EXPECT_THROW(bpm->FetchPage(1), Exception);
+  }
+  bpm->PrefetchPages({0, 1, 2});
+  EXPECT_THROW(bpm->FetchPage(1), Exception);
+  // every frame is still usable
+  for (page_id_t fetched : {0, 2, 3, 4}) {
+    Page *page = bpm->FetchPage(fetched);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(fetched), std::string(page->GetData()));
+  }
+  for (page_id_t fetched : {0, 2, 3, 4}) {
+    ASSERT_TRUE(bpm->UnpinPage(fetched, false));
+  }
+
+  // writing the page again repairs it
+  char data[PAGE_SIZE] = "page 1";
+  disk_manager->WritePage(1, data);
+  Page *page = bpm->FetchPage(1);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ("page 1", std::string(page->GetData()));
+  ASSERT_TRUE(bpm->UnpinPage(1, false));
+  bpm->FlushAllPages();
+  EXPECT_TRUE(disk_manager->VerifyFile().empty());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
 }  // namespace bustub
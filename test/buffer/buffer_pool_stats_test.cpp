@@ -0,0 +1,175 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats_test.cpp
+//
+// Identification: test/buffer/buffer_pool_stats_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_stats.h"
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "common/logger.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(BufferPoolStatsTest, HistogramTest) {
+  Histogram histogram;
+  EXPECT_EQ(0, histogram.Snapshot().Count());
+  EXPECT_EQ(0, histogram.Snapshot().Percentile(0.5));
+
+  for (uint64_t value = 1; value <= 1000; ++value) {
+    histogram.Record(value);
+  }
+  histogram.Record(0);
+  HistogramSnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ(1001, snapshot.Count());
+  EXPECT_EQ(500500, snapshot.sum_);
+  EXPECT_EQ(1, snapshot.buckets_[0]);
+  EXPECT_EQ(1, snapshot.buckets_[1]);     // 1
+  EXPECT_EQ(2, snapshot.buckets_[2]);     // 2, 3
+  EXPECT_EQ(489, snapshot.buckets_[10]);  // 512 to 1000
+  EXPECT_EQ(511, snapshot.Percentile(0.5));
+  EXPECT_EQ(1023, snapshot.Percentile(0.99));
+  EXPECT_NEAR(500, snapshot.Mean(), 1);
+
+  // values beyond the last bucket are not lost
+  histogram.Record(UINT64_MAX / 2);
+  EXPECT_EQ(1, histogram.Snapshot().buckets_[HistogramSnapshot::NUM_BUCKETS - 1]);
+
+  HistogramSnapshot sum = snapshot;
+  sum += snapshot;
+  EXPECT_EQ(2002, sum.Count());
+  EXPECT_EQ(snapshot.Percentile(0.5), sum.Percentile(0.5));
+}
+
+// Counts from many threads add up, and sharding keeps them off each other's cache lines.
+// NOLINTNEXTLINE
+TEST(BufferPoolStatsTest, ShardedCounterBenchmarkTest) {
+  const int num_threads = 8;
+  const int num_adds = 1000000;
+
+  auto time = [&](auto add) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < num_adds; ++i) {
+          add();
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    return static_cast<double>(NanosSince(start)) / (num_threads * num_adds);
+  };
+
+  ShardedCounter sharded;
+  std::atomic<uint64_t> shared{0};
+  double sharded_ns = time([&] { sharded.Add(); });
+  double shared_ns = time([&] { shared.fetch_add(1, std::memory_order_relaxed); });
+  EXPECT_EQ(num_threads * num_adds, sharded.Load());
+  EXPECT_EQ(num_threads * num_adds, shared.load());
+  LOG_INFO("%d threads: %.2f ns per add sharded, %.2f ns per add on one atomic", num_threads, sharded_ns, shared_ns);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolStatsTest, BufferPoolManagerInstanceTest) {
+  const size_t buffer_pool_size = 4;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id;
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  // pages 4 to 7 are resident, pages 0 to 3 were evicted dirty
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(0, stats.hits_);
+  EXPECT_EQ(0, stats.misses_);
+  EXPECT_EQ(4, stats.evictions_);
+  EXPECT_EQ(4, stats.dirty_evictions_);
+  EXPECT_EQ(4, stats.write_ns_.Count());
+  EXPECT_EQ(4, stats.resident_pages_);
+  EXPECT_EQ(4, stats.replacer_size_);
+  EXPECT_EQ(0, stats.free_frames_);
+
+  for (page_id_t hit : {4, 5, 6}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(hit));
+  }
+  ASSERT_NE(nullptr, bpm->FetchPage(0));
+  stats = bpm->GetStats();
+  EXPECT_EQ(3, stats.hits_);
+  EXPECT_EQ(1, stats.misses_);
+  EXPECT_EQ(1, stats.read_ns_.Count());
+  EXPECT_EQ(5, stats.evictions_);
+  EXPECT_EQ(5, stats.dirty_evictions_);
+  EXPECT_EQ(0, stats.replacer_size_);
+  EXPECT_DOUBLE_EQ(0.75, stats.HitRatio());
+  // the latch was taken by every new page and by the miss, never by the hits
+  EXPECT_GE(stats.latch_hold_ns_.Count(), 9);
+  EXPECT_EQ(stats.latch_hold_ns_.Count(), stats.latch_wait_ns_.Count());
+  LOG_INFO("\n%s", stats.ToString().c_str());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// The parallel buffer pool adds up the statistics of its instances.
+// NOLINTNEXTLINE
+TEST(BufferPoolStatsTest, ParallelBufferPoolManagerTest) {
+  const size_t num_instances = 3;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(num_instances, 4, disk_manager);
+
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id;
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+  for (page_id_t fetched : page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(fetched));
+    ASSERT_TRUE(bpm->UnpinPage(fetched, false));
+  }
+
+  BufferPoolStats total = bpm->GetStats();
+  BufferPoolStats sum;
+  for (size_t i = 0; i < num_instances; ++i) {
+    sum += bpm->GetInstanceStats(i);
+  }
+  EXPECT_EQ(20, total.hits_ + total.misses_);
+  EXPECT_EQ(sum.hits_, total.hits_);
+  EXPECT_EQ(sum.misses_, total.misses_);
+  EXPECT_EQ(sum.evictions_, total.evictions_);
+  EXPECT_EQ(sum.dirty_evictions_, total.dirty_evictions_);
+  EXPECT_EQ(sum.read_ns_.Count(), total.read_ns_.Count());
+  EXPECT_EQ(total.misses_, total.read_ns_.Count());
+  EXPECT_EQ(12, total.resident_pages_);
+  EXPECT_EQ(12, total.replacer_size_);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_warmer_test.cpp
+//
+// Identification: test/buffer/buffer_pool_warmer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_warmer.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(BufferPoolWarmerTest, RestartTest) {
+  const std::string db_name = "test.db";
+  const std::string warm_name = "test.warm";
+  const size_t buffer_pool_size = 16;
+  const int num_pages = 64;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  // work on a scattered set of pages, the last one fetched is the hottest
+  for (page_id_t hot_page : {3, 50, 17, 9, 33, 41, 5}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(hot_page));
+    bpm->UnpinPage(hot_page, false);
+  }
+  // a pinned page is hotter still
+  ASSERT_NE(nullptr, bpm->FetchPage(60));
+  std::vector<page_id_t> hot_pages = bpm->GetHotPages(buffer_pool_size);
+  ASSERT_EQ(buffer_pool_size, hot_pages.size());
+  EXPECT_EQ(60, hot_pages[0]);
+  EXPECT_EQ(5, hot_pages[1]);
+  EXPECT_EQ(41, hot_pages[2]);
+  EXPECT_EQ(3, hot_pages[7]);
+
+  BufferPoolWarmer warmer(bpm, warm_name);
+  ASSERT_TRUE(warmer.Dump());
+  std::vector<page_id_t> saved;
+  ASSERT_TRUE(warmer.Load(&saved));
+  EXPECT_EQ(hot_pages, saved);
+
+  // a page deleted after the list was saved is not brought back
+  bpm->UnpinPage(60, false);
+  ASSERT_TRUE(bpm->DeletePage(41));
+  bpm->FlushAllPages();
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+
+  disk_manager = new DiskManager(db_name);
+  bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  BufferPoolWarmer restarted(bpm, warm_name);
+  EXPECT_EQ(buffer_pool_size - 1, restarted.WarmUp());
+  EXPECT_EQ(buffer_pool_size - 1, bpm->GetPrefetchedPages());
+
+  // the pool comes back with the saved pages, still ordered by hotness
+  std::vector<page_id_t> expected;
+  for (page_id_t saved_page : saved) {
+    if (saved_page != 41) {
+      expected.push_back(saved_page);
+    }
+  }
+  EXPECT_EQ(expected, bpm->GetHotPages(buffer_pool_size));
+  for (page_id_t warm_page : expected) {
+    Page *page = bpm->FetchPage(warm_page);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(warm_page), std::string(page->GetData()));
+    bpm->UnpinPage(warm_page, false);
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove(warm_name.c_str());
+}
+
+// A missing or damaged list means a cold start, never a failure.
+// NOLINTNEXTLINE
+TEST(BufferPoolWarmerTest, DamagedListTest) {
+  const std::string warm_name = "test.warm";
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(8, disk_manager);
+  BufferPoolWarmer warmer(bpm, warm_name);
+  std::vector<page_id_t> page_ids;
+
+  remove(warm_name.c_str());
+  EXPECT_FALSE(warmer.Load(&page_ids));
+  EXPECT_EQ(0, warmer.WarmUp());
+
+  {
+    std::ofstream out(warm_name, std::ios::binary | std::ios::trunc);
+    out << "not a hot page list";
+  }
+  EXPECT_FALSE(warmer.Load(&page_ids));
+  EXPECT_EQ(0, warmer.WarmUp());
+
+  // truncating a valid list makes it unusable as a whole
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  bpm->UnpinPage(page_id, true);
+  ASSERT_TRUE(warmer.Dump());
+  {
+    std::ifstream in(warm_name, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::ofstream out(warm_name, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), static_cast<std::streamsize>(contents.size() - 1));
+  }
+  EXPECT_FALSE(warmer.Load(&page_ids));
+  EXPECT_TRUE(page_ids.empty());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+  remove(warm_name.c_str());
+}
+
+// The dump thread keeps the list current and saves it a last time when it stops.
+// NOLINTNEXTLINE
+TEST(BufferPoolWarmerTest, DumpThreadTest) {
+  const std::string warm_name = "test.warm";
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(2, 8, disk_manager);
+  BufferPoolWarmer warmer(bpm, warm_name);
+  remove(warm_name.c_str());
+
+  auto old_interval = buffer_pool_dump_interval;
+  buffer_pool_dump_interval = std::chrono::milliseconds(5);
+  warmer.RunDumpThread();
+  page_id_t page_id;
+  for (int i = 0; i < 12; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+  warmer.StopDumpThread();
+  buffer_pool_dump_interval = old_interval;
+
+  std::vector<page_id_t> page_ids;
+  ASSERT_TRUE(warmer.Load(&page_ids));
+  EXPECT_EQ(12, page_ids.size());
+  // the instances take turns, each with its most recently used page first
+  EXPECT_EQ(bpm->GetHotPages(bpm->GetPoolSize()), page_ids);
+  EXPECT_NE(page_ids[0] % 2, page_ids[1] % 2);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+  remove(warm_name.c_str());
+}
+
+}  // namespace bustub
@@ -10,16 +10,21 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <memory>
+#include <set>
 #include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/clock_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "common/logger.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
   // Scenario: unpin six elements, i.e. add them to the replacer.
@@ -59,4 +64,82 @@ TEST(ClockReplacerTest, DISABLED_SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+TEST(ClockReplacerTest, ConcurrencyTest) {
+  const size_t num_frames = 64;
+  const int num_threads = 8;
+  const int rounds = 10000;
+  ClockReplacer clock_replacer(num_frames);
+
+  // Every thread keeps pinning and unpinning its own frames while one thread victimizes and unpins again.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < rounds; ++i) {
+        auto frame_id = static_cast<frame_id_t>((t + i * num_threads) % num_frames);
+        clock_replacer.Pin(frame_id);
+        clock_replacer.Unpin(frame_id);
+      }
+    });
+  }
+  threads.emplace_back([&] {
+    frame_id_t frame_id;
+    for (int i = 0; i < rounds; ++i) {
+      if (clock_replacer.Victim(&frame_id)) {
+        clock_replacer.Unpin(frame_id);
+      }
+    }
+  });
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Every frame ends up unpinned exactly once.
+  EXPECT_EQ(num_frames, clock_replacer.Size());
+  std::set<frame_id_t> victims;
+  frame_id_t frame_id;
+  while (clock_replacer.Victim(&frame_id)) {
+    EXPECT_TRUE(victims.insert(frame_id).second);
+  }
+  EXPECT_EQ(num_frames, victims.size());
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+// Pin/Unpin throughput of the clock replacer against the LRU replacer on a hit-only workload.
+TEST(ClockReplacerTest, ScalingBenchmarkTest) {
+  const size_t num_frames = 1024;
+  const size_t total_ops = 1 << 18;
+
+  auto run = [&](Replacer *replacer, size_t num_threads) {
+    for (size_t i = 0; i < num_frames; ++i) {
+      replacer->Unpin(static_cast<frame_id_t>(i));
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t] {
+        for (size_t i = t; i < total_ops; i += num_threads) {
+          auto frame_id = static_cast<frame_id_t>(i % num_frames);
+          replacer->Pin(frame_id);
+          replacer->Unpin(frame_id);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_frames, replacer->Size());
+    return total_ops / elapsed / 1e6;
+  };
+
+  for (size_t num_threads = 1; num_threads <= 64; num_threads *= 2) {
+    auto lru_replacer = std::make_unique<LRUReplacer>(num_frames);
+    auto clock_replacer = std::make_unique<ClockReplacer>(num_frames);
+    double lru = run(lru_replacer.get(), num_threads);
+    double clock = run(clock_replacer.get(), num_threads);
+    LOG_INFO("%2zu threads: LRU %6.2f M pin/unpin per second, clock %6.2f M pin/unpin per second", num_threads, lru,
+             clock);
+  }
+}
+
 }  // namespace bustub
@@ -0,0 +1,107 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena_test.cpp
+//
+// Identification: test/buffer/frame_arena_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/frame_arena.h"
+#include "common/logger.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, SampleTest) {
+  const size_t num_frames = 10;
+  for (auto policy : {HugePagePolicy::NEVER, HugePagePolicy::TRANSPARENT, HugePagePolicy::EXPLICIT}) {
+    FrameArena arena(num_frames, policy);
+    EXPECT_EQ(num_frames * PAGE_SIZE, arena.GetSize());
+    // explicit huge pages are only used if the system has some reserved
+    EXPECT_NE(policy == HugePagePolicy::EXPLICIT ? HugePagePolicy::NEVER : HugePagePolicy::EXPLICIT,
+              arena.GetHugePagePolicy());
+    for (frame_id_t i = 0; i < static_cast<frame_id_t>(num_frames); ++i) {
+      char *frame = arena.GetFrame(i);
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(frame) % PAGE_ALIGNMENT);
+      EXPECT_EQ(i, arena.GetFrameId(frame));
+      EXPECT_EQ(0, frame[0]);
+      EXPECT_EQ(0, frame[PAGE_SIZE - 1]);
+      snprintf(frame, PAGE_SIZE, "frame %d", i);
+    }
+    for (frame_id_t i = 0; i < static_cast<frame_id_t>(num_frames); ++i) {
+      EXPECT_EQ("frame " + std::to_string(i), std::string(arena.GetFrame(i)));
+    }
+  }
+}
+
+// FetchPage throughput on a resident pool much larger than the TLB reach of regular pages, with and without huge
+// pages: random point accesses and a full scan.
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, HugePageBenchmarkTest) {
+  const size_t buffer_pool_size = 1 << 16;  // 256 MB of frames
+  const size_t num_fetches = 1 << 21;
+  HugePagePolicy old_policy = buffer_pool_huge_pages;
+
+  for (auto policy : {HugePagePolicy::NEVER, HugePagePolicy::TRANSPARENT, HugePagePolicy::EXPLICIT}) {
+    buffer_pool_huge_pages = policy;
+    auto *disk_manager = new DiskManager("test.db");
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, ReplacerType::CLOCK);
+    page_id_t page_id;
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+      bpm->UnpinPage(page_id, false);
+    }
+
+    std::default_random_engine rng(0);
+    std::vector<std::pair<page_id_t, size_t>> accesses(num_fetches);
+    for (auto &[access_page_id, offset] : accesses) {
+      access_page_id = static_cast<page_id_t>(rng() % buffer_pool_size);
+      offset = rng() % (PAGE_SIZE / sizeof(uint64_t));
+    }
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto [access_page_id, offset] : accesses) {
+      Page *page = bpm->FetchPage(access_page_id);
+      sum += reinterpret_cast<uint64_t *>(page->GetData())[offset];
+      bpm->UnpinPage(access_page_id, false);
+    }
+    auto random_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (page_id_t scan_page_id = 0; scan_page_id < static_cast<page_id_t>(buffer_pool_size); ++scan_page_id) {
+      Page *page = bpm->FetchPage(scan_page_id);
+      const auto *words = reinterpret_cast<uint64_t *>(page->GetData());
+      for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); ++i) {
+        sum += words[i];
+      }
+      bpm->UnpinPage(scan_page_id, false);
+    }
+    auto scan_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(0, sum);
+
+    const char *names[] = {"regular pages", "transparent huge pages", "explicit huge pages"};
+    LOG_INFO("%-22s: %6.1f ns per random fetch, %5.2f GB/s scan", names[static_cast<int>(policy)],
+             random_seconds * 1e9 / num_fetches, buffer_pool_size * PAGE_SIZE / scan_seconds / 1e9);
+
+    delete bpm;
+    disk_manager->ShutDown();
+    remove("test.db");
+    delete disk_manager;
+  }
+  buffer_pool_huge_pages = old_policy;
+}
+
+}  // namespace bustub
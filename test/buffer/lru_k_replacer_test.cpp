@@ -0,0 +1,104 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <vector>
+
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2, 1);
+
+  // Scenario: access six frames once, frame 1 and 2 once more, then unpin all of them.
+  for (frame_id_t frame_id = 1; frame_id <= 6; ++frame_id) {
+    lru_k_replacer.Pin(frame_id);
+  }
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Pin(1);
+  for (frame_id_t frame_id = 1; frame_id <= 6; ++frame_id) {
+    lru_k_replacer.Unpin(frame_id);
+  }
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // Scenario: frames seen only once go first, in the order they were first accessed.
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+
+  // Scenario: pinned frames are not victims; pinning 3 again has no effect on the evictable count.
+  lru_k_replacer.Pin(5);
+  lru_k_replacer.Pin(3);
+  EXPECT_EQ(3, lru_k_replacer.Size());
+  lru_k_replacer.Unpin(3);
+
+  // Scenario: 6 and 3 have one access each, then 1 has the oldest second most recent access.
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+
+  // Scenario: 5 has two accesses now, but its second most recent one is newer than 2's.
+  lru_k_replacer.Unpin(5);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+}
+
+TEST(LRUKReplacerTest, CorrelatedAccessTest) {
+  LRUKReplacer lru_k_replacer(4, 2, 3);
+
+  // Frame 0 is accessed in one burst, as a scan does tuple by tuple; frame 1 is accessed twice far apart.
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Pin(1);
+  for (frame_id_t frame_id = 0; frame_id < 4; ++frame_id) {
+    lru_k_replacer.Unpin(frame_id);
+  }
+
+  std::vector<frame_id_t> expected{0, 3, 2, 1};
+  EXPECT_EQ(expected, lru_k_replacer.PeekVictims(4));
+  int value;
+  for (frame_id_t frame_id : expected) {
+    lru_k_replacer.Victim(&value);
+    EXPECT_EQ(frame_id, value);
+  }
+
+  // Admitting a new page forgets the frame's history: 1 was accessed twice, but not since its new page was loaded.
+  for (frame_id_t frame_id = 0; frame_id < 4; ++frame_id) {
+    lru_k_replacer.Pin(frame_id);
+  }
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Admit(1, 42);
+  lru_k_replacer.Unpin(0);
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+}
+
+}  // namespace bustub
@@ -0,0 +1,136 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard_test.cpp
+//
+// Identification: test/buffer/page_guard_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/page_guard.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(PageGuardTest, SampleTest) {
+  const size_t buffer_pool_size = 5;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id;
+  BasicPageGuard guard = bpm->NewPageGuarded(&page_id);
+  ASSERT_TRUE(guard);
+  Page *page = guard.GetPage();
+  EXPECT_EQ(page_id, guard.PageId());
+  EXPECT_EQ(1, page->GetPinCount());
+  std::strcpy(guard.GetData(), "Hello");  // NOLINT
+  guard.SetDirty();
+
+  // moving hands the pin over instead of taking another one
+  BasicPageGuard moved = std::move(guard);
+  EXPECT_FALSE(guard);  // NOLINT(bugprone-use-after-move)
+  EXPECT_EQ(1, page->GetPinCount());
+  moved.Drop();
+  EXPECT_EQ(0, page->GetPinCount());
+  EXPECT_TRUE(page->IsDirty());
+  // dropping twice, or destroying a dropped guard, does not unpin again
+  moved.Drop();
+  EXPECT_EQ(0, page->GetPinCount());
+
+  {
+    ReadPageGuard reader1 = bpm->FetchPageRead(page_id);
+    ReadPageGuard reader2 = bpm->FetchPageRead(page_id);
+    EXPECT_EQ(2, page->GetPinCount());
+    EXPECT_STREQ("Hello", reader1.GetData());
+    reader2 = std::move(reader1);
+    EXPECT_EQ(1, page->GetPinCount());
+  }
+  EXPECT_EQ(0, page->GetPinCount());
+
+  {
+    WritePageGuard writer = bpm->FetchPageWrite(page_id);
+    EXPECT_EQ(1, page->GetPinCount());
+    std::strcpy(writer.GetData(), "World");  // NOLINT
+    writer.SetDirty();
+  }
+  EXPECT_EQ(0, page->GetPinCount());
+  {
+    // the write latch was released, so it can be taken again
+    WritePageGuard writer = bpm->FetchPageBasic(page_id).UpgradeWrite();
+    EXPECT_STREQ("World", writer.GetData());
+  }
+
+  {
+    // a change made before taking the read latch is still written back
+    BasicPageGuard basic = bpm->FetchPageBasic(page_id);
+    ASSERT_TRUE(bpm->FlushPage(page_id));
+    EXPECT_FALSE(page->IsDirty());
+    std::strcpy(basic.GetData(), "Again");  // NOLINT
+    basic.SetDirty();
+    ReadPageGuard reader = basic.UpgradeRead();
+    EXPECT_STREQ("Again", reader.GetData());
+  }
+  EXPECT_TRUE(page->IsDirty());
+
+  // a failed fetch gives an empty guard
+  std::vector<BasicPageGuard> pinned;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t new_page_id;
+    pinned.push_back(bpm->NewPageGuarded(&new_page_id));
+    ASSERT_TRUE(pinned.back());
+  }
+  EXPECT_FALSE(bpm->FetchPageRead(page_id));
+  pinned.clear();
+  EXPECT_TRUE(bpm->FetchPageRead(page_id));
+  EXPECT_EQ(buffer_pool_size, bpm->GetStats().replacer_size_);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// Guards from a parallel pool unpin in the instance that holds the page.
+// NOLINTNEXTLINE
+TEST(PageGuardTest, ParallelBufferPoolManagerTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(3, 2, disk_manager);
+
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < 6; ++i) {
+    page_id_t page_id;
+    WritePageGuard guard = bpm->NewPageGuarded(&page_id).UpgradeWrite();
+    ASSERT_TRUE(guard);
+    snprintf(guard.GetData(), PAGE_SIZE, "page %d", page_id);
+    guard.SetDirty();
+    page_ids.push_back(page_id);
+  }
+  // every frame was released, so the pages can be cycled through the pool again
+  for (int round = 0; round < 2; ++round) {
+    for (page_id_t page_id : page_ids) {
+      ReadPageGuard guard = bpm->FetchPageRead(page_id);
+      ASSERT_TRUE(guard);
+      EXPECT_EQ("page " + std::to_string(page_id), std::string(guard.GetData()));
+    }
+  }
+  EXPECT_EQ(6, bpm->GetStats().replacer_size_);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+}  // namespace bustub
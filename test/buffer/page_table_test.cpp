@@ -0,0 +1,134 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table_test.cpp
+//
+// Identification: test/buffer/page_table_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buffer/page_table.h"
+#include "common/logger.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(PageTableTest, SampleTest) {
+  PageTable page_table(4);
+  frame_id_t frame_id;
+
+  EXPECT_FALSE(page_table.Find(0, &frame_id));
+  page_table.Insert(0, 3);
+  page_table.Insert(8, 1);
+  page_table.Insert(16, 2);
+  EXPECT_EQ(3, page_table.Size());
+
+  EXPECT_TRUE(page_table.Find(8, &frame_id));
+  EXPECT_EQ(1, frame_id);
+  EXPECT_TRUE(page_table.Erase(0));
+  EXPECT_FALSE(page_table.Erase(0));
+  EXPECT_FALSE(page_table.Find(0, &frame_id));
+  EXPECT_TRUE(page_table.Find(16, &frame_id));
+  EXPECT_EQ(2, frame_id);
+  EXPECT_EQ(2, page_table.Size());
+}
+
+TEST(PageTableTest, RandomTest) {
+  const size_t num_frames = 64;
+  PageTable page_table(num_frames);
+  std::unordered_map<page_id_t, frame_id_t> expected;
+  std::default_random_engine rng(0);
+  std::uniform_int_distribution<page_id_t> page_ids(0, 1000);
+
+  // Mirror random inserts and erases in a std::unordered_map, keeping the table at most full.
+  for (int i = 0; i < 100000; ++i) {
+    page_id_t page_id = page_ids(rng);
+    if (expected.count(page_id) != 0) {
+      EXPECT_TRUE(page_table.Erase(page_id));
+      expected.erase(page_id);
+    } else if (expected.size() < num_frames) {
+      page_table.Insert(page_id, i % num_frames);
+      expected[page_id] = i % num_frames;
+    }
+    frame_id_t frame_id;
+    page_id_t probe = page_ids(rng);
+    ASSERT_EQ(expected.count(probe) != 0, page_table.Find(probe, &frame_id));
+    if (expected.count(probe) != 0) {
+      EXPECT_EQ(expected[probe], frame_id);
+    }
+  }
+  EXPECT_EQ(expected.size(), page_table.Size());
+}
+
+// The page table traffic of FetchPage against a pool holding most of a skewed working set: a lookup per fetch, and an
+// erase and an insert per miss. Compared with the std::unordered_map the buffer pool used before.
+// NOLINTNEXTLINE
+TEST(PageTableTest, FetchBenchmarkTest) {
+  const size_t num_frames = 4096;
+  const int num_fetches = 1 << 22;
+  std::default_random_engine rng(0);
+  std::uniform_int_distribution<page_id_t> hot(0, num_frames * 3 / 4);
+  std::uniform_int_distribution<page_id_t> cold(0, num_frames * 16);
+  std::vector<page_id_t> fetches(num_fetches);
+  for (auto &page_id : fetches) {
+    page_id = rng() % 10 == 0 ? cold(rng) : hot(rng);
+  }
+
+  // Runs the fetches against a table, evicting frames round robin; returns the number of misses and the time taken.
+  auto run = [&](auto find, auto insert, auto erase) {
+    std::vector<page_id_t> frame_pages(num_frames, INVALID_PAGE_ID);
+    size_t next_victim = 0;
+    int misses = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (page_id_t page_id : fetches) {
+      frame_id_t frame_id;
+      if (find(page_id, &frame_id)) {
+        continue;
+      }
+      misses++;
+      frame_id = static_cast<frame_id_t>(next_victim++ % num_frames);
+      if (frame_pages[frame_id] != INVALID_PAGE_ID) {
+        erase(frame_pages[frame_id]);
+      }
+      insert(page_id, frame_id);
+      frame_pages[frame_id] = page_id;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return std::make_pair(misses, elapsed);
+  };
+
+  PageTable page_table(num_frames);
+  auto [table_misses, table_seconds] =
+      run([&](page_id_t page_id, frame_id_t *frame_id) { return page_table.Find(page_id, frame_id); },
+          [&](page_id_t page_id, frame_id_t frame_id) { page_table.Insert(page_id, frame_id); },
+          [&](page_id_t page_id) { page_table.Erase(page_id); });
+
+  std::unordered_map<page_id_t, frame_id_t> map;
+  auto [map_misses, map_seconds] = run(
+      [&](page_id_t page_id, frame_id_t *frame_id) {
+        auto it = map.find(page_id);
+        if (it == map.end()) {
+          return false;
+        }
+        *frame_id = it->second;
+        return true;
+      },
+      [&](page_id_t page_id, frame_id_t frame_id) { map[page_id] = frame_id; },
+      [&](page_id_t page_id) { map.erase(page_id); });
+
+  EXPECT_EQ(map_misses, table_misses);
+  EXPECT_EQ(map.size(), page_table.Size());
+  LOG_INFO("%d fetches, %d misses: PageTable %.1f ns per fetch, std::unordered_map %.1f ns per fetch", num_fetches,
+           table_misses, table_seconds * 1e9 / num_fetches, map_seconds * 1e9 / num_fetches);
+}
+
+}  // namespace bustub
@@ -11,10 +11,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/parallel_buffer_pool_manager.h"
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <mutex>  // NOLINT
 #include <random>
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
+#include "common/logger.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
@@ -40,7 +46,8 @@ TEST(ParallelBufferPoolManagerTest, BinaryDataTest) {
   ASSERT_NE(nullptr, page0);
   EXPECT_EQ(0, page_id_temp);
 
-  char random_binary_data[PAGE_SIZE];
+  // the rest of the page holds its checksum on disk
+  char random_binary_data[PAGE_USABLE_SIZE];
   // Generate random binary data
   for (char &i : random_binary_data) {
     i = uniform_dist(rng);
@@ -48,11 +55,11 @@ TEST(ParallelBufferPoolManagerTest, BinaryDataTest) {
 
   // Insert terminal characters both in the middle and at end
   random_binary_data[PAGE_SIZE / 2] = '\0';
-  random_binary_data[PAGE_SIZE - 1] = '\0';
+  random_binary_data[PAGE_USABLE_SIZE - 1] = '\0';
 
   // Scenario: Once we have a page, we should be able to read and write content.
-  std::memcpy(page0->GetData(), random_binary_data, PAGE_SIZE);
-  EXPECT_EQ(0, std::memcmp(page0->GetData(), random_binary_data, PAGE_SIZE));
+  std::memcpy(page0->GetData(), random_binary_data, PAGE_USABLE_SIZE);
+  EXPECT_EQ(0, std::memcmp(page0->GetData(), random_binary_data, PAGE_USABLE_SIZE));
 
   // Scenario: We should be able to create new pages until we fill up the buffer pool.
   for (size_t i = 1; i < buffer_pool_size * num_instances; ++i) {
@@ -76,7 +83,7 @@ TEST(ParallelBufferPoolManagerTest, BinaryDataTest) {
 
   // Scenario: We should be able to fetch the data we wrote a while ago.
   page0 = bpm->FetchPage(0);
-  EXPECT_EQ(0, memcmp(page0->GetData(), random_binary_data, PAGE_SIZE));
+  EXPECT_EQ(0, memcmp(page0->GetData(), random_binary_data, PAGE_USABLE_SIZE));
   EXPECT_EQ(true, bpm->UnpinPage(0, true));
 
   // Shutdown the disk manager and remove the temporary file we created.
@@ -151,4 +158,61 @@ TEST(ParallelBufferPoolManagerTest, SampleTest) {
   delete disk_manager;
 }
 
+// Threads creating pages concurrently must get distinct pages, spread over every instance, until the pool is full.
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ConcurrentNewPageTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 64;
+  const size_t num_instances = 8;
+  const size_t num_threads = 8;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager, nullptr, ReplacerType::LRU,
+                                            true);
+  std::set<page_id_t> page_ids;
+  std::mutex page_ids_latch;
+
+  // Fill the pool, keeping every page pinned.
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&] {
+      std::vector<page_id_t> created;
+      page_id_t page_id;
+      while (bpm->NewPage(&page_id) != nullptr) {
+        created.push_back(page_id);
+      }
+      std::scoped_lock lock{page_ids_latch};
+      page_ids.insert(created.begin(), created.end());
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  LOG_INFO("%zu threads created %zu pages in %.0f us", num_threads, page_ids.size(), elapsed);
+
+  ASSERT_EQ(buffer_pool_size * num_instances, page_ids.size());
+  std::vector<size_t> per_instance(num_instances);
+  for (page_id_t page_id : page_ids) {
+    per_instance[page_id % num_instances]++;
+  }
+  for (size_t count : per_instance) {
+    EXPECT_EQ(buffer_pool_size, count);
+  }
+
+  // Once some pages are unpinned, new pages have to evict them, wherever they are.
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  EXPECT_TRUE(bpm->UnpinPage(*page_ids.rbegin(), false));
+  EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
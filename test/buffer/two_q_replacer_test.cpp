@@ -0,0 +1,68 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// two_q_replacer_test.cpp
+//
+// Identification: test/buffer/two_q_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <vector>
+
+#include "buffer/two_q_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(TwoQReplacerTest, SampleTest) {
+  // A1in holds one frame before it is preferred for eviction, A1out remembers four pages.
+  TwoQReplacer two_q_replacer(4, 0.25, 1.0);
+
+  // Scenario: load pages 10..13 into frames 0..3; accesses in A1in do not reorder it.
+  for (frame_id_t frame_id = 0; frame_id < 4; ++frame_id) {
+    two_q_replacer.Admit(frame_id, 10 + frame_id);
+    two_q_replacer.Pin(frame_id);
+  }
+  two_q_replacer.Pin(0);
+  for (frame_id_t frame_id = 0; frame_id < 4; ++frame_id) {
+    two_q_replacer.Unpin(frame_id);
+  }
+  EXPECT_EQ(4, two_q_replacer.Size());
+
+  int value;
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+
+  // Scenario: page 10 comes back while remembered in A1out, so it goes to Am, which only gives up frames once A1in
+  // is down to its target size.
+  two_q_replacer.Admit(0, 10);
+  two_q_replacer.Pin(0);
+  two_q_replacer.Unpin(0);
+  two_q_replacer.Admit(1, 20);
+  two_q_replacer.Pin(1);
+  two_q_replacer.Unpin(1);
+  std::vector<frame_id_t> expected{2, 3, 0, 1};
+  EXPECT_EQ(expected, two_q_replacer.PeekVictims(4));
+
+  // Scenario: pinned frames are skipped.
+  two_q_replacer.Pin(2);
+  EXPECT_EQ(3, two_q_replacer.Size());
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+  EXPECT_FALSE(two_q_replacer.Victim(&value));
+  two_q_replacer.Unpin(2);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+}
+
+}  // namespace bustub
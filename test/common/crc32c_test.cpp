@@ -0,0 +1,84 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c_test.cpp
+//
+// Identification: test/common/crc32c_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/crc32c.h"
+
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/config.h"
+#include "common/logger.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(Crc32cTest, KnownValueTest) {
+  // the check value of CRC-32C, and the test vectors of RFC 3720
+  EXPECT_EQ(0xe3069283, Crc32c::Value("123456789", 9));
+  std::vector<char> data(32, 0);
+  EXPECT_EQ(0x8a9136aa, Crc32c::Value(data.data(), data.size()));
+  std::fill(data.begin(), data.end(), static_cast<char>(0xff));
+  EXPECT_EQ(0x62a8ab43, Crc32c::Value(data.data(), data.size()));
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i);
+  }
+  EXPECT_EQ(0x46dd794e, Crc32c::Value(data.data(), data.size()));
+  EXPECT_EQ(0, Crc32c::Value(data.data(), 0));
+}
+
+// The interleaved hardware CRC agrees with the table for every length and alignment, and extends like it.
+// NOLINTNEXTLINE
+TEST(Crc32cTest, HardwareMatchesPortableTest) {
+  LOG_INFO("crc32 instruction %s", Crc32c::IsHardwareAccelerated() ? "available" : "not available");
+  std::default_random_engine rng(0);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<char> data(3 * PAGE_SIZE);
+  for (char &c : data) {
+    c = static_cast<char>(byte(rng));
+  }
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t length : {size_t{0}, size_t{7}, size_t{100}, size_t{767}, size_t{768}, size_t{3072}, size_t{3839},
+                          static_cast<size_t>(PAGE_USABLE_SIZE), static_cast<size_t>(2 * PAGE_SIZE + 5)}) {
+      EXPECT_EQ(Crc32c::ExtendPortable(0, data.data() + offset, length), Crc32c::Value(data.data() + offset, length))
+          << "offset " << offset << ", length " << length;
+    }
+  }
+  uint32_t crc = Crc32c::Value(data.data(), 1000);
+  EXPECT_EQ(Crc32c::Value(data.data(), PAGE_SIZE), Crc32c::Extend(crc, data.data() + 1000, PAGE_SIZE - 1000));
+}
+
+// NOLINTNEXTLINE
+TEST(Crc32cTest, BenchmarkTest) {
+  const int num_rounds = 100000;
+  std::vector<char> page(PAGE_SIZE, 'x');
+  auto time = [&](auto crc) {
+    uint32_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_rounds; ++i) {
+      page[i % PAGE_USABLE_SIZE] = static_cast<char>(i);
+      sum += crc(page.data(), PAGE_USABLE_SIZE);
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    // keep the checksums from being optimized away
+    EXPECT_NE(0, sum);
+    return static_cast<double>(ns) / num_rounds;
+  };
+  double hardware_ns = time([](const char *data, size_t length) { return Crc32c::Value(data, length); });
+  double portable_ns = time([](const char *data, size_t length) { return Crc32c::ExtendPortable(0, data, length); });
+  LOG_INFO("checksum of a %d byte page: %.0f ns, %.0f ns with the table (%.2f GB/s vs %.2f GB/s)", PAGE_USABLE_SIZE,
+           hardware_ns, portable_ns, PAGE_USABLE_SIZE / hardware_ns, PAGE_USABLE_SIZE / portable_ns);
+}
+
+}  // namespace bustub
@@ -0,0 +1,108 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec_test.cpp
+//
+// Identification: test/common/lz4_codec_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/lz4_codec.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(Lz4CodecTest, RoundTripTest) {
+  std::default_random_engine rng(0);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<char> page(PAGE_SIZE);
+  std::vector<char> compressed(2 * PAGE_SIZE);
+  std::vector<char> decompressed(PAGE_SIZE);
+  auto round_trip = [&](size_t size) {
+    size_t compressed_size = Lz4Codec::Compress(page.data(), size, compressed.data(), compressed.size());
+    EXPECT_NE(0, compressed_size);
+    EXPECT_TRUE(Lz4Codec::Decompress(compressed.data(), compressed_size, decompressed.data(), size)) << size;
+    EXPECT_EQ(0, std::memcmp(page.data(), decompressed.data(), size)) << size;
+    return compressed_size;
+  };
+
+  // zeros, a repeated byte being the case of matches that overlap their own output
+  std::fill(page.begin(), page.end(), 0);
+  EXPECT_GT(100, round_trip(PAGE_SIZE));
+  // tuples that differ in a few bytes each
+  for (size_t i = 0; i < PAGE_SIZE / 32; ++i) {
+    std::snprintf(page.data() + i * 32, 32, "row %06zu name-%zu", i, i % 7);
+  }
+  EXPECT_GT(PAGE_SIZE / 2, round_trip(PAGE_SIZE));
+  // random bytes only grow a little
+  for (char &c : page) {
+    c = static_cast<char>(byte(rng));
+  }
+  EXPECT_GE(PAGE_SIZE + PAGE_SIZE / 255 + 16, round_trip(PAGE_SIZE));
+  // sizes around the limits on where matches may start
+  for (size_t size = 0; size < 40; ++size) {
+    for (size_t i = 0; i < size; ++i) {
+      page[i] = static_cast<char>(i % 3);
+    }
+    round_trip(size);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(Lz4CodecTest, CapacityTest) {
+  std::default_random_engine rng(0);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<char> page(PAGE_SIZE);
+  for (char &c : page) {
+    c = static_cast<char>(byte(rng));
+  }
+  std::vector<char> compressed(PAGE_SIZE);
+  // incompressible data does not fit in less than its own size
+  EXPECT_EQ(0, Lz4Codec::Compress(page.data(), PAGE_SIZE, compressed.data(), PAGE_SIZE));
+  std::fill(page.begin(), page.end(), 'x');
+  size_t compressed_size = Lz4Codec::Compress(page.data(), PAGE_SIZE, compressed.data(), PAGE_SIZE);
+  EXPECT_EQ(compressed_size, Lz4Codec::Compress(page.data(), PAGE_SIZE, compressed.data(), compressed_size));
+  EXPECT_EQ(0, Lz4Codec::Compress(page.data(), PAGE_SIZE, compressed.data(), compressed_size - 1));
+}
+
+// Damaged blocks are rejected, and never read or written out of bounds (which the sanitizers would report).
+// NOLINTNEXTLINE
+TEST(Lz4CodecTest, DamagedBlockTest) {
+  std::vector<char> page(PAGE_SIZE);
+  for (size_t i = 0; i < PAGE_SIZE / 16; ++i) {
+    std::snprintf(page.data() + i * 16, 16, "key %zu", i);
+  }
+  std::vector<char> compressed(2 * PAGE_SIZE);
+  size_t compressed_size = Lz4Codec::Compress(page.data(), PAGE_SIZE, compressed.data(), compressed.size());
+  ASSERT_NE(0, compressed_size);
+  std::vector<char> out(PAGE_SIZE);
+
+  // the wrong size, and truncated blocks
+  EXPECT_FALSE(Lz4Codec::Decompress(compressed.data(), compressed_size, out.data(), PAGE_SIZE - 1));
+  for (size_t size = 0; size < compressed_size; size += 7) {
+    EXPECT_FALSE(Lz4Codec::Decompress(compressed.data(), size, out.data(), PAGE_SIZE)) << size;
+  }
+  // every byte flipped in turn; some flips still make a valid block of the right size, none may crash
+  for (size_t i = 0; i < compressed_size; ++i) {
+    std::vector<char> damaged(compressed.begin(), compressed.begin() + compressed_size);
+    damaged[i] = static_cast<char>(~damaged[i]);
+    Lz4Codec::Decompress(damaged.data(), damaged.size(), out.data(), PAGE_SIZE);
+  }
+  // a match reaching before the start of the output
+  const char bad_offset[] = {0x10, 'a', 0x02, 0x00, 0x00};
+  EXPECT_FALSE(Lz4Codec::Decompress(bad_offset, sizeof(bad_offset), out.data(), 6));
+}
+
+}  // namespace bustub
@@ -228,6 +228,46 @@ TEST(HashTableTest, ScaleTest) {
   delete bpm;
 }
 
+// A table on 16 KB pages, whose buckets are laid out for that size and so hold about four times as many pairs.
+TEST(HashTableTest, LargePageTest) {
+  using KeyType = int;
+  using ValueType = int;
+  constexpr int LARGE_PAGE_SIZE = 16 * 1024;
+  constexpr size_t LARGE_BUCKET_SIZE = HashTableBucketPage<int, int, IntComparator, LARGE_PAGE_SIZE>::ARRAY_SIZE;
+  EXPECT_LT(3 * BUCKET_ARRAY_SIZE, LARGE_BUCKET_SIZE);
+
+  auto *disk_manager = new DiskManager("test.db", false, false, LARGE_PAGE_SIZE);
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  EXPECT_EQ(LARGE_PAGE_SIZE, bpm->GetPageSize());
+  ExtendibleHashTable<int, int, IntComparator, LARGE_PAGE_SIZE> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // a single bucket takes them all, the next one splits it
+  for (size_t i = 0; i < LARGE_BUCKET_SIZE; ++i) {
+    EXPECT_TRUE(ht.Insert(nullptr, i, i));
+  }
+  EXPECT_EQ(0, ht.GetGlobalDepth());
+  EXPECT_TRUE(ht.Insert(nullptr, LARGE_BUCKET_SIZE, LARGE_BUCKET_SIZE));
+  EXPECT_EQ(1, ht.GetGlobalDepth());
+  ht.VerifyIntegrity();
+
+  for (size_t i = 0; i <= LARGE_BUCKET_SIZE; ++i) {
+    std::vector<int> res;
+    EXPECT_TRUE(ht.GetValue(nullptr, i, &res));
+    ASSERT_EQ(1, res.size());
+    EXPECT_EQ(static_cast<int>(i), res[0]);
+  }
+  for (size_t i = 0; i <= LARGE_BUCKET_SIZE; ++i) {
+    EXPECT_TRUE(ht.Remove(nullptr, i, i));
+  }
+  EXPECT_EQ(0, ht.GetGlobalDepth());
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 TEST(HashTableTest, ConcurrentTest) {
   auto *disk_manager = new DiskManager("test.db");
   auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
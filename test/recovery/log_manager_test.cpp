@@ -0,0 +1,344 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_manager_test.cpp
+//
+// Identification: test/recovery/log_manager_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "common/config.h"
+#include "common/logger.h"
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/table/tuple.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// Fails every write to the log while the log file is made read-only, as a failing device would.
+class FailingLogDiskManager : public DiskManager {
+ public:
+  using DiskManager::DiskManager;
+
+  void FailLogWrites() {
+    writable_fd_ = dup(log_fd_);
+    int read_only_fd = open(log_name_.c_str(), O_RDONLY);
+    dup2(read_only_fd, log_fd_);
+    close(read_only_fd);
+  }
+
+  void RestoreLogWrites() {
+    dup2(writable_fd_, log_fd_);
+    close(writable_fd_);
+  }
+
+ private:
+  int writable_fd_{-1};
+};
+
+class LogManagerTest : public ::testing::Test {
+ protected:
+  // This function is called before every test.
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+  }
+
+  // This function is called after every test.
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+  };
+};
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, ConcurrentAppendTest) {
+  const int num_threads = 8;
+  const int num_records = 2000;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+  EXPECT_TRUE(enable_logging);
+
+  // far more than fits in the log buffer, so appenders keep running into a full buffer
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([log_manager, tid] {
+      lsn_t prev_lsn = INVALID_LSN;
+      for (int i = 0; i < num_records; i++) {
+        if (i % 2 == 0) {
+          LogRecord log_record(tid, prev_lsn, LogRecordType::NEWPAGE, i, i + 1);
+          prev_lsn = log_manager->AppendLogRecord(&log_record);
+        } else {
+          LogRecord log_record(tid, prev_lsn, LogRecordType::COMMIT);
+          prev_lsn = log_manager->AppendLogRecord(&log_record);
+        }
+        if (i % 100 == 99) {
+          log_manager->Flush(prev_lsn);
+          EXPECT_GE(log_manager->GetPersistentLSN(), prev_lsn);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  lsn_t last_lsn = log_manager->GetNextLSN() - 1;
+  log_manager->StopFlushThread();
+  EXPECT_FALSE(enable_logging);
+  EXPECT_EQ(last_lsn, log_manager->GetPersistentLSN());
+
+  std::ifstream file("test.log", std::ios::binary | std::ios::ate);
+  auto file_size = static_cast<int>(file.tellg());
+  std::vector<char> log(file_size);
+  ASSERT_TRUE(disk_manager->ReadLog(log.data(), file_size, 0));
+
+  // every record made it to the log whole, in the order of its LSN, and in the order each thread appended them
+  std::vector<lsn_t> prev_lsns(num_threads, INVALID_LSN);
+  std::vector<int> counts(num_threads, 0);
+  lsn_t lsn = INVALID_LSN;
+  int offset = 0;
+  while (offset < file_size) {
+    int32_t header[5];
+    memcpy(header, log.data() + offset, sizeof(header));
+    int32_t size = header[0];
+    txn_id_t txn_id = header[2];
+    ASSERT_GT(header[1], lsn);
+    lsn = header[1];
+    ASSERT_TRUE(txn_id >= 0 && txn_id < num_threads);
+    EXPECT_EQ(prev_lsns[txn_id], header[3]);
+    prev_lsns[txn_id] = lsn;
+    int i = counts[txn_id]++;
+    if (i % 2 == 0) {
+      ASSERT_EQ(static_cast<int32_t>(LogRecordType::NEWPAGE), header[4]);
+      ASSERT_EQ(28, size);
+      page_id_t page_ids[2];
+      memcpy(page_ids, log.data() + offset + 20, sizeof(page_ids));
+      EXPECT_EQ(i, page_ids[0]);
+      EXPECT_EQ(i + 1, page_ids[1]);
+    } else {
+      ASSERT_EQ(static_cast<int32_t>(LogRecordType::COMMIT), header[4]);
+      ASSERT_EQ(20, size);
+    }
+    offset += size;
+  }
+  EXPECT_EQ(file_size, offset);
+  EXPECT_EQ(last_lsn, lsn);
+  for (int tid = 0; tid < num_threads; tid++) {
+    EXPECT_EQ(num_records, counts[tid]);
+  }
+
+  delete log_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+/*
+ * Every committer appends a COMMIT record and waits for it to be durable, over and over. One log write makes the
+ * commits of everybody waiting durable together, so commits per write grow with the number of committers.
+ */
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, GroupCommitTest) {
+  const int num_commits = 100;
+  for (int num_committers : {1, 2, 4, 8, 16}) {
+    remove("test.log");
+    auto *disk_manager = new DiskManager("test.db");
+    auto *log_manager = new LogManager(disk_manager);
+    log_manager->RunFlushThread();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_committers; tid++) {
+      threads.emplace_back([log_manager, tid] {
+        for (int i = 0; i < num_commits; i++) {
+          LogRecord log_record(tid, INVALID_LSN, LogRecordType::COMMIT);
+          lsn_t lsn = log_manager->AppendLogRecord(&log_record);
+          log_manager->Flush(lsn);
+          ASSERT_GE(log_manager->GetPersistentLSN(), lsn);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    log_manager->StopFlushThread();
+
+    int commits = num_committers * num_commits;
+    int flushes = disk_manager->GetNumFlushes();
+    LOG_INFO("%2d committers: %.0f commits/s, %d log writes for %d commits (%.1f commits per write)", num_committers,
+             commits * 1e6 / static_cast<double>(us), flushes, commits, commits / static_cast<double>(flushes));
+    EXPECT_LE(flushes, commits);
+    if (num_committers >= 8) {
+      EXPECT_LT(flushes, commits);
+    }
+
+    delete log_manager;
+    disk_manager->ShutDown();
+    delete disk_manager;
+  }
+}
+
+/*
+ * Synchronous commits pay a log write each, asynchronous ones return right away and are written out within
+ * log_timeout, and group commits wait for one write shared by all of them.
+ */
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, DurabilityModeTest) {
+  const int num_committers = 8;
+  const int num_commits = 100;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  auto run_committers = [&](DurabilityMode mode, int commits) {
+    int flushes = disk_manager->GetNumFlushes();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_committers; tid++) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < commits; i++) {
+          Transaction *txn = txn_manager.Begin(nullptr, IsolationLevel::REPEATABLE_READ, mode);
+          // a change of the transaction, the table heap would log it the same way
+          LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::NEWPAGE, INVALID_PAGE_ID, i);
+          txn->SetPrevLSN(log_manager->AppendLogRecord(&log_record));
+          txn_manager.Commit(txn);
+          // the COMMIT record was appended
+          EXPECT_NE(INVALID_LSN, txn->GetPrevLSN());
+          if (mode != DurabilityMode::ASYNC) {
+            EXPECT_GE(log_manager->GetPersistentLSN(), txn->GetPrevLSN());
+          }
+          delete txn;
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    flushes = disk_manager->GetNumFlushes() - flushes;
+    LOG_INFO("%d committers: %.0f commits/s, %d log writes for %d commits", num_committers,
+             num_committers * commits * 1e6 / static_cast<double>(us), flushes, num_committers * commits);
+    return std::make_pair(us, flushes);
+  };
+
+  // a transaction that changed nothing logs nothing, and so never waits for the log
+  lsn_t next_lsn = log_manager->GetNextLSN();
+  Transaction *reader = txn_manager.Begin();
+  txn_manager.Commit(reader);
+  EXPECT_EQ(INVALID_LSN, reader->GetPrevLSN());
+  delete reader;
+  reader = txn_manager.Begin();
+  txn_manager.Abort(reader);
+  delete reader;
+  EXPECT_EQ(next_lsn, log_manager->GetNextLSN());
+
+  LOG_INFO("synchronous");
+  run_committers(DurabilityMode::SYNCHRONOUS, num_commits);
+
+  LOG_INFO("asynchronous");
+  auto [async_us, async_flushes] = run_committers(DurabilityMode::ASYNC, num_commits);
+  EXPECT_LT(async_us, std::chrono::duration_cast<std::chrono::microseconds>(log_timeout).count());
+  // nobody waited for the log, at most a timeout wrote it out meanwhile
+  EXPECT_LE(async_flushes, 1);
+  // the flush thread catches up on its own
+  lsn_t last_lsn = log_manager->GetNextLSN() - 1;
+  auto deadline = std::chrono::steady_clock::now() + 2 * log_timeout;
+  while (log_manager->GetPersistentLSN() < last_lsn && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(last_lsn, log_manager->GetPersistentLSN());
+
+  LOG_INFO("group commit");
+  auto [group_us, group_flushes] = run_committers(DurabilityMode::GROUP_COMMIT, 1);
+  // every committer waited for the timeout, and was written out by the same write
+  EXPECT_LE(group_flushes, 2);
+  EXPECT_LT(group_us, std::chrono::duration_cast<std::chrono::microseconds>(2 * log_timeout).count());
+
+  log_manager->StopFlushThread();
+  delete log_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+/*
+ * An update of a tuple that fills a page of the largest size carries two images of it, which still fit the log buffer.
+ */
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, LargeRecordTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+  Schema schema{std::vector<Column>{Column{"s", TypeId::VARCHAR, MAX_PAGE_SIZE}}};
+  const size_t length = MAX_PAGE_SIZE - 1024;
+  Tuple old_tuple({ValueFactory::GetVarcharValue(std::string(length, 'a'))}, &schema);
+  Tuple new_tuple({ValueFactory::GetVarcharValue(std::string(length, 'b'))}, &schema);
+  LogRecord log_record(0, INVALID_LSN, LogRecordType::UPDATE, RID(0, 0), old_tuple, new_tuple);
+  EXPECT_GT(log_record.GetSize(), 2 * length);
+  log_manager->Flush(log_manager->AppendLogRecord(&log_record));
+  log_manager->StopFlushThread();
+  EXPECT_EQ(log_record.GetSize(), disk_manager->GetLogSize());
+
+  delete log_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+/*
+ * A failed write of the log leaves the persistent LSN where it was, and the flush thread writes the same records again
+ * once the device works.
+ */
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, WriteErrorTest) {
+  auto *disk_manager = new FailingLogDiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+  LogRecord first(0, INVALID_LSN, LogRecordType::COMMIT);
+  log_manager->Flush(log_manager->AppendLogRecord(&first));
+
+  disk_manager->FailLogWrites();
+  LogRecord second(1, INVALID_LSN, LogRecordType::COMMIT);
+  lsn_t lsn = log_manager->AppendLogRecord(&second);
+  std::atomic<bool> flushed = false;
+  std::thread waiter([&] {
+    log_manager->Flush(lsn);
+    flushed = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(flushed);
+  EXPECT_EQ(first.GetLSN(), log_manager->GetPersistentLSN());
+  disk_manager->RestoreLogWrites();
+  waiter.join();
+  EXPECT_EQ(lsn, log_manager->GetPersistentLSN());
+  log_manager->StopFlushThread();
+
+  // each record is in the log once
+  EXPECT_EQ(first.GetSize() + second.GetSize(), disk_manager->GetLogSize());
+  delete log_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+}  // namespace bustub
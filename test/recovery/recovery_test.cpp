@@ -10,19 +10,27 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <set>
 #include <string>
 #include <vector>
 
+#include "buffer/buffer_pool_manager_instance.h"
 #include "common/bustub_instance.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "gtest/gtest.h"
 #include "logging/common.h"
+#include "recovery/checkpoint_manager.h"
 #include "recovery/log_recovery.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -32,6 +40,11 @@ class RecoveryTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.warm");
+    remove("test.ckpt");
+    remove("test_crash.db");
+    remove("test_crash.log");
+    remove("test_crash.ckpt");
   }
 
   // This function is called after every test.
@@ -39,11 +52,525 @@ class RecoveryTest : public ::testing::Test {
     LOG_INFO("Tearing down the system..");
     remove("test.db");
     remove("test.log");
+    remove("test.warm");
+    remove("test.ckpt");
+    remove("test_crash.db");
+    remove("test_crash.log");
+    remove("test_crash.ckpt");
   };
 };
 
+static void CopyFile(const std::string &from, const std::string &to) {
+  std::ifstream in(from, std::ios::binary);
+  std::ofstream out(to, std::ios::binary | std::ios::trunc);
+  out << in.rdbuf();
+}
+
+/**
+ * The database a workload of small update transactions leaves behind when it crashes, kept in test_crash.db,
+ * test_crash.log and test_crash.ckpt. The table is flushed once it is loaded, the updates only reach the log, and the
+ * last transactions never commit.
+ * @param num_updates the number of updates, which the size of the log grows with
+ * @param[out] rids the rows of the table
+ * @param[out] values the value every row has after recovery, -1 if it is deleted
+ * @param checkpoint whether to write the table out again after a quarter of the updates, and take a fuzzy checkpoint
+ * after half of them
+ * @param early_loser whether one of the losers begins before the table is written out again, rather than right
+ * before the checkpoint
+ * @return the first page of the table
+ */
+static page_id_t CrashAfterUpdates(const Schema &schema, int num_updates, std::vector<RID> *rids,
+                                   std::vector<int32_t> *values, bool checkpoint = false, bool early_loser = false) {
+  const int num_rows = 20000;
+  const int num_losers = 4;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(1024, disk_manager, log_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, log_manager);
+  CheckpointManager checkpoint_manager(&txn_manager, log_manager, bpm);
+  log_manager->RunFlushThread();
+  auto row = [&schema](int32_t a, int32_t b) {
+    return Tuple({ValueFactory::GetIntegerValue(a), ValueFactory::GetIntegerValue(b)}, &schema);
+  };
+  std::vector<Transaction *> losers;
+
+  // nothing waits for the log, it is written out in the end
+  Transaction *txn = txn_manager.Begin(nullptr, IsolationLevel::REPEATABLE_READ, DurabilityMode::ASYNC);
+  TableHeap table(bpm, &lock_manager, log_manager, txn);
+  for (int32_t i = 0; i < num_rows; i++) {
+    RID rid;
+    EXPECT_TRUE(table.InsertTuple(row(i, 0), &rid, txn));
+    rids->push_back(rid);
+    values->push_back(0);
+  }
+  txn_manager.Commit(txn);
+  delete txn;
+  bpm->FlushAllPages();
+
+  // a loser that only adds rows, so it never waits for the locks of the updates
+  auto begin_loser = [&] {
+    Transaction *loser = txn_manager.Begin();
+    for (int k = 0; k < 10; k++) {
+      RID rid;
+      EXPECT_TRUE(table.InsertTuple(row(-1, -1), &rid, loser));
+    }
+    losers.push_back(loser);
+  };
+
+  std::mt19937 gen(0);
+  for (int i = 0; i < num_updates; i += 10) {
+    if (checkpoint && i == num_updates / 4) {
+      if (early_loser) {
+        begin_loser();
+      }
+      // as the page cleaner would, sooner or later
+      bpm->FlushAllPages();
+    }
+    if (checkpoint && i == num_updates / 2) {
+      if (!early_loser) {
+        begin_loser();
+      }
+      int num_writes = disk_manager->GetNumWrites();
+      checkpoint_manager.BeginCheckpoint();
+      checkpoint_manager.EndCheckpoint();
+      // a fuzzy checkpoint writes no pages
+      EXPECT_EQ(num_writes, disk_manager->GetNumWrites());
+    }
+    txn = txn_manager.Begin(nullptr, IsolationLevel::REPEATABLE_READ, DurabilityMode::ASYNC);
+    for (int j = 0; j < 10; j++) {
+      auto r = gen() % num_rows;
+      if ((*values)[r] < 0 || txn->IsExclusiveLocked((*rids)[r])) {
+        continue;
+      }
+      if (gen() % 20 == 0) {
+        EXPECT_TRUE(table.MarkDelete((*rids)[r], txn));
+        (*values)[r] = -1;
+      } else {
+        (*values)[r] = i + j + 1;
+        EXPECT_TRUE(table.UpdateTuple(row(r, (*values)[r]), (*rids)[r], txn));
+      }
+    }
+    txn_manager.Commit(txn);
+    delete txn;
+  }
+
+  // the losers change rows of their own, and add some
+  for (int k = 0; k < num_losers; k++) {
+    txn = txn_manager.Begin();
+    for (int r = k; r < num_rows; r += num_rows / 10 + num_losers) {
+      if ((*values)[r] >= 0) {
+        EXPECT_TRUE(table.UpdateTuple(row(r, -2), (*rids)[r], txn));
+      }
+      RID rid;
+      EXPECT_TRUE(table.InsertTuple(row(-1, -1), &rid, txn));
+    }
+    losers.push_back(txn);
+  }
+
+  // the log made it to disk, the changes to the pages did not
+  log_manager->StopFlushThread();
+  delete bpm;
+  delete log_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  for (auto *loser : losers) {
+    delete loser;
+  }
+  CopyFile("test.db", "test_crash.db");
+  CopyFile("test.log", "test_crash.log");
+  CopyFile("test.ckpt", "test_crash.ckpt");
+  return table.GetFirstPageId();
+}
+
+/**
+ * Recover the crashed database with a number of threads, in a buffer pool smaller than the table, and check the rows.
+ * @return the microseconds recovery took
+ */
+static int64_t RecoverAndCheck(const Schema &schema, page_id_t first_page_id, const std::vector<RID> &rids,
+                               const std::vector<int32_t> &values, size_t num_threads) {
+  remove("test.warm");
+  CopyFile("test_crash.db", "test.db");
+  CopyFile("test_crash.log", "test.log");
+  CopyFile("test_crash.ckpt", "test.ckpt");
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(32, disk_manager);
+  LogRecovery log_recovery(disk_manager, bpm, num_threads);
+  auto start = std::chrono::steady_clock::now();
+  log_recovery.Redo();
+  log_recovery.Undo();
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+  LockManager lock_manager;
+  TableHeap table(bpm, &lock_manager, nullptr, first_page_id);
+  Transaction txn(0);
+  size_t num_live = 0;
+  for (size_t r = 0; r < rids.size(); r++) {
+    Tuple tuple;
+    if (values[r] < 0) {
+      EXPECT_FALSE(table.GetTuple(rids[r], &tuple, &txn));
+      continue;
+    }
+    num_live++;
+    EXPECT_TRUE(table.GetTuple(rids[r], &tuple, &txn));
+    EXPECT_EQ(values[r], tuple.GetValue(&schema, 1).GetAs<int32_t>());
+  }
+  // and the rows of the losers are gone
+  size_t num_rows = 0;
+  for (auto it = table.Begin(&txn); it != table.End(); ++it) {
+    num_rows++;
+  }
+  EXPECT_EQ(num_live, num_rows);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  return us;
+}
+
+/*
+ * Redo hands the records of a page to the thread that owns it, and undo does the same. Recovery time against the
+ * size of the log and the number of threads.
+ */
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, ParallelRecoveryTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::INTEGER}}};
+  for (int num_updates : {20000, 80000}) {
+    remove("test.db");
+    remove("test.log");
+    std::vector<RID> rids;
+    std::vector<int32_t> values;
+    page_id_t first_page_id = CrashAfterUpdates(schema, num_updates, &rids, &values);
+    std::ifstream log("test_crash.log", std::ios::binary | std::ios::ate);
+    auto log_size = static_cast<int64_t>(log.tellg());
+    for (size_t num_threads : {1, 2, 4, 8}) {
+      int64_t us = RecoverAndCheck(schema, first_page_id, rids, values, num_threads);
+      LOG_INFO("%d updates, %ld KB of log: recovery with %zu threads took %ld us", num_updates, log_size / 1024,
+               num_threads, us);
+    }
+  }
+}
+
+/*
+ * A fuzzy checkpoint halfway through the updates lets recovery skip the log up to the oldest change that had not
+ * reached the disk, or up to the first record of a transaction that was running, whichever comes first.
+ */
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, FuzzyCheckpointTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::INTEGER}}};
+  const int num_updates = 40000;
+  for (bool early_loser : {false, true}) {
+    remove("test.db");
+    remove("test.log");
+    std::vector<RID> rids;
+    std::vector<int32_t> values;
+    page_id_t first_page_id = CrashAfterUpdates(schema, num_updates, &rids, &values, true, early_loser);
+    std::ifstream log("test_crash.log", std::ios::binary | std::ios::ate);
+    auto log_size = static_cast<int64_t>(log.tellg());
+    std::ifstream master("test_crash.ckpt", std::ios::binary);
+    int64_t redo_offset = 0;
+    master.read(reinterpret_cast<char *>(&redo_offset), sizeof(redo_offset));
+    // the checkpoint came after half of the log, redo starts after the quarter that made it to disk
+    EXPECT_GT(redo_offset, log_size / 8);
+    EXPECT_LT(redo_offset, log_size / 2);
+
+    int64_t us = RecoverAndCheck(schema, first_page_id, rids, values, 1);
+    LOG_INFO("loser begun %s the pages were written: redo skips %ld of %ld KB of log, recovery took %ld us",
+             early_loser ? "before" : "after", redo_offset / 1024, log_size / 1024, us);
+    remove("test_crash.ckpt");
+    us = RecoverAndCheck(schema, first_page_id, rids, values, 1);
+    LOG_INFO("without the checkpoint, recovery took %ld us", us);
+  }
+}
+
+/*
+ * An update logs only the bytes it changed, so updating one column of a wide row takes a fraction of the log that two
+ * images of the row would, and recovery still rebuilds the whole rows.
+ */
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_RedoTest) {
+TEST_F(RecoveryTest, WideRowUpdateTest) {
+  const int num_columns = 32;
+  const int num_rows = 200;
+  const int num_updates = 2000;
+  std::vector<Column> columns;
+  for (int c = 0; c < num_columns; c++) {
+    columns.emplace_back("c" + std::to_string(c), TypeId::INTEGER);
+  }
+  columns.emplace_back("text", TypeId::VARCHAR, 256);
+  Schema schema{columns};
+  auto row = [&schema](int32_t r, int32_t value) {
+    std::vector<Value> values{ValueFactory::GetIntegerValue(r), ValueFactory::GetIntegerValue(value)};
+    for (int c = 2; c < num_columns; c++) {
+      values.push_back(ValueFactory::GetIntegerValue(r * c));
+    }
+    values.push_back(ValueFactory::GetVarcharValue(std::string(200, static_cast<char>('a' + r % 26))));
+    return Tuple(values, &schema);
+  };
+
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager, log_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  Transaction *txn = txn_manager.Begin();
+  TableHeap table(bpm, &lock_manager, log_manager, txn);
+  std::vector<RID> rids(num_rows);
+  std::vector<int32_t> values(num_rows, 0);
+  for (int32_t r = 0; r < num_rows; r++) {
+    EXPECT_TRUE(table.InsertTuple(row(r, 0), &rids[r], txn));
+  }
+  txn_manager.Commit(txn);
+  delete txn;
+  bpm->FlushAllPages();
+
+  off_t log_size = disk_manager->GetLogSize();
+  std::mt19937 gen(0);
+  for (int i = 0; i < num_updates; i += 10) {
+    txn = txn_manager.Begin(nullptr, IsolationLevel::REPEATABLE_READ, DurabilityMode::ASYNC);
+    for (int j = 0; j < 10; j++) {
+      auto r = gen() % num_rows;
+      values[r] = i + j + 1;
+      EXPECT_TRUE(table.UpdateTuple(row(r, values[r]), rids[r], txn));
+    }
+    txn_manager.Commit(txn);
+    delete txn;
+  }
+  log_manager->Flush(log_manager->GetNextLSN() - 1);
+  // each transaction adds a COMMIT record of 20 bytes, BEGIN is not logged
+  double bytes_per_update =
+      static_cast<double>(disk_manager->GetLogSize() - log_size - num_updates / 10 * 20) / num_updates;
+  // a record holding both whole images: header, rid, and the two tuples with their sizes
+  double full_image_bytes = 20 + sizeof(RID) + 2 * (sizeof(int32_t) + row(0, 0).GetLength());
+  LOG_INFO("%u byte rows: %.1f bytes of log per update, %.0f with whole images (%.1fx)", row(0, 0).GetLength(),
+           bytes_per_update, full_image_bytes, full_image_bytes / bytes_per_update);
+  EXPECT_LT(bytes_per_update * 10, full_image_bytes);
+
+  // a loser whose updates recovery takes back from the deltas alone
+  Transaction *loser = txn_manager.Begin();
+  for (int32_t r = 0; r < num_rows; r += 7) {
+    EXPECT_TRUE(table.UpdateTuple(row(r, -2), rids[r], loser));
+  }
+
+  // the log made it to disk, the changes to the pages did not
+  log_manager->StopFlushThread();
+  delete bpm;
+  delete log_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  delete loser;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManagerInstance(64, disk_manager);
+  LogRecovery log_recovery(disk_manager, bpm, 2);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  // the rows came back whole, with the committed updates and without those of the loser
+  TableHeap recovered(bpm, &lock_manager, nullptr, table.GetFirstPageId());
+  Transaction reader(0);
+  for (int32_t r = 0; r < num_rows; r++) {
+    Tuple tuple;
+    ASSERT_TRUE(recovered.GetTuple(rids[r], &tuple, &reader));
+    Tuple expected = row(r, values[r]);
+    ASSERT_EQ(expected.GetLength(), tuple.GetLength());
+    EXPECT_EQ(0, memcmp(expected.GetData(), tuple.GetData(), tuple.GetLength()));
+  }
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+/*
+ * The free space map is only written before a data page is, so a crash can lose the allocation of pages whose
+ * creation reached the log. Redo marks them allocated again, and they are not handed out a second time.
+ */
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, SpaceMapRedoTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 256}}};
+  const int num_rows = 200;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager, log_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  Transaction *txn = txn_manager.Begin();
+  TableHeap table(bpm, &lock_manager, log_manager, txn);
+  std::vector<RID> rids(num_rows);
+  for (int32_t r = 0; r < num_rows; r++) {
+    Tuple tuple({ValueFactory::GetIntegerValue(r), ValueFactory::GetVarcharValue(std::string(200, 'a'))}, &schema);
+    EXPECT_TRUE(table.InsertTuple(tuple, &rids[r], txn));
+  }
+  txn_manager.Commit(txn);
+  delete txn;
+  std::set<page_id_t> table_pages;
+  for (const auto &rid : rids) {
+    table_pages.insert(rid.GetPageId());
+  }
+  ASSERT_GT(table_pages.size(), 1);
+
+  // the crash: the log is on disk, no page and not the free space map is
+  CopyFile("test.db", "test_crash.db");
+  CopyFile("test.log", "test_crash.log");
+  log_manager->StopFlushThread();
+  delete bpm;
+  delete log_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+
+  CopyFile("test_crash.db", "test.db");
+  CopyFile("test_crash.log", "test.log");
+  disk_manager = new DiskManager("test.db");
+  for (page_id_t page_id : table_pages) {
+    EXPECT_FALSE(disk_manager->IsAllocated(page_id));
+  }
+  bpm = new BufferPoolManagerInstance(64, disk_manager);
+  LogRecovery log_recovery(disk_manager, bpm);
+  log_recovery.Redo();
+  log_recovery.Undo();
+  for (page_id_t page_id : table_pages) {
+    EXPECT_TRUE(disk_manager->IsAllocated(page_id));
+  }
+  for (size_t i = 0; i < table_pages.size(); i++) {
+    EXPECT_EQ(0, table_pages.count(disk_manager->AllocatePage()));
+  }
+
+  TableHeap recovered(bpm, &lock_manager, nullptr, table.GetFirstPageId());
+  Transaction reader(0);
+  for (int32_t r = 0; r < num_rows; r++) {
+    Tuple tuple;
+    ASSERT_TRUE(recovered.GetTuple(rids[r], &tuple, &reader));
+    EXPECT_EQ(r, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  }
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+/*
+ * Undo logs what it undoes, and the ABORT of every loser, so recovering again after another crash redoes that instead
+ * of undoing the losers a second time: that would remove the rows a later transaction put into the slots undo freed.
+ * A tuple whose removal is undone goes back into its own slot.
+ */
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, RepeatedCrashTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::INTEGER}}};
+  const int32_t num_rows = 10;
+  auto row = [&schema](int32_t a, int32_t b) {
+    return Tuple({ValueFactory::GetIntegerValue(a), ValueFactory::GetIntegerValue(b)}, &schema);
+  };
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager, log_manager);
+  auto *lock_manager = new LockManager();
+  auto *txn_manager = new TransactionManager(lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  Transaction *txn = txn_manager->Begin();
+  TableHeap table(bpm, lock_manager, log_manager, txn);
+  std::vector<RID> rids(num_rows);
+  for (int32_t r = 0; r < num_rows; r++) {
+    EXPECT_TRUE(table.InsertTuple(row(r, 0), &rids[r], txn));
+  }
+  txn_manager->Commit(txn);
+  delete txn;
+  bpm->FlushAllPages();
+
+  // the loser changes two rows, and adds a row that it has already taken back again as an abort would
+  Transaction *loser = txn_manager->Begin();
+  EXPECT_TRUE(table.UpdateTuple(row(5, -1), rids[5], loser));
+  EXPECT_TRUE(table.MarkDelete(rids[7], loser));
+  RID removed;
+  EXPECT_TRUE(table.InsertTuple(row(-1, -1), &removed, loser));
+  EXPECT_EQ(num_rows, removed.GetSlotNum());
+  table.ApplyDelete(removed, loser);
+  // which leaves a free slot before the one of the removed row
+  txn = txn_manager->Begin();
+  EXPECT_TRUE(table.MarkDelete(rids[3], txn));
+  txn_manager->Commit(txn);
+  delete txn;
+
+  // the first crash, before the changes reach the pages
+  log_manager->StopFlushThread();
+  delete bpm;
+  delete log_manager;
+  delete txn_manager;
+  delete lock_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  delete loser;
+
+  disk_manager = new DiskManager("test.db");
+  log_manager = new LogManager(disk_manager);
+  bpm = new BufferPoolManagerInstance(64, disk_manager, log_manager);
+  {
+    LogRecovery log_recovery(disk_manager, bpm);
+    log_recovery.Redo();
+    log_recovery.Undo();
+    log_manager->SetNextLSN(log_recovery.GetNextLSN());
+  }
+  // the undone pages reach the disk, and new rows go into the free slots
+  bpm->FlushAllPages();
+  lock_manager = new LockManager();
+  txn_manager = new TransactionManager(lock_manager, log_manager);
+  log_manager->RunFlushThread();
+  txn = txn_manager->Begin();
+  TableHeap restarted(bpm, lock_manager, log_manager, table.GetFirstPageId());
+  RID reused[2];
+  EXPECT_TRUE(restarted.InsertTuple(row(100, 0), &reused[0], txn));
+  EXPECT_TRUE(restarted.InsertTuple(row(101, 0), &reused[1], txn));
+  EXPECT_EQ(rids[3], reused[0]);
+  EXPECT_EQ(removed, reused[1]);
+  txn_manager->Commit(txn);
+  delete txn;
+
+  // the second crash
+  log_manager->StopFlushThread();
+  delete bpm;
+  delete log_manager;
+  delete txn_manager;
+  delete lock_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManagerInstance(64, disk_manager);
+  LogRecovery log_recovery(disk_manager, bpm);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  LockManager reader_lock_manager;
+  TableHeap recovered(bpm, &reader_lock_manager, nullptr, table.GetFirstPageId());
+  Transaction reader(0);
+  Tuple tuple;
+  for (int32_t r = 0; r < num_rows; r++) {
+    if (r == 3) {
+      continue;
+    }
+    ASSERT_TRUE(recovered.GetTuple(rids[r], &tuple, &reader));
+    EXPECT_EQ(r, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+    EXPECT_EQ(0, tuple.GetValue(&schema, 1).GetAs<int32_t>());
+  }
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(recovered.GetTuple(reused[i], &tuple, &reader));
+    EXPECT_EQ(100 + i, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  }
+  size_t num_live = 0;
+  for (auto it = recovered.Begin(&reader); it != recovered.End(); ++it) {
+    num_live++;
+  }
+  EXPECT_EQ(num_rows + 1, num_live);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, RedoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -132,7 +659,7 @@ TEST_F(RecoveryTest, DISABLED_RedoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_UndoTest) {
+TEST_F(RecoveryTest, UndoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -210,6 +737,69 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
   delete bustub_instance;
 }
 
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, WarmUpTest) {
+  // by default an instance leaves the buffer pool as it is
+  auto *bustub_instance = new BustubInstance("test.db");
+  EXPECT_EQ(nullptr, bustub_instance->buffer_pool_warmer_);
+  bustub_instance->Recover();
+  delete bustub_instance;
+  EXPECT_FALSE(std::ifstream("test.warm").good());
+
+  bustub_instance = new BustubInstance("test.db", true);
+  bustub_instance->Recover();
+  bustub_instance->log_manager_->RunFlushThread();
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  RID rid;
+  const Tuple tuple = ConstructTuple(&schema);
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+
+  // pages that are not in the log, so recovery leaves them on disk and only the warm-up reads them
+  std::vector<page_id_t> unlogged_pages(3);
+  for (page_id_t &page_id : unlogged_pages) {
+    Page *page = bustub_instance->buffer_pool_manager_->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    bustub_instance->buffer_pool_manager_->UnpinPage(page_id, true);
+  }
+  bustub_instance->buffer_pool_manager_->FlushAllPages();
+  // saves the hot page list
+  delete bustub_instance;
+  EXPECT_TRUE(std::ifstream("test.warm").good());
+
+  bustub_instance = new BustubInstance("test.db", true);
+  auto *bpm = dynamic_cast<BufferPoolManagerInstance *>(bustub_instance->buffer_pool_manager_);
+  // nothing is read before the pages are recovered
+  EXPECT_EQ(0, bpm->GetPrefetchedPages());
+  bustub_instance->Recover();
+  EXPECT_LE(unlogged_pages.size(), bpm->GetPrefetchedPages());
+  for (page_id_t page_id : unlogged_pages) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    bpm->UnpinPage(page_id, false);
+  }
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple old_tuple;
+  ASSERT_TRUE(test_table->GetTuple(rid, &old_tuple, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
 // NOLINTNEXTLINE
 TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
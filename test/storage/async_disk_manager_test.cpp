@@ -0,0 +1,220 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager_test.cpp
+//
+// Identification: test/storage/async_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <future>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/exception.h"
+#include "gtest/gtest.h"
+#include "storage/disk/async_disk_manager.h"
+
+namespace bustub {
+
+// Fails every write to the database file while the file is made read-only, as a failing device would.
+class FailingAsyncDiskManager : public AsyncDiskManager {
+ public:
+  using AsyncDiskManager::AsyncDiskManager;
+
+  void FailWrites() {
+    writable_fd_ = dup(db_fd_);
+    int read_only_fd = open(file_name_.c_str(), O_RDONLY);
+    dup2(read_only_fd, db_fd_);
+    close(read_only_fd);
+  }
+
+  void RestoreWrites() {
+    dup2(writable_fd_, db_fd_);
+    close(writable_fd_);
+  }
+
+ private:
+  int writable_fd_{-1};
+};
+
+class AsyncDiskManagerTest : public ::testing::Test {
+ protected:
+  // This function is called before every test.
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+  }
+
+  // This function is called after every test.
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+  };
+};
+
+// NOLINTNEXTLINE
+TEST_F(AsyncDiskManagerTest, ReadWritePageTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  AsyncDiskManager dm("test.db", 2);
+  std::strncpy(data, "A test string.", sizeof(data));
+
+  dm.ReadPageAsync(0, buf).wait();  // tolerate empty read
+
+  dm.WritePageAsync(0, data).wait();
+  dm.ReadPageAsync(0, buf).wait();
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+  // synchronous calls see the same file
+  std::memset(buf, 0, sizeof(buf));
+  dm.WritePage(5, data);
+  dm.ReadPage(5, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  EXPECT_EQ(2, dm.GetNumWrites());
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(AsyncDiskManagerTest, BatchTest) {
+  const int num_pages = 64;
+  AsyncDiskManager dm("test.db");
+
+  std::vector<std::vector<char>> pages(num_pages, std::vector<char>(PAGE_SIZE));
+  std::vector<DiskRequest> writes;
+  for (int i = 0; i < num_pages; ++i) {
+    snprintf(pages[i].data(), PAGE_SIZE, "page %d", i);
+    writes.push_back({true, i, pages[i].data()});
+  }
+  dm.SubmitBatch(std::move(writes)).wait();
+  EXPECT_EQ(num_pages, dm.GetNumWrites());
+
+  std::vector<std::vector<char>> bufs(num_pages, std::vector<char>(PAGE_SIZE));
+  std::vector<DiskRequest> reads;
+  for (int i = num_pages - 1; i >= 0; --i) {
+    reads.push_back({false, i, bufs[i].data()});
+  }
+  dm.SubmitBatch(std::move(reads)).wait();
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_EQ(0, std::memcmp(pages[i].data(), bufs[i].data(), PAGE_SIZE));
+  }
+
+  // an empty batch completes immediately
+  EXPECT_EQ(std::future_status::ready, dm.SubmitBatch({}).wait_for(std::chrono::seconds(0)));
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(AsyncDiskManagerTest, BufferPoolTest) {
+  const size_t buffer_pool_size = 16;
+  auto *dm = new AsyncDiskManager("test.db", 4);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, dm);
+
+  page_id_t page_id;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  EXPECT_EQ(static_cast<int>(buffer_pool_size), dm->GetNumWrites());
+
+  char buf[PAGE_SIZE];
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    dm->ReadPage(i, buf);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %zu", i);
+    EXPECT_EQ(0, strcmp(buf, expected));
+  }
+
+  dm->ShutDown();
+  delete bpm;
+  delete dm;
+}
+
+// NOLINTNEXTLINE
+TEST_F(AsyncDiskManagerTest, WriteErrorTest) {
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE] = {0};
+  FailingAsyncDiskManager dm("test.db", 2);
+  std::strncpy(data, "A test string.", sizeof(data));
+  dm.WritePageAsync(0, data).get();
+
+  // a failed write is reported through the future, and through the request in a batch
+  dm.FailWrites();
+  EXPECT_THROW(dm.WritePageAsync(1, data).get(), Exception);
+  std::atomic<int> failed = 0;
+  auto done = dm.SubmitBatch({{true, 2, data}, {true, 3, data}, {false, 0, buf}}, [&failed](const DiskRequest &r) {
+    if (r.error_ != nullptr) {
+      failed++;
+    }
+  });
+  EXPECT_THROW(done.get(), Exception);
+  EXPECT_EQ(2, failed);
+  EXPECT_EQ(0, std::memcmp(buf, data, sizeof(buf)));
+  dm.RestoreWrites();
+
+  dm.WritePageAsync(1, data).get();
+  dm.ReadPageAsync(1, buf).get();
+  EXPECT_EQ(0, std::memcmp(buf, data, sizeof(buf)));
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(AsyncDiskManagerTest, BufferPoolWriteErrorTest) {
+  const size_t buffer_pool_size = 4;
+  auto *dm = new FailingAsyncDiskManager("test.db", 2);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, dm);
+
+  page_id_t page_id;
+  Page *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+
+  // neither flush loses the page, it stays dirty until a write succeeds
+  dm->FailWrites();
+  EXPECT_THROW(bpm->FlushPage(page_id), Exception);
+  EXPECT_THROW(bpm->FlushAllPages(), Exception);
+  page = bpm->FetchPage(page_id);
+  EXPECT_TRUE(page->IsDirty());
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  // nor does an eviction whose victim cannot be written, the victim stays resident
+  for (size_t i = 1; i < buffer_pool_size; ++i) {
+    page_id_t other_page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&other_page_id));
+    EXPECT_TRUE(bpm->UnpinPage(other_page_id, false));
+  }
+  page_id_t new_page_id;
+  EXPECT_THROW(bpm->NewPage(&new_page_id), Exception);
+  page = bpm->FetchPage(page_id);
+  ASSERT_NE(nullptr, page);
+  EXPECT_TRUE(page->IsDirty());
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  dm->RestoreWrites();
+  EXPECT_TRUE(bpm->FlushPage(page_id));
+  char buf[PAGE_SIZE];
+  dm->ReadPage(page_id, buf);
+  char expected[PAGE_SIZE];
+  snprintf(expected, PAGE_SIZE, "page %d", page_id);
+  EXPECT_EQ(0, strcmp(buf, expected));
+
+  dm->ShutDown();
+  delete bpm;
+  delete dm;
+}
+
+}  // namespace bustub
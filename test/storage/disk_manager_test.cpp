@@ -10,9 +10,20 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "common/exception.h"
+#include "common/logger.h"
+#include "common/util/crc32c.h"
 #include "gtest/gtest.h"
 #include "storage/disk/disk_manager.h"
 
@@ -24,12 +35,20 @@ class DiskManagerTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.zpg");
+    remove("test.zpg.map");
+    remove("test_hot.db");
+    remove("test_cold.db");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
     remove("test.log");
+    remove("test.zpg");
+    remove("test.zpg.map");
+    remove("test_hot.db");
+    remove("test_cold.db");
   };
 };
 
@@ -72,6 +91,632 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DirectIoTest) {
+  // deliberately misaligned buffers, the disk manager has to bounce them through aligned memory
+  char buf[PAGE_SIZE + 1] = {0};
+  char data[PAGE_SIZE + 1] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file, true);
+  std::strncpy(data + 1, "A test string.", PAGE_SIZE);
+
+  dm.ReadPage(0, buf + 1);  // tolerate empty read
+
+  dm.WritePage(3, data + 1);
+  dm.ReadPage(3, buf + 1);
+  EXPECT_EQ(std::memcmp(buf + 1, data + 1, PAGE_SIZE), 0);
+
+  // pages before the one written read back as zeroes
+  std::memset(buf, 1, sizeof(buf));
+  dm.ReadPage(1, buf + 1);
+  EXPECT_EQ(0, buf[1]);
+  EXPECT_EQ(0, buf[PAGE_SIZE]);
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, AllocatePageTest) {
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  for (page_id_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, dm.AllocatePage());
+  }
+  EXPECT_EQ(10, dm.GetNumAllocatedPages());
+
+  // the lowest free page is handed out first
+  dm.DeallocatePage(7);
+  dm.DeallocatePage(3);
+  dm.DeallocatePage(3);
+  EXPECT_FALSE(dm.IsAllocated(3));
+  EXPECT_EQ(8, dm.GetNumAllocatedPages());
+  EXPECT_EQ(3, dm.AllocatePage());
+  EXPECT_EQ(7, dm.AllocatePage());
+  EXPECT_EQ(10, dm.AllocatePage());
+
+  // striped allocation only hands out pages of the requested stripe
+  dm.DeallocatePage(4);
+  dm.DeallocatePage(5);
+  EXPECT_EQ(5, dm.AllocatePage(3, 2));
+  EXPECT_EQ(11, dm.AllocatePage(3, 2));
+  EXPECT_EQ(4, dm.AllocatePage(3, 1));
+  EXPECT_EQ(13, dm.AllocatePage(3, 1));
+  EXPECT_EQ(12, dm.AllocatePage(3, 0));
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, AllocateExtentTest) {
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  EXPECT_EQ(0, dm.AllocatePage());
+  EXPECT_EQ(1, dm.AllocatePage());
+  // extents are aligned to their size, and single pages fill the gaps below them
+  EXPECT_EQ(8, dm.AllocateExtent(8));
+  EXPECT_EQ(64, dm.AllocateExtent(64));
+  EXPECT_EQ(16, dm.AllocateExtent(16));
+  EXPECT_EQ(2, dm.AllocatePage());
+  EXPECT_EQ(2 + 8 + 64 + 16 + 1, dm.GetNumAllocatedPages());
+  dm.DeallocatePage(70);
+  EXPECT_EQ(128, dm.AllocateExtent(64));
+  EXPECT_EQ(32, dm.AllocateExtent(32));
+
+  // only the pages of an extent that are marked allocated outlive the disk manager
+  dm.MarkAllocated(8);
+  dm.MarkAllocated(9);
+  dm.MarkAllocated(64);
+  dm.ShutDown();
+  auto reopened = DiskManager(db_file);
+  EXPECT_EQ(3 + 3, reopened.GetNumAllocatedPages());
+  EXPECT_TRUE(reopened.IsAllocated(9));
+  EXPECT_FALSE(reopened.IsAllocated(10));
+  EXPECT_EQ(3, reopened.AllocatePage());
+  EXPECT_EQ(16, reopened.AllocateExtent(16));
+  reopened.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ReadPagesTest) {
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  const size_t num_pages = 100;
+  // straddles the first map page and runs past the end of the file
+  const page_id_t first_page_id = PAGE_SIZE * 8 - 40;
+  std::vector<char> data(PAGE_SIZE);
+  for (size_t i = 0; i < num_pages - 10; ++i) {
+    std::snprintf(data.data(), PAGE_SIZE, "page %zu", i);
+    dm.WritePage(first_page_id + i, data.data());
+  }
+
+  std::vector<std::vector<char>> bufs(num_pages, std::vector<char>(PAGE_SIZE, 1));
+  std::vector<char *> page_data;
+  for (auto &buf : bufs) {
+    page_data.push_back(buf.data());
+  }
+  dm.ReadPages(first_page_id, page_data.data(), num_pages);
+  for (size_t i = 0; i < num_pages; ++i) {
+    EXPECT_EQ(i < num_pages - 10 ? "page " + std::to_string(i) : "", std::string(bufs[i].data()));
+  }
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, SpaceMapRecoveryTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  std::strncpy(data, "A test string.", sizeof(data));
+  const page_id_t num_pages = 2 * PAGE_SIZE * 8 + 10;  // spans three pages of the free space map
+
+  {
+    auto dm = DiskManager(db_file);
+    for (page_id_t i = 0; i < num_pages; ++i) {
+      dm.AllocatePage();
+    }
+    dm.WritePage(num_pages - 1, data);
+    dm.DeallocatePage(100);
+    dm.DeallocatePage(PAGE_SIZE * 8 + 5);
+    dm.ShutDown();
+  }
+
+  auto dm = DiskManager(db_file);
+  EXPECT_EQ(num_pages - 2, dm.GetNumAllocatedPages());
+  EXPECT_FALSE(dm.IsAllocated(100));
+  EXPECT_TRUE(dm.IsAllocated(num_pages - 1));
+  dm.ReadPage(num_pages - 1, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  EXPECT_EQ(100, dm.AllocatePage());
+  EXPECT_EQ(PAGE_SIZE * 8 + 5, dm.AllocatePage());
+  EXPECT_EQ(num_pages, dm.AllocatePage());
+
+  dm.ShutDown();
+}
+
+// Overwrite part of a page in the database file behind the disk manager's back, as a torn write or a bit rot would.
+static void CorruptPage(const std::string &db_file, page_id_t page_id, size_t offset, const char *data, size_t size) {
+  std::fstream file(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  // the pages covered by the first map page follow it
+  file.seekp(static_cast<std::streamoff>(page_id + 1) * PAGE_SIZE + offset);
+  file.write(data, static_cast<std::streamsize>(size));
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ChecksumTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+    EXPECT_EQ(page_id, dm.AllocatePage());
+    std::snprintf(data, PAGE_SIZE, "page %d", page_id);
+    dm.WritePage(page_id, data);
+  }
+  // an allocated page that was never written reads as zeros
+  EXPECT_EQ(8, dm.AllocatePage());
+  dm.ReadPage(8, buf);
+  EXPECT_EQ("", std::string(buf));
+  EXPECT_TRUE(dm.VerifyFile().empty());
+
+  // a torn write: the first sectors of a new version land, the rest of the page is still the old one
+  std::snprintf(data, PAGE_SIZE, "page 2, version 2");
+  CorruptPage(db_file, 2, 0, data, 512);
+  // a flipped bit
+  CorruptPage(db_file, 5, PAGE_SIZE / 2, "\x01", 1);
+  // a page written to the wrong place
+  std::fstream file(db_file, std::ios::binary | std::ios::in);
+  file.seekg(static_cast<std::streamoff>(6 + 1) * PAGE_SIZE);
+  file.read(buf, PAGE_SIZE);
+  file.close();
+  CorruptPage(db_file, 7, 0, buf, PAGE_SIZE);
+
+  EXPECT_THROW(dm.ReadPage(2, buf), Exception);
+  EXPECT_THROW(dm.ReadPage(5, buf), Exception);
+  EXPECT_THROW(dm.ReadPage(7, buf), Exception);
+  dm.ReadPage(6, buf);
+  EXPECT_EQ("page 6", std::string(buf));
+  // the checksum is not handed out with the page
+  EXPECT_EQ(0, buf[PAGE_USABLE_SIZE]);
+  EXPECT_EQ((std::vector<page_id_t>{2, 5, 7}), dm.VerifyFile());
+
+  // a batch completes the other reads and flags the corrupt one
+  std::vector<std::vector<char>> bufs(4, std::vector<char>(PAGE_SIZE));
+  std::vector<DiskRequest> requests;
+  for (page_id_t page_id = 1; page_id < 5; ++page_id) {
+    requests.push_back({false, page_id, bufs[page_id - 1].data()});
+  }
+  std::vector<page_id_t> corrupt;
+  auto done = dm.SubmitBatch(requests, [&corrupt](const DiskRequest &request) {
+    if (request.corrupt_) {
+      corrupt.push_back(request.page_id_);
+    }
+  });
+  EXPECT_THROW(done.get(), Exception);
+  EXPECT_EQ(std::vector<page_id_t>{2}, corrupt);
+  EXPECT_EQ("page 4", std::string(bufs[3].data()));
+
+  // rewriting a page repairs it, and freed pages are not checked
+  std::snprintf(data, PAGE_SIZE, "page 2");
+  dm.WritePage(2, data);
+  dm.DeallocatePage(5);
+  EXPECT_EQ(std::vector<page_id_t>{7}, dm.VerifyFile());
+
+  dm.ShutDown();
+}
+
+// Reports what checksums add to the CPU time of page I/O that is served from the OS page cache.
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ChecksumOverheadTest) {
+  const page_id_t num_pages = 256;
+  const int num_rounds = 8;
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  std::vector<char> data(PAGE_SIZE, 'x');
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    dm.AllocatePage();
+  }
+
+  auto time = [&](auto op) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < num_rounds; ++round) {
+      for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+        op(page_id);
+      }
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(ns) / (num_rounds * num_pages);
+  };
+  double write_ns = time([&](page_id_t page_id) { dm.WritePage(page_id, data.data()); });
+  double read_ns = time([&](page_id_t page_id) { dm.ReadPage(page_id, data.data()); });
+  uint32_t sum = 0;
+  double checksum_ns = time([&](page_id_t page_id) { sum += DiskManager::PageChecksum(page_id, data.data()); });
+  EXPECT_NE(0, sum);
+  EXPECT_TRUE(dm.VerifyFile().empty());
+  LOG_INFO("per page: write %.0f ns, read %.0f ns, checksum %.0f ns (%.1f%% of a write, %.1f%% of a read)", write_ns,
+           read_ns, checksum_ns, 100 * checksum_ns / write_ns, 100 * checksum_ns / read_ns);
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LargePageTest) {
+  const size_t page_size = 16 * 1024;
+  const auto pages_per_map_page = static_cast<page_id_t>(page_size * 8);
+  std::vector<char> buf(page_size);
+  std::vector<char> data(page_size);
+  auto fill = [&data](page_id_t page_id) {
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = static_cast<char>(page_id + i / 1000);
+    }
+    std::memset(data.data() + data.size() - PAGE_CHECKSUM_SIZE, 0, PAGE_CHECKSUM_SIZE);
+  };
+
+  {
+    auto dm = DiskManager("test.db", false, false, page_size);
+    EXPECT_EQ(page_size, dm.GetPageSize());
+    // the second group of pages, behind a map page of the large size
+    for (page_id_t i = 0; i < pages_per_map_page + 3; ++i) {
+      dm.AllocatePage();
+    }
+    for (page_id_t page_id : {0, 1, pages_per_map_page + 2}) {
+      fill(page_id);
+      dm.WritePage(page_id, data.data());
+    }
+    dm.ShutDown();
+    // the file ends with the last page written, in the second group
+    std::ifstream db_file("test.db", std::ios::binary | std::ios::ate);
+    EXPECT_EQ((pages_per_map_page + 2 + 2 + 1) * static_cast<int64_t>(page_size), db_file.tellg());
+  }
+
+  auto dm = DiskManager("test.db", false, false, page_size);
+  EXPECT_EQ(pages_per_map_page + 3, dm.GetNumAllocatedPages());
+  for (page_id_t page_id : {0, 1, pages_per_map_page + 2}) {
+    fill(page_id);
+    dm.ReadPage(page_id, buf.data());
+    EXPECT_EQ(0, std::memcmp(data.data(), buf.data(), page_size)) << "page " << page_id;
+  }
+  std::vector<std::vector<char>> bufs(2, std::vector<char>(page_size));
+  char *page_data[] = {bufs[0].data(), bufs[1].data()};
+  dm.ReadPages(0, page_data, 2);
+  fill(1);
+  EXPECT_EQ(0, std::memcmp(data.data(), bufs[1].data(), page_size));
+  // keep the scrub from reading the whole first group
+  for (page_id_t page_id = 2; page_id < pages_per_map_page; ++page_id) {
+    dm.DeallocatePage(page_id);
+  }
+  EXPECT_TRUE(dm.VerifyFile().empty());
+  dm.ShutDown();
+
+  // only powers of two from PAGE_SIZE to MAX_PAGE_SIZE, and compression only with PAGE_SIZE
+  EXPECT_THROW(DiskManager("test.db", false, false, 12 * 1024), Exception);
+  EXPECT_THROW(DiskManager("test.db", false, false, 2 * MAX_PAGE_SIZE), Exception);
+  EXPECT_THROW(DiskManager("test.db", false, true, page_size), Exception);
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, TablespaceTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  auto file_size = [](const std::string &file_name) {
+    std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+    return static_cast<int64_t>(file.tellg());
+  };
+  auto fill = [&data](page_id_t page_id) {
+    std::memset(data, 0, sizeof(data));
+    std::snprintf(data, sizeof(data), "page %d", page_id);
+  };
+  const page_id_t hot = FirstPageOf(1);
+  const page_id_t cold = FirstPageOf(2);
+
+  {
+    auto dm = DiskManager("test.db");
+    EXPECT_EQ(1, dm.AddTablespace("test_hot.db"));
+    EXPECT_EQ(2, dm.AddTablespace("test_cold.db"));
+    EXPECT_EQ(3, dm.GetNumTablespaces());
+    EXPECT_THROW(dm.AddTablespace("test.db"), Exception);
+    EXPECT_THROW(dm.AddTablespace("test_hot.db"), Exception);
+
+    // every tablespace hands out the ids of its own range, lowest first
+    EXPECT_EQ(0, dm.AllocatePage());
+    EXPECT_EQ(hot, dm.AllocatePage(1, 0, 1));
+    EXPECT_EQ(hot + 1, dm.AllocatePage(1, 0, 1));
+    EXPECT_EQ(cold, dm.AllocateExtent(8, 2));
+    EXPECT_EQ(cold + 8, dm.AllocateExtent(8, 2));
+    dm.MarkAllocated(cold);
+    dm.MarkAllocated(cold + 15);
+    // stripes are of the database-wide ids
+    page_id_t striped = dm.AllocatePage(3, 2, 1);
+    EXPECT_EQ(2, striped % 3);
+    EXPECT_EQ(1, TablespaceOf(striped));
+    EXPECT_EQ(20, dm.GetNumAllocatedPages());
+
+    for (page_id_t page_id : {0, hot, hot + 1, cold, cold + 15}) {
+      fill(page_id);
+      dm.WritePage(page_id, data);
+    }
+    dm.DeallocatePage(striped);
+    EXPECT_FALSE(dm.IsAllocated(striped));
+    EXPECT_TRUE(dm.IsAllocated(cold + 15));
+    EXPECT_TRUE(dm.VerifyFile().empty());
+    dm.ShutDown();
+  }
+  // each file holds its own map page and data pages, the main file none of the others'
+  EXPECT_EQ(2 * PAGE_SIZE, file_size("test.db"));
+  EXPECT_EQ(3 * PAGE_SIZE, file_size("test_hot.db"));
+  EXPECT_EQ(17 * PAGE_SIZE, file_size("test_cold.db"));
+
+  {
+    auto dm = DiskManager("test.db");
+    dm.AddTablespace("test_hot.db");
+    dm.AddTablespace("test_cold.db");
+    // the pages of the extents that were never used are free again
+    EXPECT_EQ(5, dm.GetNumAllocatedPages());
+    for (page_id_t page_id : {0, hot, hot + 1, cold, cold + 15}) {
+      fill(page_id);
+      dm.ReadPage(page_id, buf);
+      EXPECT_EQ(0, std::memcmp(buf, data, sizeof(buf))) << "page " << page_id;
+    }
+    char page_data[2][PAGE_SIZE];
+    char *pages[] = {page_data[0], page_data[1]};
+    dm.ReadPages(hot, pages, 2);
+    fill(hot + 1);
+    EXPECT_EQ(0, std::memcmp(page_data[1], data, sizeof(data)));
+    EXPECT_EQ(hot + 2, dm.AllocatePage(1, 0, 1));
+    dm.ShutDown();
+  }
+
+  // the checksums cover the database-wide page ids, so the files cannot be mixed up
+  {
+    auto dm = DiskManager("test.db");
+    EXPECT_THROW(dm.AddTablespace("test_cold.db"), Exception);
+    EXPECT_EQ(1, dm.GetNumTablespaces());
+    dm.ShutDown();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, TablespacePageSizeTest) {
+  const size_t hot_page_size = 16 * 1024;
+  const size_t cold_page_size = 8 * 1024;
+  const page_id_t hot = FirstPageOf(1);
+  const page_id_t cold = FirstPageOf(2);
+  const std::vector<std::pair<page_id_t, size_t>> pages = {{0, PAGE_SIZE},
+                                                           {hot, hot_page_size},
+                                                           {hot + 1, hot_page_size},
+                                                           {cold, cold_page_size},
+                                                           {cold + 2, cold_page_size}};
+  std::vector<char> buf(MAX_PAGE_SIZE);
+  std::vector<char> data(MAX_PAGE_SIZE);
+  auto fill = [&data](page_id_t page_id, size_t page_size) {
+    std::fill(data.begin(), data.end(), 0);
+    for (size_t i = 0; i < page_size - PAGE_CHECKSUM_SIZE; ++i) {
+      data[i] = static_cast<char>(page_id + i / 1000);
+    }
+  };
+
+  {
+    auto dm = DiskManager("test.db");
+    EXPECT_EQ(1, dm.AddTablespace("test_hot.db", hot_page_size));
+    EXPECT_EQ(2, dm.AddTablespace("test_cold.db", cold_page_size));
+    EXPECT_EQ(PAGE_SIZE, dm.GetPageSize(DEFAULT_TABLESPACE_ID));
+    EXPECT_EQ(hot_page_size, dm.GetPageSize(1));
+    EXPECT_EQ(cold_page_size, dm.GetPageSize(2));
+    EXPECT_THROW(dm.AddTablespace("test_bad.db", 12 * 1024), Exception);
+
+    EXPECT_EQ(0, dm.AllocatePage());
+    EXPECT_EQ(hot, dm.AllocatePage(1, 0, 1));
+    EXPECT_EQ(hot + 1, dm.AllocatePage(1, 0, 1));
+    EXPECT_EQ(cold, dm.AllocateExtent(4, 2));
+    dm.MarkAllocated(cold);
+    dm.MarkAllocated(cold + 2);
+    for (auto [page_id, page_size] : pages) {
+      fill(page_id, page_size);
+      dm.WritePage(page_id, data.data());
+    }
+    EXPECT_TRUE(dm.VerifyFile().empty());
+    dm.ShutDown();
+  }
+  // every file is laid out in its own page size
+  std::ifstream hot_file("test_hot.db", std::ios::binary | std::ios::ate);
+  EXPECT_EQ(3 * static_cast<int64_t>(hot_page_size), hot_file.tellg());
+  std::ifstream cold_file("test_cold.db", std::ios::binary | std::ios::ate);
+  EXPECT_EQ(4 * static_cast<int64_t>(cold_page_size), cold_file.tellg());
+
+  {
+    auto dm = DiskManager("test.db");
+    dm.AddTablespace("test_hot.db", hot_page_size);
+    dm.AddTablespace("test_cold.db", cold_page_size);
+    EXPECT_EQ(5, dm.GetNumAllocatedPages());
+    for (auto [page_id, page_size] : pages) {
+      fill(page_id, page_size);
+      dm.ReadPage(page_id, buf.data());
+      EXPECT_EQ(0, std::memcmp(data.data(), buf.data(), page_size)) << "page " << page_id;
+    }
+    dm.ShutDown();
+  }
+
+  // a tablespace reopened with another page size is refused, whether the size is larger or smaller
+  const std::vector<std::pair<size_t, size_t>> wrong_sizes = {
+      {PAGE_SIZE, cold_page_size}, {hot_page_size, PAGE_SIZE}, {hot_page_size, hot_page_size}};
+  for (auto [hot_size, cold_size] : wrong_sizes) {
+    auto dm = DiskManager("test.db");
+    if (hot_size == hot_page_size) {
+      dm.AddTablespace("test_hot.db", hot_size);
+      EXPECT_THROW(dm.AddTablespace("test_cold.db", cold_size), Exception);
+    } else {
+      EXPECT_THROW(dm.AddTablespace("test_hot.db", hot_size), Exception);
+    }
+    dm.ShutDown();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, CompressedPageTest) {
+  char buf[PAGE_SIZE] = {0};
+  std::vector<std::string> versions(16);
+  auto write = [](DiskManager *dm, page_id_t page_id, const std::string &text) {
+    // text repeated, then random bytes: the longer the random tail, the worse the page compresses
+    char data[PAGE_SIZE] = {0};
+    for (size_t i = 0; i + text.size() < PAGE_SIZE; i += text.size()) {
+      std::memcpy(data + i, text.data(), text.size());
+    }
+    std::default_random_engine rng(page_id);
+    size_t random_bytes = std::min<size_t>(text.size() * 64, PAGE_USABLE_SIZE);
+    for (size_t i = PAGE_USABLE_SIZE - random_bytes; i < PAGE_USABLE_SIZE; ++i) {
+      data[i] = static_cast<char>(rng());
+    }
+    dm->WritePage(page_id, data);
+    return std::string(data, PAGE_USABLE_SIZE);
+  };
+  auto check = [&buf, &versions](DiskManager *dm) {
+    for (page_id_t page_id = 0; page_id < 16; ++page_id) {
+      dm->ReadPage(page_id, buf);
+      EXPECT_EQ(versions[page_id], std::string(buf, PAGE_USABLE_SIZE)) << "page " << page_id;
+    }
+  };
+
+  {
+    auto dm = DiskManager("test.db", false, true);
+    ASSERT_NE(nullptr, dm.GetPageStore());
+    for (page_id_t page_id = 0; page_id < 16; ++page_id) {
+      dm.AllocatePage();
+      versions[page_id] = write(&dm, page_id, "page " + std::to_string(page_id));
+    }
+    // grow some pages, shrink others, and store one that does not compress at all
+    for (page_id_t page_id = 0; page_id < 16; page_id += 3) {
+      versions[page_id] = write(&dm, page_id, std::string(8 + page_id, static_cast<char>('a' + page_id)));
+    }
+    versions[1] = write(&dm, 1, "p");
+    versions[2] = write(&dm, 2, std::string(64, 'z') + "!");
+    check(&dm);
+    EXPECT_EQ(16, dm.GetPageStore()->GetNumPages());
+    EXPECT_GT(16 * PAGE_SIZE, dm.GetPageStore()->GetStoredBytes());
+    EXPECT_TRUE(dm.VerifyFile().empty());
+    // the database file only holds the free space map
+    dm.ShutDown();
+    std::ifstream db_file("test.db", std::ios::binary | std::ios::ate);
+    EXPECT_EQ(PAGE_SIZE, db_file.tellg());
+  }
+
+  // reopened with the saved map
+  {
+    auto dm = DiskManager("test.db", false, true);
+    check(&dm);
+    dm.DeallocatePage(4);
+    versions[4] = std::string(PAGE_USABLE_SIZE, 0);
+    versions[5] = write(&dm, 5, "page 5, version 3");
+  }
+  // lost, as after a crash
+  remove("test.zpg.map");
+
+  // rebuilt from the records: the newest version of each allocated page wins, page 4 is free again
+  auto dm = DiskManager("test.db", false, true);
+  EXPECT_EQ(15, dm.GetPageStore()->GetNumPages());
+  check(&dm);
+  EXPECT_TRUE(dm.VerifyFile().empty());
+
+  // damaged records fail the read and the scrub; a byte of every sector is flipped, so every record is hit
+  std::fstream store("test.zpg", std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+  auto store_size = static_cast<std::streamoff>(store.tellp());
+  for (std::streamoff offset = 40; offset < store_size; offset += 512) {
+    store.seekp(offset);
+    store.write("\x01", 1);
+  }
+  store.close();
+  EXPECT_EQ(15, dm.VerifyFile().size());
+  EXPECT_THROW(dm.ReadPage(0, buf), Exception);
+  dm.ShutDown();
+}
+
+// A saved map whose records overlap loses the older one instead of taking the store down.
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, CompressedOverlapTest) {
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE];
+  {
+    auto dm = DiskManager("test.db", false, true);
+    for (page_id_t page_id = 0; page_id < 2; ++page_id) {
+      dm.AllocatePage();
+      std::snprintf(data, sizeof(data), "page %d", page_id);
+      dm.WritePage(page_id, data);
+    }
+    dm.ShutDown();
+  }
+
+  // point the older record of page 0 into the newer one of page 1: magic, count and next sequence number, then
+  // entries of page id, sectors, first sector and sequence number, then the checksum
+  std::ifstream in("test.zpg.map", std::ios::binary);
+  std::vector<char> map((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  const size_t header_size = 16;
+  const size_t entry_size = 24;
+  ASSERT_EQ(header_size + 2 * entry_size + sizeof(uint32_t), map.size());
+  std::memcpy(map.data() + header_size + 8, map.data() + header_size + entry_size + 8, sizeof(uint64_t));
+  uint32_t checksum = Crc32c::Value(map.data(), map.size() - sizeof(checksum));
+  std::memcpy(map.data() + map.size() - sizeof(checksum), &checksum, sizeof(checksum));
+  std::ofstream out("test.zpg.map", std::ios::binary | std::ios::trunc);
+  out.write(map.data(), static_cast<std::streamsize>(map.size()));
+  out.close();
+
+  auto dm = DiskManager("test.db", false, true);
+  EXPECT_EQ(1, dm.GetPageStore()->GetNumPages());
+  dm.ReadPage(1, buf);
+  EXPECT_STREQ("page 1", buf);
+  dm.ReadPage(0, buf);
+  EXPECT_STREQ("", buf);
+  dm.ShutDown();
+}
+
+// Reports how much smaller a compressed table is, and how much less of it a scan reads.
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, CompressedScanTest) {
+  const page_id_t num_pages = 512;
+  std::vector<char> data(PAGE_SIZE);
+  std::vector<std::vector<char>> bufs(num_pages, std::vector<char>(PAGE_SIZE));
+  std::vector<char *> page_data;
+  for (auto &buf : bufs) {
+    page_data.push_back(buf.data());
+  }
+  auto fill = [&data](page_id_t page_id) {
+    // rows of a table: an increasing key, a few small integers, and a string from a short list
+    const char *cities[] = {"Pittsburgh", "Seattle", "Boston", "Austin"};
+    for (size_t row = 0; row < PAGE_USABLE_SIZE / 48; ++row) {
+      int key = page_id * 100 + static_cast<int>(row);
+      std::memset(data.data() + row * 48, 0, 48);
+      std::memcpy(data.data() + row * 48, &key, sizeof(key));
+      data[row * 48 + 8] = static_cast<char>(row % 5);
+      std::snprintf(data.data() + row * 48 + 16, 32, "%s", cities[(key * 7) % 4]);
+    }
+  };
+
+  auto measure = [&](bool compress_pages) {
+    auto dm = DiskManager("test.db", false, compress_pages);
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      dm.AllocatePage();
+      fill(page_id);
+      dm.WritePage(page_id, data.data());
+    }
+    auto start = std::chrono::steady_clock::now();
+    dm.ReadPages(0, page_data.data(), num_pages);
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    fill(num_pages - 1);
+    EXPECT_EQ(0, std::memcmp(data.data(), bufs[num_pages - 1].data(), PAGE_USABLE_SIZE));
+    size_t bytes = compress_pages ? dm.GetPageStore()->GetNumBytesRead() : num_pages * PAGE_SIZE;
+    dm.ShutDown();
+    remove("test.db");
+    return std::make_pair(bytes, us);
+  };
+  auto [raw_bytes, raw_us] = measure(false);
+  auto [compressed_bytes, compressed_us] = measure(true);
+  EXPECT_GT(raw_bytes / 2, compressed_bytes);
+  LOG_INFO("scan of %d pages: %zu KB read in %ld us, compressed %zu KB in %ld us (%.1fx less)", num_pages,
+           raw_bytes / 1024, static_cast<int64_t>(raw_us), compressed_bytes / 1024,
+           static_cast<int64_t>(compressed_us), static_cast<double>(raw_bytes) / compressed_bytes);
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
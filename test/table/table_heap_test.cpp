@@ -0,0 +1,263 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_heap_test.cpp
+//
+// Identification: test/table/table_heap_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/logger.h"
+#include "gtest/gtest.h"
+#include "storage/disk/async_disk_manager.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// An AsyncDiskManager whose reads can be made slow, like a disk that is not in the page cache.
+class SlowAsyncDiskManager : public AsyncDiskManager {
+ public:
+  explicit SlowAsyncDiskManager(const std::string &db_file) : AsyncDiskManager(db_file) {}
+
+  void ReadPage(page_id_t page_id, char *page_data) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(read_latency_ms_));
+    DiskManager::ReadPage(page_id, page_data);
+  }
+
+  void SetReadLatency(int read_latency_ms) { read_latency_ms_ = read_latency_ms; }
+
+ private:
+  std::atomic<int> read_latency_ms_{0};
+};
+
+// NOLINTNEXTLINE
+TEST(TableHeapTest, ReadAheadScanTest) {
+  const size_t buffer_pool_size = 32;
+  const int num_tuples = 2000;
+
+  auto *disk_manager = new SlowAsyncDiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  auto *txn = new Transaction(0);
+  auto *table = new TableHeap(bpm, nullptr, nullptr, txn);
+
+  Schema schema{{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 200}}};
+  std::string padding(180, 'x');
+  for (int i = 0; i < num_tuples; ++i) {
+    Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue(padding)}, &schema};
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+  }
+  bpm->FlushAllPages();
+  disk_manager->SetReadLatency(2);
+
+  // Scan the whole table and check that every tuple comes back in insertion order, counting the fetches that had to
+  // wait for a read of their own.
+  auto scan = [&]() {
+    uint64_t misses = bpm->GetStats().misses_;
+    auto start = std::chrono::steady_clock::now();
+    int count = 0;
+    for (auto it = table->Begin(txn); it != table->End(); ++it) {
+      EXPECT_EQ(count, it->GetValue(&schema, 0).GetAs<int32_t>());
+      ++count;
+    }
+    EXPECT_EQ(num_tuples, count);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    return std::make_pair(bpm->GetStats().misses_ - misses, elapsed);
+  };
+
+  size_t old_read_ahead_pages = scan_read_ahead_pages;
+  scan_read_ahead_pages = 0;
+  auto [plain_misses, plain] = scan();
+  EXPECT_EQ(0, bpm->GetPrefetchedPages());
+  // the table does not fit into the pool, so every page of the scan is read
+  EXPECT_GT(plain_misses, buffer_pool_size);
+
+  scan_read_ahead_pages = old_read_ahead_pages;
+  auto [read_ahead_misses, read_ahead] = scan();
+  EXPECT_GT(bpm->GetPrefetchedPages(), 0);
+  // with read-ahead, the pages are already in flight by the time the scan gets to them
+  EXPECT_LT(read_ahead_misses * 4, plain_misses);
+
+  LOG_INFO("full scan: %ld ms and %lu misses without read-ahead, %ld ms and %lu misses with read-ahead (%zu pages "
+           "prefetched)",
+           static_cast<long>(plain.count()), static_cast<unsigned long>(plain_misses),  // NOLINT
+           static_cast<long>(read_ahead.count()), static_cast<unsigned long>(read_ahead_misses),  // NOLINT
+           bpm->GetPrefetchedPages());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+
+  delete table;
+  delete txn;
+  delete bpm;
+  delete disk_manager;
+}
+
+// Two tables filled at the same time still get their own runs of contiguous pages.
+// NOLINTNEXTLINE
+TEST(TableHeapTest, ExtentLayoutTest) {
+  const size_t buffer_pool_size = 32;
+  const int num_tuples = 2000;
+
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  auto *txn = new Transaction(0);
+  auto *table_a = new TableHeap(bpm, nullptr, nullptr, txn);
+  auto *table_b = new TableHeap(bpm, nullptr, nullptr, txn);
+
+  Schema schema{{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 200}}};
+  std::string padding(180, 'x');
+  for (int i = 0; i < num_tuples; ++i) {
+    Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue(padding)}, &schema};
+    RID rid;
+    ASSERT_TRUE(table_a->InsertTuple(tuple, &rid, txn));
+    ASSERT_TRUE(table_b->InsertTuple(tuple, &rid, txn));
+  }
+
+  // Follow each page chain, counting the hops to the next page in the file; one hop per extent is not.
+  for (auto *table : {table_a, table_b}) {
+    size_t num_pages = 1;
+    size_t sequential_hops = 0;
+    page_id_t page_id = table->GetFirstPageId();
+    while (true) {
+      auto *page = static_cast<TablePage *>(bpm->FetchPage(page_id));
+      ASSERT_NE(nullptr, page);
+      page_id_t next_page_id = page->GetNextPageId();
+      bpm->UnpinPage(page_id, false);
+      if (next_page_id == INVALID_PAGE_ID) {
+        break;
+      }
+      num_pages++;
+      sequential_hops += next_page_id == page_id + 1 ? 1 : 0;
+      page_id = next_page_id;
+    }
+    LOG_INFO("%zu pages, %zu sequential hops", num_pages, sequential_hops);
+    EXPECT_GT(num_pages, ExtentAllocator::DEFAULT_EXTENT_PAGES);
+    EXPECT_GE(sequential_hops, num_pages - 1 - 4);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+
+  delete table_a;
+  delete table_b;
+  delete txn;
+  delete bpm;
+  delete disk_manager;
+}
+
+// A table placed in a tablespace of its own keeps all its pages in that tablespace's file, also once reopened.
+TEST(TableHeapTest, TablespaceTest) {
+  Schema schema{{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 200}}};
+  std::string padding(180, 'x');
+  auto *disk_manager = new DiskManager("test.db");
+  tablespace_id_t tablespace_id = disk_manager->AddTablespace("test_cold.db");
+  auto *bpm = new BufferPoolManagerInstance(16, disk_manager);
+  auto *txn = new Transaction(0);
+  auto insert = [&](TableHeap *table, int from, int to) {
+    for (int i = from; i < to; ++i) {
+      Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue(padding)}, &schema};
+      RID rid;
+      EXPECT_TRUE(table->InsertTuple(tuple, &rid, txn));
+      EXPECT_EQ(tablespace_id, TablespaceOf(rid.GetPageId()));
+    }
+  };
+
+  auto *table = new TableHeap(bpm, nullptr, nullptr, txn, tablespace_id);
+  EXPECT_EQ(tablespace_id, TablespaceOf(table->GetFirstPageId()));
+  insert(table, 0, 500);
+  auto *reopened = new TableHeap(bpm, nullptr, nullptr, table->GetFirstPageId());
+  insert(reopened, 500, 1000);
+  bpm->FlushAllPages();
+  int count = 0;
+  for (auto it = reopened->Begin(txn); it != reopened->End(); ++it) {
+    EXPECT_EQ(count++, it->GetValue(&schema, 0).GetAs<int32_t>());
+  }
+  EXPECT_EQ(1000, count);
+  // not a page of the main file is used
+  EXPECT_FALSE(disk_manager->IsAllocated(0));
+  EXPECT_TRUE(disk_manager->VerifyFile().empty());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  remove("test_cold.db");
+  delete reopened;
+  delete table;
+  delete txn;
+  delete bpm;
+  delete disk_manager;
+}
+
+// A table in a file with 64 KB pages needs a sixteenth of the pages, and takes tuples too large for 4 KB pages.
+// NOLINTNEXTLINE
+TEST(TableHeapTest, LargePageTest) {
+  const int num_tuples = 2000;
+  Schema schema{{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 10000}}};
+  std::string padding(180, 'x');
+
+  auto count_pages = [&](size_t page_size) {
+    auto *disk_manager = new DiskManager("test.db", false, false, page_size);
+    auto *bpm = new BufferPoolManagerInstance(16, disk_manager);
+    EXPECT_EQ(page_size, bpm->GetPageSize());
+    auto *txn = new Transaction(0);
+    auto *table = new TableHeap(bpm, nullptr, nullptr, txn);
+    for (int i = 0; i < num_tuples; ++i) {
+      Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue(padding)}, &schema};
+      RID rid;
+      EXPECT_TRUE(table->InsertTuple(tuple, &rid, txn));
+    }
+    Tuple large{{ValueFactory::GetIntegerValue(num_tuples), ValueFactory::GetVarcharValue(std::string(8000, 'y'))},
+                &schema};
+    RID rid;
+    EXPECT_EQ(page_size > PAGE_SIZE, table->InsertTuple(large, &rid, txn));
+
+    // everything comes back from disk, through a pool far smaller than the table
+    bpm->FlushAllPages();
+    int count = 0;
+    for (auto it = table->Begin(txn); it != table->End(); ++it) {
+      EXPECT_EQ(count, it->GetValue(&schema, 0).GetAs<int32_t>());
+      ++count;
+    }
+    EXPECT_EQ(page_size > PAGE_SIZE ? num_tuples + 1 : num_tuples, count);
+    EXPECT_TRUE(disk_manager->VerifyFile().empty());
+    size_t num_pages = 0;
+    for (page_id_t page_id = table->GetFirstPageId(); page_id != INVALID_PAGE_ID; num_pages++) {
+      auto *page = static_cast<TablePage *>(bpm->FetchPage(page_id));
+      page_id_t next_page_id = page->GetNextPageId();
+      bpm->UnpinPage(page_id, false);
+      page_id = next_page_id;
+    }
+
+    disk_manager->ShutDown();
+    remove("test.db");
+    remove("test.log");
+    delete table;
+    delete txn;
+    delete bpm;
+    delete disk_manager;
+    return num_pages;
+  };
+
+  size_t small_pages = count_pages(PAGE_SIZE);
+  size_t large_pages = count_pages(64 * 1024);
+  LOG_INFO("%zu pages of 4 KB, %zu pages of 64 KB", small_pages, large_pages);
+  EXPECT_GT(small_pages, 8 * large_pages);
+}
+
+}  // namespace bustub